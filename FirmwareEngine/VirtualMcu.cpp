@@ -4,6 +4,9 @@
 
 #include "VirtualMcu.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 
@@ -31,6 +34,121 @@ namespace firmware
         constexpr std::uint8_t UartFrameErrorBit = 4;
         constexpr std::uint8_t UartDataOverrunBit = 3;
         constexpr std::uint8_t UartParityErrorBit = 2;
+        constexpr double WdtTimeouts[] = {0.016, 0.032, 0.064, 0.125, 0.25, 0.5, 1.0, 2.0, 4.0, 8.0};
+        constexpr std::uint64_t NoEvent = ~std::uint64_t{0};
+
+        // Board descriptors for the step loop: what differs between the MCUs
+        // on the per-block and per-event paths.
+        struct Atmega328pBoard
+        {
+            static constexpr bool HasTimers345 = false;
+            static constexpr bool HasMux5 = false; // ADCSRB.MUX5 selects ADC8-15
+            static constexpr int UartCount = 1;
+        };
+
+        struct Atmega2560Board
+        {
+            static constexpr bool HasTimers345 = true;
+            static constexpr bool HasMux5 = true; // ADCSRB.MUX5 selects ADC8-15
+            static constexpr int UartCount = 4;
+        };
+
+        // Instrumentation policies. Tracing, tracking and snapshots sample
+        // single instructions; without them the core runs whole blocks and
+        // none of their checks are compiled in.
+        struct NoInstrumentation
+        {
+            static constexpr bool Enabled = false;
+        };
+
+        struct Instrumentation
+        {
+            static constexpr bool Enabled = true;
+        };
+
+        // Registers whose writes can move a peripheral's next event: timer
+        // control, counter and compare registers, and the ADC, UART, SPI, TWI
+        // and watchdog controls.
+        bool IsScheduledRegister(std::uint16_t address)
+        {
+            auto within = [address](std::uint16_t first, std::uint16_t last)
+            {
+                return address >= first && address <= last;
+            };
+            return within(AVR_TCCR0A, AVR_OCR0B) || within(AVR_TCCR1A, AVR_OCR1BH) ||
+                   within(AVR_TCCR2A, AVR_OCR2B) || within(AVR_TCCR3A, AVR_OCR3CH) ||
+                   within(AVR_TCCR4A, AVR_OCR4CH) || within(AVR_TCCR5A, AVR_OCR5CH) ||
+                   within(AVR_UCSR0A, AVR_UDR0) || within(AVR_UCSR1A, AVR_UDR1) ||
+                   within(AVR_UCSR2A, AVR_UDR2) || within(AVR_UCSR3A, AVR_UDR3) ||
+                   within(AVR_SPCR, AVR_SPDR) || within(AVR_TWBR, AVR_TWCR) ||
+                   address == AVR_ADCSRA || address == AVR_WDTCSR;
+        }
+
+        // Whole cycles until a countdown of `remaining` cycles runs out
+        std::uint64_t CyclesUntil(double remaining)
+        {
+            return remaining <= 1.0 ? 1 : static_cast<std::uint64_t>(std::ceil(remaining));
+        }
+
+        struct TimerView
+        {
+            std::uint32_t counter;
+            std::uint32_t top;
+            std::uint32_t compare[3];
+            int compareCount;
+            bool phaseCorrect;
+            bool up;
+            int prescaler;
+            double remainder;
+        };
+
+        // Cycles until the SimulateTimerN step that raises a timer's next
+        // overflow or compare flag. Normal and CTC counters run 0..TOP and
+        // wrap; phase-correct ones run up to TOP and back down, so each
+        // compare value is reached twice per period.
+        std::uint64_t CyclesUntilTimerEvent(const TimerView &timer)
+        {
+            std::uint64_t ticks = 0;
+            if (timer.counter > timer.top)
+            {
+                ticks = 1; // Past a lowered TOP: wraps on the next tick
+            }
+            else if (timer.phaseCorrect)
+            {
+                std::uint32_t period = timer.top * 2u;
+                if (period == 0)
+                    return 1;
+                std::uint32_t pos = timer.up ? timer.counter : period - timer.counter;
+                auto distance = [&](std::uint32_t target)
+                {
+                    return target > pos ? target - pos : period - pos + target;
+                };
+                ticks = distance(period); // Back at BOTTOM
+                for (int i = 0; i < timer.compareCount; ++i)
+                {
+                    std::uint32_t target = timer.compare[i];
+                    if (target > timer.top)
+                        continue;
+                    ticks = std::min<std::uint64_t>(ticks, distance(target));
+                    ticks = std::min<std::uint64_t>(ticks, distance(period - target));
+                }
+            }
+            else
+            {
+                std::uint32_t span = timer.top + 1u;
+                ticks = span - timer.counter;
+                for (int i = 0; i < timer.compareCount; ++i)
+                {
+                    // Values above TOP are flagged at the wrap
+                    std::uint32_t target = timer.compare[i];
+                    if (target > timer.counter && target <= timer.top)
+                        ticks = std::min<std::uint64_t>(ticks, target - timer.counter);
+                    else if (target <= timer.top)
+                        ticks = std::min<std::uint64_t>(ticks, span - timer.counter + target);
+                }
+            }
+            return CyclesUntil((static_cast<double>(ticks) - timer.remainder) * timer.prescaler);
+        }
 
         struct BvmHeader
         {
@@ -66,6 +184,7 @@ namespace firmware
         : _profile(profile)
     {
         _state.flash.resize(_profile.flash_bytes, 0);
+        _state.decoded.resize(_state.flash.size() / 2);
         _state.sram.resize(_profile.sram_bytes, 0);
         _state.eeprom.resize(_profile.eeprom_bytes, 0);
         _state.io.resize(_profile.io_bytes, 0);
@@ -134,8 +253,6 @@ namespace firmware
         _vccVoltage = 5.0;
         _brownOutThreshold = 2.7;
         // Flash Access
-        _flashAccessDelay = 0;
-        _lastFlashAddress = 0;
         // Robotics Development Tracking
         _gpioHistory.clear();
         _pwmStates.clear();
@@ -194,12 +311,35 @@ namespace firmware
                  _state.sram.data(), _state.sram.size(),
                  _state.io.data(), _state.io.size(),
                  _state.regs.data(), _state.regs.size());
+        // Counters are only brought current when read, and reading UDR lets
+        // the receiver take the next byte, so those reads sync first.
+        AVR_SetIoReadSync(&_state.core, AVR_TCNT0, 1);
+        AVR_SetIoReadSync(&_state.core, AVR_TCNT1L, 1);
+        AVR_SetIoReadSync(&_state.core, AVR_TCNT2, 1);
         if (_profile.mcu == "ATmega2560")
         {
             AVR_SetMcuKind(&_state.core, AVR_MCU_2560);
+            AVR_SetIoReadSync(&_state.core, AVR_TCNT3L, 1);
+            AVR_SetIoReadSync(&_state.core, AVR_TCNT4L, 1);
+            AVR_SetIoReadSync(&_state.core, AVR_TCNT5L, 1);
+        }
+        SelectStepLoop();
+        for (int i = 0; i < static_cast<int>(_uarts.size()); ++i)
+        {
+            if (HasUart(i))
+            {
+                AVR_SetIoReadSync(&_state.core, UdrAddress[i], 1);
+            }
         }
+        AVR_SetDecodeCache(&_state.core, _state.decoded.data(), _state.decoded.size());
+        AVR_SetRuntimeHle(&_state.core, _runtimeHle ? 1 : 0);
         AVR_SetIoWriteHook(&_state.core, IoWriteHook, this);
+        RegisterIoWriteHandlers();
         AVR_SetIoReadHook(&_state.core, IoReadHook, this);
+        AVR_SetIoSyncHook(&_state.core, IoSyncHook, this);
+        _peripheralTick = 0;
+        _nextEventTick = 0;
+        _scheduleDirty = false;
         for (int i = 0; i < static_cast<int>(_uarts.size()); ++i)
         {
             if (!HasUart(i))
@@ -225,6 +365,7 @@ namespace firmware
             limit -= _profile.bootloader_bytes;
         }
         std::fill(_state.flash.begin(), _state.flash.begin() + static_cast<std::ptrdiff_t>(limit), 0xFF);
+        AVR_InvalidateFlash(&_state.core, 0, limit);
         return true;
     }
 
@@ -259,6 +400,7 @@ namespace firmware
             return false;
         }
         std::memcpy(_state.flash.data() + start, data, size);
+        AVR_InvalidateFlash(&_state.core, byteAddress, size);
         return true;
     }
 
@@ -380,7 +522,7 @@ namespace firmware
 
         auto computePwmDuty = [&](int pin, std::uint8_t &duty) -> bool
         {
-            if (_profile.mcu != "ATmega328P")
+            if (IsMega2560())
             {
                 return false;
             }
@@ -643,6 +785,7 @@ namespace firmware
                 error = "Failed to parse Intel HEX section";
                 return false;
             }
+            AVR_InvalidateFlash(&_state.core, 0, _state.flash.size());
             return true;
         }
 
@@ -660,6 +803,7 @@ namespace firmware
             }
             std::size_t copySize = size > _state.flash.size() ? _state.flash.size() : size;
             std::memcpy(_state.flash.data(), data, copySize);
+            AVR_InvalidateFlash(&_state.core, 0, copySize);
             return true;
         }
 
@@ -669,11 +813,39 @@ namespace firmware
 
     void VirtualMcu::StepCycles(std::uint64_t totalCycles)
     {
-        const std::uint64_t MaxQuantum = 1600;
+        (this->*_stepLoop)(totalCycles);
+    }
+
+    void VirtualMcu::SelectStepLoop()
+    {
+        const bool instrumented = _enableDevelopmentTracking || _traceCpuEnabled || _deterministicMode;
+        if (IsMega2560())
+        {
+            _stepLoop = instrumented ? &VirtualMcu::StepLoop<Atmega2560Board, Instrumentation>
+                                     : &VirtualMcu::StepLoop<Atmega2560Board, NoInstrumentation>;
+            _syncPeripherals = &VirtualMcu::SyncPeripheralsFor<Atmega2560Board>;
+            _uartCount = Atmega2560Board::UartCount;
+        }
+        else
+        {
+            _stepLoop = instrumented ? &VirtualMcu::StepLoop<Atmega328pBoard, Instrumentation>
+                                     : &VirtualMcu::StepLoop<Atmega328pBoard, NoInstrumentation>;
+            _syncPeripherals = &VirtualMcu::SyncPeripheralsFor<Atmega328pBoard>;
+            _uartCount = Atmega328pBoard::UartCount;
+        }
+    }
+
+    template <class Board, class Policy>
+    void VirtualMcu::StepLoop(std::uint64_t totalCycles)
+    {
+        // Inputs and registers may have changed since the last call
+        SyncPeripheralsFor<Board>();
         while (totalCycles > 0)
         {
-            std::uint64_t cycles = (totalCycles > MaxQuantum) ? MaxQuantum : totalCycles;
-            totalCycles -= cycles;
+            // The core runs uninterrupted up to the next peripheral event.
+            // Accesses to peripheral registers on the way bring the
+            // peripherals up to that instruction first (IoSyncHook).
+            std::uint64_t cycles = std::min(totalCycles, _nextEventTick - _tickCount);
             std::uint64_t tickStart = _tickCount;
             while (cycles > 0)
             {
@@ -703,54 +875,67 @@ namespace firmware
                 // Check stack integrity before instruction execution
                 CheckStackIntegrity();
 
-                // Update watchdog timer
-                UpdateWatchdogTimer(1);
-
                 // Check brown-out condition
                 CheckBrownOutCondition();
 
-                // Simulate power modes (sleep states)
-                SimulatePowerMode();
-
-                // Enforce flash access latency
-                EnforceFlashAccessLatency();
-
-                // Robotics Development Tracking (rate-limited, optional)
-                if (_enableDevelopmentTracking && (_tickCount % _trackingSampleInterval) == 0)
-                {
-                    TrackGpioChanges();
-                    AnalyzePwmOutputs();
-                    LogI2cTransaction();
-                    LogSpiTransaction();
-                    TrackInterruptLatency();
-                    DetectTimingViolations();
-                }
-
-                if (_traceCpuEnabled && (_tickCount % _traceCpuInterval) == 0)
+                if constexpr (Policy::Enabled)
                 {
-                    CpuTraceEvent evt{};
-                    evt.tick = _tickCount;
-                    evt.pc = _state.core.pc;
-                    evt.opcode = 0;
-                    std::size_t pcIndex = static_cast<std::size_t>(evt.pc) * 2;
-                    if (pcIndex + 1 < _state.flash.size())
+                    // Robotics Development Tracking (rate-limited, optional)
+                    if (_enableDevelopmentTracking && (_tickCount % _trackingSampleInterval) == 0)
                     {
-                        evt.opcode = static_cast<std::uint16_t>(
-                            _state.flash[pcIndex] | (_state.flash[pcIndex + 1] << 8));
+                        TrackGpioChanges();
+                        AnalyzePwmOutputs();
+                        LogI2cTransaction();
+                        LogSpiTransaction();
+                        TrackInterruptLatency();
+                        DetectTimingViolations();
                     }
-                    evt.sp = _state.core.sp;
-                    evt.sreg = GetIo(AVR_SREG);
-                    if (_traceCpuQueue.size() >= _traceCpuMax)
+
+                    if (_traceCpuEnabled && (_tickCount % _traceCpuInterval) == 0)
                     {
-                        _traceCpuQueue.pop_front();
+                        CpuTraceEvent evt{};
+                        evt.tick = _tickCount;
+                        evt.pc = _state.core.pc;
+                        evt.opcode = 0;
+                        std::size_t pcIndex = static_cast<std::size_t>(evt.pc) * 2;
+                        if (pcIndex + 1 < _state.flash.size())
+                        {
+                            evt.opcode = static_cast<std::uint16_t>(
+                                _state.flash[pcIndex] | (_state.flash[pcIndex + 1] << 8));
+                        }
+                        evt.sp = _state.core.sp;
+                        evt.sreg = GetIo(AVR_SREG);
+                        if (_traceCpuQueue.size() >= _traceCpuMax)
+                        {
+                            _traceCpuQueue.pop_front();
+                        }
+                        _traceCpuQueue.push_back(evt);
                     }
-                    _traceCpuQueue.push_back(evt);
                 }
 
-                std::uint8_t cost = AVR_ExecuteNext(&_state.core);
+                const bool asleep = _state.core.sleeping != 0;
+                std::uint32_t steps = 1;
+                std::uint32_t cost = 0;
+                if constexpr (Policy::Enabled)
+                {
+                    cost = AVR_ExecuteNext(&_state.core);
+                }
+                else
+                {
+                    cost = AVR_ExecuteBlock(&_state.core,
+                                            static_cast<std::uint32_t>(std::min<std::uint64_t>(cycles, UINT32_MAX)),
+                                            &steps);
+                }
                 if (cost == 0)
                     cost = 1;
                 cycles = (cost > cycles) ? 0 : (cycles - cost);
+
+                // Update watchdog timer
+                UpdateWatchdogTimer(steps);
+
+                // Simulate power modes (sleep states)
+                if (asleep)
+                    SimulatePowerMode(cost);
                 _tickCount += cost;
 
                 if (_inInterrupt)
@@ -762,390 +947,405 @@ namespace firmware
                 CheckPeripheralConstraints();
 
                 // Record execution snapshots for replay
-                if (_deterministicMode)
+                if constexpr (Policy::Enabled)
                 {
-                    RecordExecutionSnapshot();
+                    if (_deterministicMode)
+                    {
+                        RecordExecutionSnapshot();
+                    }
                 }
+
+                if (_scheduleDirty)
+                    break;
             }
 
             std::uint64_t executed = _tickCount - tickStart;
-            if (executed > 0)
+            totalCycles -= std::min(executed, totalCycles);
+            _perf.cycles += executed;
+            _perf.idleLoopCycles = _state.core.idle_loop_cycles;
+            _perf.flashAccessCycles = 2 * _state.core.flash_loads; // LPM: 3 cycles vs 1
+            _perf.runtimeHleCalls = _state.core.hle_calls;
+            if (_scheduleDirty)
+            {
+                // A peripheral register was accessed: its next event may move
+                _nextEventTick = NextEventTick<Board>();
+                _scheduleDirty = false;
+            }
+            if (_tickCount >= _nextEventTick)
+            {
+                SyncPeripheralsFor<Board>();
+            }
+
+            if (_wdtResetArmed)
             {
-                _perf.cycles += executed;
-                SimulateTimer0(executed);
-                SimulateTimer1(executed);
-                SimulateTimer2(executed);
-                if (_profile.mcu == "ATmega2560")
+                _perf.wdtResets++;
+                Reset();
+            }
+        }
+        SyncPeripheralsFor<Board>();
+    }
+
+    template <class Board>
+    void VirtualMcu::AdvancePeripherals(std::uint64_t executed)
+    {
+        SimulateTimer0(executed);
+        SimulateTimer1(executed);
+        SimulateTimer2(executed);
+        if constexpr (Board::HasTimers345)
+        {
+            SimulateTimer3(executed);
+            SimulateTimer4(executed);
+            SimulateTimer5(executed);
+        }
+
+        std::uint8_t adcsra = GetIo(AVR_ADCSRA);
+        if ((adcsra & (1u << 6)) != 0)
+        {
+            if (_adcCyclesRemaining <= 0.0)
+            {
+                int prescaler = 2;
+                std::uint8_t adps = static_cast<std::uint8_t>(adcsra & 0x07);
+                switch (adps)
                 {
-                    SimulateTimer3(executed);
-                    SimulateTimer4(executed);
-                    SimulateTimer5(executed);
+                case 0:
+                    prescaler = 2;
+                    break;
+                case 1:
+                    prescaler = 2;
+                    break;
+                case 2:
+                    prescaler = 4;
+                    break;
+                case 3:
+                    prescaler = 8;
+                    break;
+                case 4:
+                    prescaler = 16;
+                    break;
+                case 5:
+                    prescaler = 32;
+                    break;
+                case 6:
+                    prescaler = 64;
+                    break;
+                case 7:
+                    prescaler = 128;
+                    break;
                 }
+                _adcCyclesRemaining = 13.0 * prescaler;
             }
+        }
 
-            std::uint8_t adcsra = GetIo(AVR_ADCSRA);
-            if ((adcsra & (1u << 6)) != 0)
+        if (_adcCyclesRemaining > 0.0)
+        {
+            _adcCyclesRemaining -= static_cast<double>(executed);
+            if (_adcCyclesRemaining <= 0.0)
             {
-                if (_adcCyclesRemaining <= 0.0)
+                std::uint8_t admux = GetIo(AVR_ADMUX);
+                std::uint8_t adcsrb = GetIo(AVR_ADCSRB);
+                std::uint8_t channel = 0;
+                if constexpr (Board::HasMux5)
                 {
-                    int prescaler = 2;
-                    std::uint8_t adps = static_cast<std::uint8_t>(adcsra & 0x07);
-                    switch (adps)
-                    {
-                    case 0:
-                        prescaler = 2;
-                        break;
-                    case 1:
-                        prescaler = 2;
-                        break;
-                    case 2:
-                        prescaler = 4;
-                        break;
-                    case 3:
-                        prescaler = 8;
-                        break;
-                    case 4:
-                        prescaler = 16;
-                        break;
-                    case 5:
-                        prescaler = 32;
-                        break;
-                    case 6:
-                        prescaler = 64;
-                        break;
-                    case 7:
-                        prescaler = 128;
-                        break;
-                    }
-                    _adcCyclesRemaining = 13.0 * prescaler;
+                    std::uint8_t mux5 = (adcsrb & (1u << 3)) != 0 ? 8 : 0;
+                    channel = static_cast<std::uint8_t>(mux5 | (admux & 0x07));
+                }
+                else
+                {
+                    channel = static_cast<std::uint8_t>(admux & 0x0F);
+                }
+                float voltage = 0.0f;
+                if (channel < _analogInputs.size())
+                {
+                    voltage = _analogInputs[channel];
+                }
+                if (voltage < 0.0f)
+                    voltage = 0.0f;
+                float refVoltage = 5.0f;
+                std::uint8_t refs = static_cast<std::uint8_t>(admux & 0xC0);
+                if (refs == 0xC0)
+                {
+                    refVoltage = 1.1f;
+                }
+                if (refVoltage <= 0.001f)
+                    refVoltage = 5.0f;
+                if (voltage > refVoltage)
+                    voltage = refVoltage;
+                double scaled = (static_cast<double>(voltage) / refVoltage) * 1023.0;
+                _adcNoiseSeed = _adcNoiseSeed * 1664525u + 1013904223u;
+                int noise = static_cast<int>((_adcNoiseSeed >> 30) & 0x03) - 1;
+                if (noise > 1)
+                    noise = 1;
+                int value = static_cast<int>(scaled + 0.5) + noise;
+                if (value < 0)
+                    value = 0;
+                if (value > 1023)
+                    value = 1023;
+                bool adlar = (admux & (1u << 5)) != 0;
+                if (adlar)
+                {
+                    std::uint8_t adcl = static_cast<std::uint8_t>((value & 0x03) << 6);
+                    std::uint8_t adch = static_cast<std::uint8_t>((value >> 2) & 0xFF);
+                    AVR_IoWrite(&_state.core, AVR_ADCL, adcl);
+                    AVR_IoWrite(&_state.core, AVR_ADCH, adch);
+                }
+                else
+                {
+                    AVR_IoWrite(&_state.core, AVR_ADCL, static_cast<std::uint8_t>(value & 0xFF));
+                    AVR_IoWrite(&_state.core, AVR_ADCH, static_cast<std::uint8_t>((value >> 8) & 0x03));
                 }
+                _perf.adcSamples++;
+                adcsra = GetIo(AVR_ADCSRA);
+                adcsra = static_cast<std::uint8_t>(adcsra & ~(1u << 6));
+                AVR_IoWrite(&_state.core, AVR_ADCSRA, adcsra);
+                AVR_IoSetFlags(&_state.core, AVR_ADCSRA, 1u << 4);
             }
+        }
+
+        double elapsed = static_cast<double>(executed);
 
-            if (_adcCyclesRemaining > 0.0)
+        for (int channel = 0; channel < Board::UartCount; ++channel)
+        {
+            auto &uart = _uarts[static_cast<std::size_t>(channel)];
+            if (!IsUartTxEnabled(channel))
+            {
+                uart.txActive = false;
+                uart.txCyclesRemaining = 0.0;
+                uart.udrEmptyCyclesRemaining = 0.0;
+                std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
+                ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartDataRegisterEmptyBit));
+                AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
+            }
+            else
             {
-                _adcCyclesRemaining -= static_cast<double>(executed);
-                if (_adcCyclesRemaining <= 0.0)
+                double cyclesPerBit = ComputeUartCyclesPerBit(channel);
+                double cyclesPerByte = cyclesPerBit * 10.0;
+
+                if (uart.udrEmptyCyclesRemaining > 0.0)
                 {
-                    std::uint8_t admux = GetIo(AVR_ADMUX);
-                    std::uint8_t adcsrb = GetIo(AVR_ADCSRB);
-                    std::uint8_t channel = 0;
-                    if (_profile.mcu == "ATmega2560")
-                    {
-                        std::uint8_t mux5 = (adcsrb & (1u << 3)) != 0 ? 8 : 0;
-                        channel = static_cast<std::uint8_t>(mux5 | (admux & 0x07));
-                    }
-                    else
-                    {
-                        channel = static_cast<std::uint8_t>(admux & 0x0F);
-                    }
-                    float voltage = 0.0f;
-                    if (channel < _analogInputs.size())
-                    {
-                        voltage = _analogInputs[channel];
-                    }
-                    if (voltage < 0.0f)
-                        voltage = 0.0f;
-                    float refVoltage = 5.0f;
-                    std::uint8_t refs = static_cast<std::uint8_t>(admux & 0xC0);
-                    if (refs == 0xC0)
-                    {
-                        refVoltage = 1.1f;
-                    }
-                    if (refVoltage <= 0.001f)
-                        refVoltage = 5.0f;
-                    if (voltage > refVoltage)
-                        voltage = refVoltage;
-                    double scaled = (static_cast<double>(voltage) / refVoltage) * 1023.0;
-                    _adcNoiseSeed = _adcNoiseSeed * 1664525u + 1013904223u;
-                    int noise = static_cast<int>((_adcNoiseSeed >> 30) & 0x03) - 1;
-                    if (noise > 1)
-                        noise = 1;
-                    int value = static_cast<int>(scaled + 0.5) + noise;
-                    if (value < 0)
-                        value = 0;
-                    if (value > 1023)
-                        value = 1023;
-                    bool adlar = (admux & (1u << 5)) != 0;
-                    if (adlar)
+                    uart.udrEmptyCyclesRemaining -= elapsed;
+                    if (uart.udrEmptyCyclesRemaining < 0.0)
                     {
-                        std::uint8_t adcl = static_cast<std::uint8_t>((value & 0x03) << 6);
-                        std::uint8_t adch = static_cast<std::uint8_t>((value >> 2) & 0xFF);
-                        AVR_IoWrite(&_state.core, AVR_ADCL, adcl);
-                        AVR_IoWrite(&_state.core, AVR_ADCH, adch);
+                        uart.udrEmptyCyclesRemaining = 0.0;
                     }
-                    else
+                }
+
+                double txElapsed = elapsed;
+                while (txElapsed > 0.0)
+                {
+                    if (uart.txActive)
                     {
-                        AVR_IoWrite(&_state.core, AVR_ADCL, static_cast<std::uint8_t>(value & 0xFF));
-                        AVR_IoWrite(&_state.core, AVR_ADCH, static_cast<std::uint8_t>((value >> 8) & 0x03));
+                        if (uart.txCyclesRemaining > txElapsed)
+                        {
+                            uart.txCyclesRemaining -= txElapsed;
+                            txElapsed = 0.0;
+                            break;
+                        }
+
+                        txElapsed -= uart.txCyclesRemaining;
+                        uart.txCyclesRemaining = 0.0;
+                        uart.txActive = false;
+                        HandleUartWrite(channel, uart.txByte);
+                        std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
+                        if (uart.txPending.empty())
+                        {
+                            ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartTxCompleteBit));
+                        }
+                        AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
                     }
-                    _perf.adcSamples++;
-                    adcsra = GetIo(AVR_ADCSRA);
-                    adcsra = static_cast<std::uint8_t>(adcsra & ~(1u << 6));
-                    AVR_IoWrite(&_state.core, AVR_ADCSRA, adcsra);
-                    std::size_t adcsraIndex = static_cast<std::size_t>(AVR_ADCSRA - AVR_IO_BASE);
-                    if (adcsraIndex < _state.io.size())
+
+                    if (!uart.txActive && !uart.txPending.empty())
                     {
-                        _state.io[adcsraIndex] = static_cast<std::uint8_t>(_state.io[adcsraIndex] | (1u << 4));
+                        uart.txByte = uart.txPending.front();
+                        uart.txPending.pop_front();
+                        uart.txActive = true;
+                        uart.txCyclesRemaining = cyclesPerByte;
+                        uart.udrEmptyCyclesRemaining = cyclesPerBit;
+                        std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
+                        ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartTxCompleteBit));
+                        AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
+                        continue;
                     }
-                }
-            }
 
-            double elapsed = static_cast<double>(executed);
-
-            for (int channel = 0; channel < static_cast<int>(_uarts.size()); ++channel)
-            {
-                if (!HasUart(channel))
-                {
-                    continue;
+                    break;
                 }
 
-                auto &uart = _uarts[static_cast<std::size_t>(channel)];
-                if (!IsUartTxEnabled(channel))
+                std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
+                if (uart.txPending.empty() && uart.udrEmptyCyclesRemaining <= 0.0)
                 {
-                    uart.txActive = false;
-                    uart.txCyclesRemaining = 0.0;
-                    uart.udrEmptyCyclesRemaining = 0.0;
-                    std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
                     ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartDataRegisterEmptyBit));
-                    AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
                 }
                 else
                 {
-                    double cyclesPerBit = ComputeUartCyclesPerBit(channel);
-                    double cyclesPerByte = cyclesPerBit * 10.0;
+                    ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartDataRegisterEmptyBit));
+                }
+                AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
+            }
 
-                    if (uart.udrEmptyCyclesRemaining > 0.0)
+            if (!IsUartRxEnabled(channel))
+            {
+                uart.rxReady = false;
+                uart.rxCyclesRemaining = 0.0;
+                uart.rxQueue.clear();
+                std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
+                ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartRxCompleteBit));
+                ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartFrameErrorBit));
+                ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartParityErrorBit));
+                AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
+            }
+            else if (!uart.rxReady)
+            {
+                double cyclesPerByte = ComputeUartCyclesPerByte(channel);
+                double rxElapsed = elapsed;
+                while (rxElapsed > 0.0 && !uart.rxReady)
+                {
+                    if (uart.rxCyclesRemaining <= 0.0)
                     {
-                        uart.udrEmptyCyclesRemaining -= elapsed;
-                        if (uart.udrEmptyCyclesRemaining < 0.0)
+                        if (uart.rxQueue.empty())
                         {
-                            uart.udrEmptyCyclesRemaining = 0.0;
+                            break;
                         }
+                        uart.rxCyclesRemaining = cyclesPerByte;
                     }
 
-                    double txElapsed = elapsed;
-                    while (txElapsed > 0.0)
+                    if (uart.rxCyclesRemaining > rxElapsed)
                     {
-                        if (uart.txActive)
-                        {
-                            if (uart.txCyclesRemaining > txElapsed)
-                            {
-                                uart.txCyclesRemaining -= txElapsed;
-                                txElapsed = 0.0;
-                                break;
-                            }
-
-                            txElapsed -= uart.txCyclesRemaining;
-                            uart.txCyclesRemaining = 0.0;
-                            uart.txActive = false;
-                            HandleUartWrite(channel, uart.txByte);
-                            std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
-                            if (uart.txPending.empty())
-                            {
-                                ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartTxCompleteBit));
-                            }
-                            AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
-                        }
-
-                        if (!uart.txActive && !uart.txPending.empty())
-                        {
-                            uart.txByte = uart.txPending.front();
-                            uart.txPending.pop_front();
-                            uart.txActive = true;
-                            uart.txCyclesRemaining = cyclesPerByte;
-                            uart.udrEmptyCyclesRemaining = cyclesPerBit;
-                            std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
-                            ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartTxCompleteBit));
-                            AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
-                            continue;
-                        }
-
+                        uart.rxCyclesRemaining -= rxElapsed;
+                        rxElapsed = 0.0;
                         break;
                     }
 
-                    std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
-                    if (uart.txPending.empty() && uart.udrEmptyCyclesRemaining <= 0.0)
-                    {
-                        ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartDataRegisterEmptyBit));
-                    }
-                    else
-                    {
-                        ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartDataRegisterEmptyBit));
-                    }
-                    AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
-                }
-
-                if (!IsUartRxEnabled(channel))
-                {
-                    uart.rxReady = false;
+                    rxElapsed -= uart.rxCyclesRemaining;
                     uart.rxCyclesRemaining = 0.0;
-                    uart.rxQueue.clear();
-                    std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
-                    ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartRxCompleteBit));
-                    ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartFrameErrorBit));
-                    ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartParityErrorBit));
-                    AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
-                }
-                else if (!uart.rxReady)
-                {
-                    double cyclesPerByte = ComputeUartCyclesPerByte(channel);
-                    double rxElapsed = elapsed;
-                    while (rxElapsed > 0.0 && !uart.rxReady)
+                    if (!uart.rxQueue.empty())
                     {
-                        if (uart.rxCyclesRemaining <= 0.0)
+                        std::uint8_t next = uart.rxQueue.front();
+                        uart.rxQueue.pop_front();
+                        _perf.uartRxBytes[static_cast<std::size_t>(channel)]++;
+
+                        std::uint8_t ucsrc = GetIo(UcsrCAddress[channel]);
+                        bool parityEnabled = IsUartParityEnabled(channel);
+                        bool twoStopBits = (ucsrc & (1u << 3)) != 0;
+
+                        ++uart.rxCount;
+                        std::uint32_t seed = NextUartErrorSeed(channel, next);
+                        bool frameError = (seed & (twoStopBits ? 0x3FFu : 0x1FFu)) == 0;
+                        bool parityError = false;
+                        if (parityEnabled)
                         {
-                            if (uart.rxQueue.empty())
+                            parityError = (((seed >> 10) & 0x7Fu) == 0);
+                            if (parityError)
                             {
-                                break;
+                                next = static_cast<std::uint8_t>(next ^ 0x01);
                             }
-                            uart.rxCyclesRemaining = cyclesPerByte;
                         }
 
-                        if (uart.rxCyclesRemaining > rxElapsed)
+                        AVR_IoWrite(&_state.core, UdrAddress[channel], next);
+                        uart.rxReady = true;
+                        std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
+                        ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartRxCompleteBit));
+                        ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartFrameErrorBit));
+                        ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartParityErrorBit));
+                        if (frameError)
                         {
-                            uart.rxCyclesRemaining -= rxElapsed;
-                            rxElapsed = 0.0;
-                            break;
+                            ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartFrameErrorBit));
                         }
-
-                        rxElapsed -= uart.rxCyclesRemaining;
-                        uart.rxCyclesRemaining = 0.0;
-                        if (!uart.rxQueue.empty())
+                        if (parityError)
                         {
-                            std::uint8_t next = uart.rxQueue.front();
-                            uart.rxQueue.pop_front();
-                            _perf.uartRxBytes[static_cast<std::size_t>(channel)]++;
-
-                            std::uint8_t ucsrc = GetIo(UcsrCAddress[channel]);
-                            bool parityEnabled = IsUartParityEnabled(channel);
-                            bool twoStopBits = (ucsrc & (1u << 3)) != 0;
-
-                            ++uart.rxCount;
-                            std::uint32_t seed = NextUartErrorSeed(channel, next);
-                            bool frameError = (seed & (twoStopBits ? 0x3FFu : 0x1FFu)) == 0;
-                            bool parityError = false;
-                            if (parityEnabled)
-                            {
-                                parityError = (((seed >> 10) & 0x7Fu) == 0);
-                                if (parityError)
-                                {
-                                    next = static_cast<std::uint8_t>(next ^ 0x01);
-                                }
-                            }
-
-                            AVR_IoWrite(&_state.core, UdrAddress[channel], next);
-                            uart.rxReady = true;
-                            std::uint8_t ucsra = GetIo(UcsrAAddress[channel]);
-                            ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartRxCompleteBit));
-                            ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartFrameErrorBit));
-                            ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartParityErrorBit));
-                            if (frameError)
-                            {
-                                ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartFrameErrorBit));
-                            }
-                            if (parityError)
-                            {
-                                ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartParityErrorBit));
-                            }
-                            AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
+                            ucsra = static_cast<std::uint8_t>(ucsra | (1u << UartParityErrorBit));
                         }
+                        AVR_IoWrite(&_state.core, UcsrAAddress[channel], ucsra);
                     }
                 }
             }
+        }
 
-            std::uint8_t spcr = GetIo(AVR_SPCR);
-            bool spiEnabled = (spcr & (1u << 6)) != 0;
-            if (!spiEnabled)
+        std::uint8_t spcr = GetIo(AVR_SPCR);
+        bool spiEnabled = (spcr & (1u << 6)) != 0;
+        if (!spiEnabled)
+        {
+            _spiActive = false;
+            _spiCyclesRemaining = 0.0;
+        }
+        if (_spiActive)
+        {
+            _spiCyclesRemaining -= elapsed;
+            if (_spiCyclesRemaining <= 0.0)
             {
                 _spiActive = false;
                 _spiCyclesRemaining = 0.0;
+                AVR_IoWrite(&_state.core, AVR_SPDR, _spiData);
+                std::uint8_t spsr = GetIo(AVR_SPSR);
+                spsr = static_cast<std::uint8_t>(spsr | (1u << 7));
+                AVR_IoWrite(&_state.core, AVR_SPSR, spsr);
+                _perf.spiTransfers++;
             }
-            if (_spiActive)
-            {
-                _spiCyclesRemaining -= elapsed;
-                if (_spiCyclesRemaining <= 0.0)
-                {
-                    _spiActive = false;
-                    _spiCyclesRemaining = 0.0;
-                    AVR_IoWrite(&_state.core, AVR_SPDR, _spiData);
-                    std::uint8_t spsr = GetIo(AVR_SPSR);
-                    spsr = static_cast<std::uint8_t>(spsr | (1u << 7));
-                    AVR_IoWrite(&_state.core, AVR_SPSR, spsr);
-                    _perf.spiTransfers++;
-                }
-            }
+        }
 
-            std::uint8_t twcr = GetIo(AVR_TWCR);
-            bool twiEnabled = (twcr & (1u << 2)) != 0;
-            if (!twiEnabled)
+        std::uint8_t twcr = GetIo(AVR_TWCR);
+        bool twiEnabled = (twcr & (1u << 2)) != 0;
+        if (!twiEnabled)
+        {
+            _twiActive = false;
+            _twiCyclesRemaining = 0.0;
+        }
+        if (_twiActive)
+        {
+            _twiCyclesRemaining -= elapsed;
+            if (_twiCyclesRemaining <= 0.0)
             {
                 _twiActive = false;
                 _twiCyclesRemaining = 0.0;
-            }
-            if (_twiActive)
-            {
-                _twiCyclesRemaining -= elapsed;
-                if (_twiCyclesRemaining <= 0.0)
-                {
-                    _twiActive = false;
-                    _twiCyclesRemaining = 0.0;
-                    AVR_IoWrite(&_state.core, AVR_TWDR, _twiData);
-                    std::uint8_t twcr = GetIo(AVR_TWCR);
-                    bool ack = (twcr & (1u << 6)) != 0;
-                    if (_twiStatus == 0xF8)
-                    {
-                        _twiStatus = ack ? 0x28 : 0x30;
-                    }
-                    std::uint8_t twsr = GetIo(AVR_TWSR);
-                    twsr = static_cast<std::uint8_t>((twsr & 0x03) | (_twiStatus & 0xF8));
-                    AVR_IoWrite(&_state.core, AVR_TWSR, twsr);
-                    twcr = static_cast<std::uint8_t>(twcr | (1u << 7));
-                    std::size_t twcrIdx = static_cast<std::size_t>(AVR_TWCR - AVR_IO_BASE);
-                    if (twcrIdx < _state.io.size())
-                    {
-                        _state.io[twcrIdx] = twcr;
-                    }
-                    _perf.twiTransfers++;
-                    _twiStatus = 0xF8;
-                }
-            }
-
-            std::uint8_t wdtcsr = GetIo(AVR_WDTCSR);
-            bool wdtEnable = (wdtcsr & (1u << 3)) != 0 || (wdtcsr & (1u << 6)) != 0;
-            if (wdtEnable)
-            {
-                if (_wdtCyclesRemaining <= 0.0)
+                AVR_IoWrite(&_state.core, AVR_TWDR, _twiData);
+                std::uint8_t twcr = GetIo(AVR_TWCR);
+                bool ack = (twcr & (1u << 6)) != 0;
+                if (_twiStatus == 0xF8)
                 {
-                    int wdp = (wdtcsr & 0x07) | ((wdtcsr >> 5) & 0x01) * 8;
-                    static const double kTimeouts[] = {0.016, 0.032, 0.064, 0.125, 0.25, 0.5, 1.0, 2.0, 4.0, 8.0};
-                    int idx = wdp;
-                    if (idx < 0)
-                        idx = 0;
-                    if (idx > 9)
-                        idx = 9;
-                    _wdtCyclesRemaining = kTimeouts[idx] * _profile.cpu_hz;
+                    _twiStatus = ack ? 0x28 : 0x30;
                 }
-                _wdtCyclesRemaining -= elapsed;
-                if (_wdtCyclesRemaining <= 0.0)
+                std::uint8_t twsr = GetIo(AVR_TWSR);
+                twsr = static_cast<std::uint8_t>((twsr & 0x03) | (_twiStatus & 0xF8));
+                AVR_IoWrite(&_state.core, AVR_TWSR, twsr);
+                twcr = static_cast<std::uint8_t>(twcr | (1u << 7));
+                std::size_t twcrIdx = static_cast<std::size_t>(AVR_TWCR - AVR_IO_BASE);
+                if (twcrIdx < _state.io.size())
                 {
-                    wdtcsr = static_cast<std::uint8_t>(wdtcsr | (1u << 7));
-                    AVR_IoWrite(&_state.core, AVR_WDTCSR, wdtcsr);
-                    if (wdtcsr & (1u << 3))
-                    {
-                        _wdtResetArmed = true;
-                    }
-                    _wdtCyclesRemaining = 0.0;
+                    _state.io[twcrIdx] = twcr;
+                    AVR_UpdateInterrupts(&_state.core);
                 }
+                _perf.twiTransfers++;
+                _twiStatus = 0xF8;
             }
+        }
 
-            if (_wdtResetArmed)
+        std::uint8_t wdtcsr = GetIo(AVR_WDTCSR);
+        bool wdtEnable = (wdtcsr & (1u << 3)) != 0 || (wdtcsr & (1u << 6)) != 0;
+        if (wdtEnable)
+        {
+            if (_wdtCyclesRemaining <= 0.0)
             {
-                _perf.wdtResets++;
-                Reset();
+                int wdp = (wdtcsr & 0x07) | ((wdtcsr >> 5) & 0x01) * 8;
+                int idx = wdp;
+                if (idx < 0)
+                    idx = 0;
+                if (idx > 9)
+                    idx = 9;
+                _wdtCyclesRemaining = WdtTimeouts[idx] * _profile.cpu_hz;
+            }
+            _wdtCyclesRemaining -= elapsed;
+            if (_wdtCyclesRemaining <= 0.0)
+            {
+                wdtcsr = static_cast<std::uint8_t>(wdtcsr | (1u << 7));
+                AVR_IoWrite(&_state.core, AVR_WDTCSR, wdtcsr);
+                if (wdtcsr & (1u << 3))
+                {
+                    _wdtResetArmed = true;
+                }
+                _wdtCyclesRemaining = 0.0;
             }
         }
     }
 
+
     void VirtualMcu::SetInputPin(int pin, int value)
     {
         if (pin < 0 || pin >= static_cast<int>(_pinInputs.size()))
@@ -1224,11 +1424,11 @@ namespace firmware
         {
             pcifr = static_cast<std::uint8_t>(pcifr | (1u << 2));
         }
-        AVR_IoWrite(&_state.core, AVR_PCIFR, pcifr);
+        AVR_IoSetFlags(&_state.core, AVR_PCIFR, pcifr);
 
         std::uint8_t eimsk = GetIo(AVR_EIMSK);
         std::uint8_t eifr = GetIo(AVR_EIFR);
-        if (_profile.mcu == "ATmega2560")
+        if (IsMega2560())
         {
             if ((eimsk & 0x01) && ((pine ^ _lastPine) & (1u << 4)))
             {
@@ -1250,7 +1450,7 @@ namespace firmware
                 eifr = static_cast<std::uint8_t>(eifr | 0x02);
             }
         }
-        AVR_IoWrite(&_state.core, AVR_EIFR, eifr);
+        AVR_IoSetFlags(&_state.core, AVR_EIFR, eifr);
 
         _lastPinb = pinb;
         _lastPinc = pinc;
@@ -1288,15 +1488,7 @@ namespace firmware
 
     bool VirtualMcu::HasUart(int channel) const
     {
-        if (channel < 0 || channel >= static_cast<int>(_uarts.size()))
-        {
-            return false;
-        }
-        if (_profile.mcu == "ATmega2560")
-        {
-            return true;
-        }
-        return channel == 0;
+        return channel >= 0 && channel < _uartCount;
     }
 
     double VirtualMcu::ComputeUartCyclesPerByte(int channel)
@@ -1477,7 +1669,7 @@ namespace firmware
         if (pin < 0)
             return false;
 
-        if (_profile.mcu == "ATmega2560")
+        if (IsMega2560())
         {
             // Arduino Mega2560 pin map (D0-D53, A0-A15)
             if (pin >= 0 && pin <= 53)
@@ -1729,168 +1921,183 @@ namespace firmware
     void VirtualMcu::IoWriteHook(AvrCore *core, std::uint16_t address, std::uint8_t value, void *user)
     {
         (void)core;
-        if (!user)
+        if (!user || address >= AVR_IO_SYNC_END)
             return;
         auto *self = static_cast<VirtualMcu *>(user);
+        IoWriteHandler handler = self->_ioWriteHandlers[address];
+        if (handler)
+        {
+            (self->*handler)(address, value);
+        }
+    }
+
+    void VirtualMcu::RegisterIoWriteHandlers()
+    {
+        _ioWriteHandlers.fill(nullptr);
+        _ioWriteHandlers[AVR_EECR] = &VirtualMcu::OnEecrWrite;
+        _ioWriteHandlers[AVR_WDTCSR] = &VirtualMcu::OnWdtcsrWrite;
+        _ioWriteHandlers[AVR_SMCR] = &VirtualMcu::OnSmcrWrite;
+        _ioWriteHandlers[AVR_SPDR] = &VirtualMcu::OnSpdrWrite;
+        _ioWriteHandlers[AVR_TWDR] = &VirtualMcu::OnTwdrWrite;
+        _ioWriteHandlers[AVR_TWCR] = &VirtualMcu::OnTwcrWrite;
+        for (int i = 0; i < static_cast<int>(_uarts.size()); ++i)
+        {
+            _ioWriteHandlers[UcsrAAddress[i]] = &VirtualMcu::OnUcsrAWrite;
+            _ioWriteHandlers[UdrAddress[i]] = &VirtualMcu::OnUdrWrite;
+        }
+        // Everything else (ports, timers, the stack pointer) is a plain store
+        for (std::uint16_t address = AVR_IO_BASE; address < AVR_IO_SYNC_END; ++address)
+        {
+            AVR_SetIoWriteNotify(&_state.core, address, _ioWriteHandlers[address] != nullptr);
+        }
+    }
 
+    void VirtualMcu::OnEecrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        (void)address;
         // Track EEPROM writes for wear monitoring
-        if (address >= AVR_EEARL && address <= AVR_EEDR)
+        if (value & (1u << 1)) // EEPE bit set
         {
-            if (address == AVR_EECR && (value & (1u << 1))) // EEPE bit set
+            _perf.eepromWrites++;
+            std::uint16_t eepromAddr = static_cast<std::uint16_t>(
+                GetIo(AVR_EEARL) | (GetIo(AVR_EEARH) << 8));
+            if (eepromAddr < _eepromWriteCount.size())
             {
-                self->_perf.eepromWrites++;
-                std::uint16_t eepromAddr = static_cast<std::uint16_t>(
-                    self->GetIo(AVR_EEARL) | (self->GetIo(AVR_EEARH) << 8));
-                if (eepromAddr < self->_eepromWriteCount.size())
+                _eepromWriteCount[eepromAddr]++;
+                // Warn if approaching endurance limit (100k writes typical)
+                if (_eepromWriteCount[eepromAddr] > 90000)
                 {
-                    self->_eepromWriteCount[eepromAddr]++;
-                    // Warn if approaching endurance limit (100k writes typical)
-                    if (self->_eepromWriteCount[eepromAddr] > 90000)
-                    {
-                        // Could log warning here
-                    }
+                    // Could log warning here
                 }
             }
         }
+    }
+
+    void VirtualMcu::OnWdtcsrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        (void)address;
+        _watchdogEnabled = (value & (1u << 3)) != 0; // WDE bit
+        // Calculate timeout from prescaler bits WDP3:0
+        std::uint8_t wdp = ((value & 0x20) >> 2) | (value & 0x07);
+        // Watchdog timeout = 2K * 2^wdp cycles at 128kHz oscillator
+        // At 16MHz CPU: timeout_cycles = (2048 * (1 << wdp)) * (16000000 / 128000)
+        _watchdogTimeout = (2048ULL << wdp) * 125ULL;
+        _watchdogCounter = 0; // Reset counter on config change
+        _wdtCyclesRemaining = 0.0;
+        _wdtResetArmed = false;
+    }
+
+    void VirtualMcu::OnSmcrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        (void)address;
+        _sleepMode = (value >> 1) & 0x07;
+        _sleepEnabled = (value & 0x01) != 0;
+    }
 
-        // Monitor watchdog timer configuration
-        if (address == AVR_WDTCSR)
+    void VirtualMcu::OnSpdrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        (void)address;
+        std::uint8_t spcr = GetIo(AVR_SPCR);
+        if (!(spcr & (1u << 6)))
+            return;
+        std::uint8_t spsr = GetIo(AVR_SPSR);
+        bool spif = (spsr & (1u << 7)) != 0;
+        if (_spiActive || spif)
         {
-            self->_watchdogEnabled = (value & (1u << 3)) != 0; // WDE bit
-            // Calculate timeout from prescaler bits WDP3:0
-            std::uint8_t wdp = ((value & 0x20) >> 2) | (value & 0x07);
-            // Watchdog timeout = 2K * 2^wdp cycles at 128kHz oscillator
-            // At 16MHz CPU: timeout_cycles = (2048 * (1 << wdp)) * (16000000 / 128000)
-            self->_watchdogTimeout = (2048ULL << wdp) * 125ULL;
-            self->_watchdogCounter = 0; // Reset counter on config change
+            spsr = static_cast<std::uint8_t>(spsr | (1u << 6));
+            AVR_IoWrite(&_state.core, AVR_SPSR, spsr);
         }
-
-        // Monitor sleep mode configuration
-        if (address == AVR_SMCR)
+        else
         {
-            self->_sleepMode = (value >> 1) & 0x07;
-            self->_sleepEnabled = (value & 0x01) != 0;
+            spsr = static_cast<std::uint8_t>(spsr & ~(1u << 7));
+            spsr = static_cast<std::uint8_t>(spsr & ~(1u << 6));
+            AVR_IoWrite(&_state.core, AVR_SPSR, spsr);
+            _spiData = value;
+            _spiActive = true;
+            _spiCyclesRemaining = ComputeSpiCyclesPerBit() * 8.0;
+            _spiSpsrRead = false;
         }
+    }
 
-        if (address == AVR_SPDR)
+    void VirtualMcu::OnTwdrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        (void)address;
+        std::uint8_t twcr = GetIo(AVR_TWCR);
+        if (!(twcr & (1u << 2)))
+            return;
+        if (_twiActive)
         {
-            std::uint8_t spcr = self->GetIo(AVR_SPCR);
-            if (spcr & (1u << 6))
-            {
-                std::uint8_t spsr = self->GetIo(AVR_SPSR);
-                bool spif = (spsr & (1u << 7)) != 0;
-                if (self->_spiActive || spif)
-                {
-                    spsr = static_cast<std::uint8_t>(spsr | (1u << 6));
-                    AVR_IoWrite(&self->_state.core, AVR_SPSR, spsr);
-                }
-                else
-                {
-                    spsr = static_cast<std::uint8_t>(spsr & ~(1u << 7));
-                    spsr = static_cast<std::uint8_t>(spsr & ~(1u << 6));
-                    AVR_IoWrite(&self->_state.core, AVR_SPSR, spsr);
-                    self->_spiData = value;
-                    self->_spiActive = true;
-                    self->_spiCyclesRemaining = self->ComputeSpiCyclesPerBit() * 8.0;
-                    self->_spiSpsrRead = false;
-                }
-            }
+            twcr = static_cast<std::uint8_t>(twcr | (1u << 3));
+            _twiStatus = 0x38;
+            AVR_IoWrite(&_state.core, AVR_TWCR, twcr);
         }
-        if (address == AVR_TWDR)
+        else
         {
-            std::uint8_t twcr = self->GetIo(AVR_TWCR);
-            if (twcr & (1u << 2))
-            {
-                if (self->_twiActive)
-                {
-                    twcr = static_cast<std::uint8_t>(twcr | (1u << 3));
-                    self->_twiStatus = 0x38;
-                    AVR_IoWrite(&self->_state.core, AVR_TWCR, twcr);
-                }
-                else
-                {
-                    self->_twiData = value;
-                    self->_twiActive = true;
-                    self->_twiCyclesRemaining = self->ComputeTwiCyclesPerBit() * 9.0;
-                    twcr = static_cast<std::uint8_t>(twcr & ~(1u << 7));
-                    AVR_IoWrite(&self->_state.core, AVR_TWCR, twcr);
-                }
-            }
+            _twiData = value;
+            _twiActive = true;
+            _twiCyclesRemaining = ComputeTwiCyclesPerBit() * 9.0;
+            twcr = static_cast<std::uint8_t>(twcr & ~(1u << 7));
+            AVR_IoWrite(&_state.core, AVR_TWCR, twcr);
         }
-        if (address == AVR_TWCR)
+    }
+
+    void VirtualMcu::OnTwcrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        std::uint8_t twcr = value;
+        if ((twcr & (1u << 2)) != 0)
         {
-            std::uint8_t twcr = value;
-            if ((twcr & (1u << 2)) != 0)
-            {
-                if (twcr & (1u << 5))
-                {
-                    self->_twiStatus = 0x08;
-                    twcr = static_cast<std::uint8_t>(twcr & ~(1u << 5));
-                    twcr = static_cast<std::uint8_t>(twcr | (1u << 7));
-                }
-                else if (twcr & (1u << 4))
-                {
-                    self->_twiStatus = 0x10;
-                    twcr = static_cast<std::uint8_t>(twcr & ~(1u << 4));
-                    twcr = static_cast<std::uint8_t>(twcr | (1u << 7));
-                }
-            }
-            if (twcr & (1u << 7))
+            if (twcr & (1u << 5))
             {
-                twcr = static_cast<std::uint8_t>(twcr & ~(1u << 7));
+                _twiStatus = 0x08;
+                twcr = static_cast<std::uint8_t>(twcr & ~(1u << 5));
+                twcr = static_cast<std::uint8_t>(twcr | (1u << 7));
             }
-            std::size_t idx = static_cast<std::size_t>(AVR_TWCR - AVR_IO_BASE);
-            if (idx < self->_state.io.size())
+            else if (twcr & (1u << 4))
             {
-                self->_state.io[idx] = twcr;
+                _twiStatus = 0x10;
+                twcr = static_cast<std::uint8_t>(twcr & ~(1u << 4));
+                twcr = static_cast<std::uint8_t>(twcr | (1u << 7));
             }
-            return;
         }
-        if (address == AVR_WDTCSR)
+        if (twcr & (1u << 7))
         {
-            self->_wdtCyclesRemaining = 0.0;
-            self->_wdtResetArmed = false;
+            twcr = static_cast<std::uint8_t>(twcr & ~(1u << 7));
         }
-        int uartIndex = -1;
-        for (int i = 0; i < static_cast<int>(self->_uarts.size()); ++i)
+        std::size_t idx = static_cast<std::size_t>(address - AVR_IO_BASE);
+        if (idx < _state.io.size())
         {
-            if (address == UcsrAAddress[i])
-            {
-                uartIndex = i;
-                if (value & (1u << UartTxCompleteBit))
-                {
-                    std::size_t idx = static_cast<std::size_t>(address - AVR_IO_BASE);
-                    if (idx < self->_state.io.size())
-                    {
-                        self->_state.io[idx] = static_cast<std::uint8_t>(self->_state.io[idx] & ~(1u << UartTxCompleteBit));
-                    }
-                }
-                return;
-            }
+            _state.io[idx] = twcr;
         }
+    }
 
-        for (int i = 0; i < static_cast<int>(self->_uarts.size()); ++i)
+    void VirtualMcu::OnUcsrAWrite(std::uint16_t address, std::uint8_t value)
+    {
+        if (value & (1u << UartTxCompleteBit))
         {
-            if (address != UdrAddress[i])
+            std::size_t idx = static_cast<std::size_t>(address - AVR_IO_BASE);
+            if (idx < _state.io.size())
             {
-                continue;
+                _state.io[idx] = static_cast<std::uint8_t>(_state.io[idx] & ~(1u << UartTxCompleteBit));
             }
-            uartIndex = i;
-            break;
         }
-        if (uartIndex < 0 || !self->HasUart(uartIndex))
-            return;
-        if (!self->IsUartTxEnabled(uartIndex))
+    }
+
+    void VirtualMcu::OnUdrWrite(std::uint16_t address, std::uint8_t value)
+    {
+        int uartIndex = 0;
+        while (UdrAddress[uartIndex] != address)
         {
-            return;
+            ++uartIndex;
         }
-        auto &uart = self->_uarts[static_cast<std::size_t>(uartIndex)];
+        if (!HasUart(uartIndex) || !IsUartTxEnabled(uartIndex))
+            return;
+        auto &uart = _uarts[static_cast<std::size_t>(uartIndex)];
         if (!uart.txActive && uart.txPending.empty())
         {
             uart.txByte = value;
             uart.txActive = true;
-            uart.txCyclesRemaining = self->ComputeUartCyclesPerByte(uartIndex);
-            uart.udrEmptyCyclesRemaining = self->ComputeUartCyclesPerBit(uartIndex);
+            uart.txCyclesRemaining = ComputeUartCyclesPerByte(uartIndex);
+            uart.udrEmptyCyclesRemaining = ComputeUartCyclesPerBit(uartIndex);
         }
         else if (uart.txPending.empty())
         {
@@ -1900,10 +2107,23 @@ namespace firmware
         {
             uart.txPending.back() = value;
         }
-        std::uint8_t ucsra = self->GetIo(UcsrAAddress[uartIndex]);
+        std::uint8_t ucsra = GetIo(UcsrAAddress[uartIndex]);
         ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartDataRegisterEmptyBit));
         ucsra = static_cast<std::uint8_t>(ucsra & ~(1u << UartTxCompleteBit));
-        AVR_IoWrite(&self->_state.core, UcsrAAddress[uartIndex], ucsra);
+        AVR_IoWrite(&_state.core, UcsrAAddress[uartIndex], ucsra);
+    }
+
+    void VirtualMcu::IoSyncHook(AvrCore *core, std::uint16_t address, void *user)
+    {
+        (void)core;
+        if (!user || !IsScheduledRegister(address))
+            return;
+        auto *self = static_cast<VirtualMcu *>(user);
+        // Peripherals catch up to this instruction before it sees or changes
+        // them; the access may move the next event, so StepCycles reschedules
+        // after the block.
+        self->SyncPeripherals();
+        self->_scheduleDirty = true;
     }
 
     void VirtualMcu::IoReadHook(AvrCore *core, std::uint16_t address, std::uint8_t value, void *user)
@@ -1928,6 +2148,7 @@ namespace firmware
             if (idx < self->_state.io.size())
             {
                 self->_state.io[idx] = value;
+                AVR_UpdateInterrupts(&self->_state.core);
             }
         };
         if (address == AVR_SPSR)
@@ -2027,51 +2248,49 @@ namespace firmware
         {
             top = ocr0a;
         }
-        bool wrapped = false;
+        std::uint64_t wraps = 0;
 
         if (phaseCorrect)
         {
-            auto advancePhase = [](std::uint8_t start, std::uint64_t steps, bool &up, std::uint8_t top, bool &wrappedOut)
+            auto advancePhase = [](std::uint8_t start, std::uint64_t steps, bool &up, std::uint8_t top, std::uint64_t &wrapsOut)
             {
                 if (top == 0)
                 {
-                    wrappedOut = steps > 0;
+                    wrapsOut = steps;
                     return static_cast<std::uint8_t>(0);
                 }
                 std::uint32_t period = static_cast<std::uint32_t>(top) * 2u;
                 if (period == 0)
                 {
-                    wrappedOut = false;
+                    wrapsOut = 0;
                     return start;
                 }
                 std::uint32_t pos = up ? start : (period - start);
                 std::uint32_t move = static_cast<std::uint32_t>(steps % period);
                 std::uint32_t newPos = pos + move;
-                wrappedOut = steps >= period;
+                wrapsOut = (pos + steps) / period;
                 if (newPos >= period)
                 {
-                    wrappedOut = true;
                     newPos %= period;
                 }
                 up = newPos <= top;
                 return static_cast<std::uint8_t>(up ? newPos : (period - newPos));
             };
-            counter = advancePhase(counter, ticks, _timer0Up, top, wrapped);
+            counter = advancePhase(counter, ticks, _timer0Up, top, wraps);
         }
         else
         {
             std::uint16_t span = static_cast<std::uint16_t>(top) + 1u;
             std::uint64_t total = static_cast<std::uint64_t>(counter) + ticks;
             counter = static_cast<std::uint8_t>(span == 0 ? 0 : (total % span));
-            wrapped = span > 0 && total >= span;
+            wraps = span == 0 ? 0 : total / span;
         }
 
         AVR_IoWrite(&_state.core, AVR_TCNT0, counter);
-        if (wrapped)
+        if (wraps > 0)
         {
-            std::uint8_t tifr0 = GetIo(AVR_TIFR0);
-            tifr0 = static_cast<std::uint8_t>(tifr0 | 0x01);
-            AVR_IoWrite(&_state.core, AVR_TIFR0, tifr0);
+            _perf.timerOverflows += wraps;
+            AVR_IoSetFlags(&_state.core, AVR_TIFR0, 0x01);
         }
 
         auto crossed8 = [](std::uint8_t start, std::uint8_t end, std::uint8_t target)
@@ -2103,30 +2322,22 @@ namespace firmware
         {
             if (anyCycle || crossedPhase8(prev, counter, ocr0a))
             {
-                std::uint8_t tifr0 = GetIo(AVR_TIFR0);
-                tifr0 = static_cast<std::uint8_t>(tifr0 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR0, tifr0);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR0, 1u << 1);
             }
             if (anyCycle || crossedPhase8(prev, counter, ocr0b))
             {
-                std::uint8_t tifr0 = GetIo(AVR_TIFR0);
-                tifr0 = static_cast<std::uint8_t>(tifr0 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR0, tifr0);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR0, 1u << 2);
             }
         }
         else
         {
             if (anyCycle || crossed8(prev, counter, ocr0a))
             {
-                std::uint8_t tifr0 = GetIo(AVR_TIFR0);
-                tifr0 = static_cast<std::uint8_t>(tifr0 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR0, tifr0);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR0, 1u << 1);
             }
             if (anyCycle || crossed8(prev, counter, ocr0b))
             {
-                std::uint8_t tifr0 = GetIo(AVR_TIFR0);
-                tifr0 = static_cast<std::uint8_t>(tifr0 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR0, tifr0);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR0, 1u << 2);
             }
         }
 
@@ -2136,7 +2347,7 @@ namespace firmware
         bool com0a = (tccr0a & (1u << 7)) != 0;
         bool com0b = (tccr0a & (1u << 5)) != 0;
 
-        if (_profile.mcu == "ATmega2560")
+        if (IsMega2560())
         {
             std::uint8_t ddrb = GetIo(AVR_DDRB);
             std::uint8_t portb = GetIo(AVR_PORTB);
@@ -2293,47 +2504,45 @@ namespace firmware
             top = 0xFFFF;
             break;
         }
-        bool wrapped = false;
+        std::uint64_t wraps = 0;
 
         if (phaseCorrect)
         {
-            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, bool &wrappedOut)
+            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, std::uint64_t &wrapsOut)
             {
                 std::uint32_t period = static_cast<std::uint32_t>(top) * 2u;
                 if (period == 0)
                 {
-                    wrappedOut = false;
+                    wrapsOut = 0;
                     return start;
                 }
                 std::uint32_t pos = up ? start : (period - start);
                 std::uint32_t move = static_cast<std::uint32_t>(steps % period);
                 std::uint32_t newPos = pos + move;
-                wrappedOut = steps >= period;
+                wrapsOut = (pos + steps) / period;
                 if (newPos >= period)
                 {
-                    wrappedOut = true;
                     newPos %= period;
                 }
                 up = newPos <= top;
                 return static_cast<std::uint16_t>(up ? newPos : (period - newPos));
             };
-            counter = advancePhase(counter, ticks, _timer1Up, top, wrapped);
+            counter = advancePhase(counter, ticks, _timer1Up, top, wraps);
         }
         else
         {
             std::uint32_t span = static_cast<std::uint32_t>(top) + 1u;
             std::uint64_t total = static_cast<std::uint64_t>(counter) + ticks;
             counter = static_cast<std::uint16_t>(span == 0 ? 0 : (total % span));
-            wrapped = span > 0 && total >= span;
+            wraps = span == 0 ? 0 : total / span;
         }
 
         AVR_IoWrite(&_state.core, AVR_TCNT1L, static_cast<std::uint8_t>(counter & 0xFF));
         AVR_IoWrite(&_state.core, AVR_TCNT1H, static_cast<std::uint8_t>((counter >> 8) & 0xFF));
-        if (wrapped)
+        if (wraps > 0)
         {
-            std::uint8_t tifr1 = GetIo(AVR_TIFR1);
-            tifr1 = static_cast<std::uint8_t>(tifr1 | 0x01);
-            AVR_IoWrite(&_state.core, AVR_TIFR1, tifr1);
+            _perf.timerOverflows += wraps;
+            AVR_IoSetFlags(&_state.core, AVR_TIFR1, 0x01);
         }
 
         auto crossed16 = [](std::uint16_t start, std::uint16_t end, std::uint16_t target)
@@ -2365,30 +2574,22 @@ namespace firmware
         {
             if (anyCycle || crossedPhase16(prev, counter, ocr1a))
             {
-                std::uint8_t tifr1 = GetIo(AVR_TIFR1);
-                tifr1 = static_cast<std::uint8_t>(tifr1 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR1, tifr1);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR1, 1u << 1);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr1b))
             {
-                std::uint8_t tifr1 = GetIo(AVR_TIFR1);
-                tifr1 = static_cast<std::uint8_t>(tifr1 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR1, tifr1);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR1, 1u << 2);
             }
         }
         else
         {
             if (anyCycle || crossed16(prev, counter, ocr1a))
             {
-                std::uint8_t tifr1 = GetIo(AVR_TIFR1);
-                tifr1 = static_cast<std::uint8_t>(tifr1 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR1, tifr1);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR1, 1u << 1);
             }
             if (anyCycle || crossed16(prev, counter, ocr1b))
             {
-                std::uint8_t tifr1 = GetIo(AVR_TIFR1);
-                tifr1 = static_cast<std::uint8_t>(tifr1 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR1, tifr1);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR1, 1u << 2);
             }
         }
 
@@ -2400,7 +2601,7 @@ namespace firmware
         bool com1a = (tccr1a & (1u << 7)) != 0;
         bool com1b = (tccr1a & (1u << 5)) != 0;
 
-        if (_profile.mcu == "ATmega2560")
+        if (IsMega2560())
         {
             if (com1a && (ddrb & (1u << 5)) != 0)
             {
@@ -2499,46 +2700,44 @@ namespace firmware
         {
             top = ocr2a;
         }
-        bool wrapped = false;
+        std::uint64_t wraps = 0;
 
         if (phaseCorrect)
         {
-            auto advancePhase = [](std::uint8_t start, std::uint64_t steps, bool &up, std::uint8_t top, bool &wrappedOut)
+            auto advancePhase = [](std::uint8_t start, std::uint64_t steps, bool &up, std::uint8_t top, std::uint64_t &wrapsOut)
             {
                 std::uint32_t period = static_cast<std::uint32_t>(top) * 2u;
                 if (period == 0)
                 {
-                    wrappedOut = false;
+                    wrapsOut = 0;
                     return start;
                 }
                 std::uint32_t pos = up ? start : (period - start);
                 std::uint32_t move = static_cast<std::uint32_t>(steps % period);
                 std::uint32_t newPos = pos + move;
-                wrappedOut = steps >= period;
+                wrapsOut = (pos + steps) / period;
                 if (newPos >= period)
                 {
-                    wrappedOut = true;
                     newPos %= period;
                 }
                 up = newPos <= top;
                 return static_cast<std::uint8_t>(up ? newPos : (period - newPos));
             };
-            counter = advancePhase(counter, ticks, _timer2Up, top, wrapped);
+            counter = advancePhase(counter, ticks, _timer2Up, top, wraps);
         }
         else
         {
             std::uint16_t span = static_cast<std::uint16_t>(top) + 1u;
             std::uint64_t total = static_cast<std::uint64_t>(counter) + ticks;
             counter = static_cast<std::uint8_t>(span == 0 ? 0 : (total % span));
-            wrapped = span > 0 && total >= span;
+            wraps = span == 0 ? 0 : total / span;
         }
 
         AVR_IoWrite(&_state.core, AVR_TCNT2, counter);
-        if (wrapped)
+        if (wraps > 0)
         {
-            std::uint8_t tifr2 = GetIo(AVR_TIFR2);
-            tifr2 = static_cast<std::uint8_t>(tifr2 | 0x01);
-            AVR_IoWrite(&_state.core, AVR_TIFR2, tifr2);
+            _perf.timerOverflows += wraps;
+            AVR_IoSetFlags(&_state.core, AVR_TIFR2, 0x01);
         }
 
         auto crossed8 = [](std::uint8_t start, std::uint8_t end, std::uint8_t target)
@@ -2570,30 +2769,22 @@ namespace firmware
         {
             if (anyCycle || crossedPhase8(prev, counter, ocr2a))
             {
-                std::uint8_t tifr2 = GetIo(AVR_TIFR2);
-                tifr2 = static_cast<std::uint8_t>(tifr2 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR2, tifr2);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR2, 1u << 1);
             }
             if (anyCycle || crossedPhase8(prev, counter, ocr2b))
             {
-                std::uint8_t tifr2 = GetIo(AVR_TIFR2);
-                tifr2 = static_cast<std::uint8_t>(tifr2 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR2, tifr2);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR2, 1u << 2);
             }
         }
         else
         {
             if (anyCycle || crossed8(prev, counter, ocr2a))
             {
-                std::uint8_t tifr2 = GetIo(AVR_TIFR2);
-                tifr2 = static_cast<std::uint8_t>(tifr2 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR2, tifr2);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR2, 1u << 1);
             }
             if (anyCycle || crossed8(prev, counter, ocr2b))
             {
-                std::uint8_t tifr2 = GetIo(AVR_TIFR2);
-                tifr2 = static_cast<std::uint8_t>(tifr2 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR2, tifr2);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR2, 1u << 2);
             }
         }
 
@@ -2602,7 +2793,7 @@ namespace firmware
         bool com2a = (tccr2a & (1u << 7)) != 0;
         bool com2b = (tccr2a & (1u << 5)) != 0;
 
-        if (_profile.mcu == "ATmega2560")
+        if (IsMega2560())
         {
             std::uint8_t ddrb = GetIo(AVR_DDRB);
             std::uint8_t portb = GetIo(AVR_PORTB);
@@ -2765,47 +2956,45 @@ namespace firmware
             top = 0xFFFF;
             break;
         }
-        bool wrapped = false;
+        std::uint64_t wraps = 0;
 
         if (phaseCorrect)
         {
-            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, bool &wrappedOut)
+            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, std::uint64_t &wrapsOut)
             {
                 std::uint32_t period = static_cast<std::uint32_t>(top) * 2u;
                 if (period == 0)
                 {
-                    wrappedOut = false;
+                    wrapsOut = 0;
                     return start;
                 }
                 std::uint32_t pos = up ? start : (period - start);
                 std::uint32_t move = static_cast<std::uint32_t>(steps % period);
                 std::uint32_t newPos = pos + move;
-                wrappedOut = steps >= period;
+                wrapsOut = (pos + steps) / period;
                 if (newPos >= period)
                 {
-                    wrappedOut = true;
                     newPos %= period;
                 }
                 up = newPos <= top;
                 return static_cast<std::uint16_t>(up ? newPos : (period - newPos));
             };
-            counter = advancePhase(counter, ticks, _timer3Up, top, wrapped);
+            counter = advancePhase(counter, ticks, _timer3Up, top, wraps);
         }
         else
         {
             std::uint32_t span = static_cast<std::uint32_t>(top) + 1u;
             std::uint64_t total = static_cast<std::uint64_t>(counter) + ticks;
             counter = static_cast<std::uint16_t>(span == 0 ? 0 : (total % span));
-            wrapped = span > 0 && total >= span;
+            wraps = span == 0 ? 0 : total / span;
         }
 
         AVR_IoWrite(&_state.core, AVR_TCNT3L, static_cast<std::uint8_t>(counter & 0xFF));
         AVR_IoWrite(&_state.core, AVR_TCNT3H, static_cast<std::uint8_t>((counter >> 8) & 0xFF));
-        if (wrapped)
+        if (wraps > 0)
         {
-            std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-            tifr3 = static_cast<std::uint8_t>(tifr3 | 0x01);
-            AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+            _perf.timerOverflows += wraps;
+            AVR_IoSetFlags(&_state.core, AVR_TIFR3, 0x01);
         }
 
         auto crossed16 = [](std::uint16_t start, std::uint16_t end, std::uint16_t target)
@@ -2837,42 +3026,30 @@ namespace firmware
         {
             if (anyCycle || crossedPhase16(prev, counter, ocr3a))
             {
-                std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-                tifr3 = static_cast<std::uint8_t>(tifr3 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR3, 1u << 1);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr3b))
             {
-                std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-                tifr3 = static_cast<std::uint8_t>(tifr3 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR3, 1u << 2);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr3c))
             {
-                std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-                tifr3 = static_cast<std::uint8_t>(tifr3 | (1u << 3));
-                AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR3, 1u << 3);
             }
         }
         else
         {
             if (anyCycle || crossed16(prev, counter, ocr3a))
             {
-                std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-                tifr3 = static_cast<std::uint8_t>(tifr3 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR3, 1u << 1);
             }
             if (anyCycle || crossed16(prev, counter, ocr3b))
             {
-                std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-                tifr3 = static_cast<std::uint8_t>(tifr3 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR3, 1u << 2);
             }
             if (anyCycle || crossed16(prev, counter, ocr3c))
             {
-                std::uint8_t tifr3 = GetIo(AVR_TIFR3);
-                tifr3 = static_cast<std::uint8_t>(tifr3 | (1u << 3));
-                AVR_IoWrite(&_state.core, AVR_TIFR3, tifr3);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR3, 1u << 3);
             }
         }
 
@@ -3018,47 +3195,45 @@ namespace firmware
             top = 0xFFFF;
             break;
         }
-        bool wrapped = false;
+        std::uint64_t wraps = 0;
 
         if (phaseCorrect)
         {
-            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, bool &wrappedOut)
+            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, std::uint64_t &wrapsOut)
             {
                 std::uint32_t period = static_cast<std::uint32_t>(top) * 2u;
                 if (period == 0)
                 {
-                    wrappedOut = false;
+                    wrapsOut = 0;
                     return start;
                 }
                 std::uint32_t pos = up ? start : (period - start);
                 std::uint32_t move = static_cast<std::uint32_t>(steps % period);
                 std::uint32_t newPos = pos + move;
-                wrappedOut = steps >= period;
+                wrapsOut = (pos + steps) / period;
                 if (newPos >= period)
                 {
-                    wrappedOut = true;
                     newPos %= period;
                 }
                 up = newPos <= top;
                 return static_cast<std::uint16_t>(up ? newPos : (period - newPos));
             };
-            counter = advancePhase(counter, ticks, _timer4Up, top, wrapped);
+            counter = advancePhase(counter, ticks, _timer4Up, top, wraps);
         }
         else
         {
             std::uint32_t span = static_cast<std::uint32_t>(top) + 1u;
             std::uint64_t total = static_cast<std::uint64_t>(counter) + ticks;
             counter = static_cast<std::uint16_t>(span == 0 ? 0 : (total % span));
-            wrapped = span > 0 && total >= span;
+            wraps = span == 0 ? 0 : total / span;
         }
 
         AVR_IoWrite(&_state.core, AVR_TCNT4L, static_cast<std::uint8_t>(counter & 0xFF));
         AVR_IoWrite(&_state.core, AVR_TCNT4H, static_cast<std::uint8_t>((counter >> 8) & 0xFF));
-        if (wrapped)
+        if (wraps > 0)
         {
-            std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-            tifr4 = static_cast<std::uint8_t>(tifr4 | 0x01);
-            AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+            _perf.timerOverflows += wraps;
+            AVR_IoSetFlags(&_state.core, AVR_TIFR4, 0x01);
         }
 
         auto crossed16 = [](std::uint16_t start, std::uint16_t end, std::uint16_t target)
@@ -3090,42 +3265,30 @@ namespace firmware
         {
             if (anyCycle || crossedPhase16(prev, counter, ocr4a))
             {
-                std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-                tifr4 = static_cast<std::uint8_t>(tifr4 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR4, 1u << 1);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr4b))
             {
-                std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-                tifr4 = static_cast<std::uint8_t>(tifr4 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR4, 1u << 2);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr4c))
             {
-                std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-                tifr4 = static_cast<std::uint8_t>(tifr4 | (1u << 3));
-                AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR4, 1u << 3);
             }
         }
         else
         {
             if (anyCycle || crossed16(prev, counter, ocr4a))
             {
-                std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-                tifr4 = static_cast<std::uint8_t>(tifr4 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR4, 1u << 1);
             }
             if (anyCycle || crossed16(prev, counter, ocr4b))
             {
-                std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-                tifr4 = static_cast<std::uint8_t>(tifr4 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR4, 1u << 2);
             }
             if (anyCycle || crossed16(prev, counter, ocr4c))
             {
-                std::uint8_t tifr4 = GetIo(AVR_TIFR4);
-                tifr4 = static_cast<std::uint8_t>(tifr4 | (1u << 3));
-                AVR_IoWrite(&_state.core, AVR_TIFR4, tifr4);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR4, 1u << 3);
             }
         }
 
@@ -3271,47 +3434,45 @@ namespace firmware
             top = 0xFFFF;
             break;
         }
-        bool wrapped = false;
+        std::uint64_t wraps = 0;
 
         if (phaseCorrect)
         {
-            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, bool &wrappedOut)
+            auto advancePhase = [](std::uint16_t start, std::uint64_t steps, bool &up, std::uint16_t top, std::uint64_t &wrapsOut)
             {
                 std::uint32_t period = static_cast<std::uint32_t>(top) * 2u;
                 if (period == 0)
                 {
-                    wrappedOut = false;
+                    wrapsOut = 0;
                     return start;
                 }
                 std::uint32_t pos = up ? start : (period - start);
                 std::uint32_t move = static_cast<std::uint32_t>(steps % period);
                 std::uint32_t newPos = pos + move;
-                wrappedOut = steps >= period;
+                wrapsOut = (pos + steps) / period;
                 if (newPos >= period)
                 {
-                    wrappedOut = true;
                     newPos %= period;
                 }
                 up = newPos <= top;
                 return static_cast<std::uint16_t>(up ? newPos : (period - newPos));
             };
-            counter = advancePhase(counter, ticks, _timer5Up, top, wrapped);
+            counter = advancePhase(counter, ticks, _timer5Up, top, wraps);
         }
         else
         {
             std::uint32_t span = static_cast<std::uint32_t>(top) + 1u;
             std::uint64_t total = static_cast<std::uint64_t>(counter) + ticks;
             counter = static_cast<std::uint16_t>(span == 0 ? 0 : (total % span));
-            wrapped = span > 0 && total >= span;
+            wraps = span == 0 ? 0 : total / span;
         }
 
         AVR_IoWrite(&_state.core, AVR_TCNT5L, static_cast<std::uint8_t>(counter & 0xFF));
         AVR_IoWrite(&_state.core, AVR_TCNT5H, static_cast<std::uint8_t>((counter >> 8) & 0xFF));
-        if (wrapped)
+        if (wraps > 0)
         {
-            std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-            tifr5 = static_cast<std::uint8_t>(tifr5 | 0x01);
-            AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+            _perf.timerOverflows += wraps;
+            AVR_IoSetFlags(&_state.core, AVR_TIFR5, 0x01);
         }
 
         auto crossed16 = [](std::uint16_t start, std::uint16_t end, std::uint16_t target)
@@ -3343,42 +3504,30 @@ namespace firmware
         {
             if (anyCycle || crossedPhase16(prev, counter, ocr5a))
             {
-                std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-                tifr5 = static_cast<std::uint8_t>(tifr5 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR5, 1u << 1);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr5b))
             {
-                std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-                tifr5 = static_cast<std::uint8_t>(tifr5 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR5, 1u << 2);
             }
             if (anyCycle || crossedPhase16(prev, counter, ocr5c))
             {
-                std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-                tifr5 = static_cast<std::uint8_t>(tifr5 | (1u << 3));
-                AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR5, 1u << 3);
             }
         }
         else
         {
             if (anyCycle || crossed16(prev, counter, ocr5a))
             {
-                std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-                tifr5 = static_cast<std::uint8_t>(tifr5 | (1u << 1));
-                AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR5, 1u << 1);
             }
             if (anyCycle || crossed16(prev, counter, ocr5b))
             {
-                std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-                tifr5 = static_cast<std::uint8_t>(tifr5 | (1u << 2));
-                AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR5, 1u << 2);
             }
             if (anyCycle || crossed16(prev, counter, ocr5c))
             {
-                std::uint8_t tifr5 = GetIo(AVR_TIFR5);
-                tifr5 = static_cast<std::uint8_t>(tifr5 | (1u << 3));
-                AVR_IoWrite(&_state.core, AVR_TIFR5, tifr5);
+                AVR_IoSetFlags(&_state.core, AVR_TIFR5, 1u << 3);
             }
         }
 
@@ -3560,50 +3709,172 @@ namespace firmware
         }
     }
 
-    void VirtualMcu::SimulatePowerMode()
+    void VirtualMcu::SimulatePowerMode(std::uint64_t cycles)
     {
-        if (!_sleepEnabled)
-            return;
-
         // Check SMCR register for sleep mode
         std::uint8_t smcr = GetIo(0x33); // SMCR address
         _sleepMode = (smcr >> 1) & 0x07;
         _sleepEnabled = (smcr & 0x01) != 0;
 
-        if (_sleepEnabled && _sleepMode > 0)
+        // Stopped in SLEEP - count cycles spent sleeping
+        _perf.sleepCycles += cycles;
+        // Different sleep modes have different power characteristics:
+        // IDLE (0): CPU stopped, peripherals run
+        // ADC_NOISE_REDUCTION (1): CPU & ADC stopped
+        // POWER_DOWN (2): Everything stopped except WDT and external interrupts
+        // POWER_SAVE (3): Like POWER_DOWN but Timer2 runs
+        // STANDBY/EXT_STANDBY (6/7): Like POWER_DOWN but oscillator runs
+    }
+
+    void VirtualMcu::SyncPeripherals()
+    {
+        (this->*_syncPeripherals)();
+    }
+
+    template <class Board>
+    void VirtualMcu::SyncPeripheralsFor()
+    {
+        if (_tickCount > _peripheralTick)
         {
-            // In sleep mode - count cycles spent sleeping
-            _perf.sleepCycles++;
-            // Different sleep modes have different power characteristics:
-            // IDLE (0): CPU stopped, peripherals run
-            // ADC_NOISE_REDUCTION (1): CPU & ADC stopped
-            // POWER_DOWN (2): Everything stopped except WDT and external interrupts
-            // POWER_SAVE (3): Like POWER_DOWN but Timer2 runs
-            // STANDBY/EXT_STANDBY (6/7): Like POWER_DOWN but oscillator runs
+            AdvancePeripherals<Board>(_tickCount - _peripheralTick);
         }
+        _peripheralTick = _tickCount;
+        _nextEventTick = NextEventTick<Board>();
+        _scheduleDirty = false;
     }
 
-    void VirtualMcu::EnforceFlashAccessLatency()
+    template <class Board>
+    std::uint64_t VirtualMcu::NextEventTick()
     {
-        // LPM (Load Program Memory) instructions have access latency
-        // Real ATmega328P: Flash access takes 3 cycles
-        std::uint16_t pc = static_cast<std::uint16_t>(_state.core.pc);
+        std::uint64_t cycles = CyclesUntilNextEvent<Board>();
+        return cycles == NoEvent ? NoEvent : _peripheralTick + cycles;
+    }
+
+    template <class Board>
+    std::uint64_t VirtualMcu::CyclesUntilNextEvent()
+    {
+        // Counted from _peripheralTick, the cycle the registers reflect.
+        // Pin-change and external interrupts only follow input changes, which
+        // arrive between StepCycles calls.
+        std::uint64_t next = NoEvent;
+        auto earliest = [&next](std::uint64_t cycles)
+        {
+            next = std::min(next, cycles);
+        };
+        auto readWord = [this](std::uint16_t low)
+        {
+            return static_cast<std::uint32_t>(GetIo(low) | (GetIo(static_cast<std::uint16_t>(low + 1)) << 8));
+        };
 
-        if (pc != _lastFlashAddress)
+        static const int Timer01Prescalers[8] = {0, 1, 8, 64, 256, 1024, 1, 1};
+        static const int Timer2Prescalers[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+        struct Timer8
+        {
+            std::uint16_t tccra, tccrb, tcnt, ocra, ocrb;
+            const int *prescalers;
+            double remainder;
+            bool up;
+        };
+        const Timer8 timers8[] = {
+            {AVR_TCCR0A, AVR_TCCR0B, AVR_TCNT0, AVR_OCR0A, AVR_OCR0B, Timer01Prescalers, _timer0Remainder, _timer0Up},
+            {AVR_TCCR2A, AVR_TCCR2B, AVR_TCNT2, AVR_OCR2A, AVR_OCR2B, Timer2Prescalers, _timer2Remainder, _timer2Up},
+        };
+        for (const Timer8 &timer : timers8)
+        {
+            std::uint8_t tccrb = GetIo(timer.tccrb);
+            if ((tccrb & 0x07) == 0)
+                continue;
+            std::uint8_t wgm = static_cast<std::uint8_t>((GetIo(timer.tccra) & 0x03) | ((tccrb & 0x08) >> 1));
+            std::uint8_t ocra = GetIo(timer.ocra);
+            TimerView view{};
+            view.counter = GetIo(timer.tcnt);
+            view.top = (wgm == 0x02 || wgm == 0x05 || wgm == 0x07) ? ocra : 0xFF;
+            view.compare[0] = ocra;
+            view.compare[1] = GetIo(timer.ocrb);
+            view.compareCount = 2;
+            view.phaseCorrect = wgm == 0x01 || wgm == 0x05;
+            view.up = timer.up;
+            view.prescaler = timer.prescalers[tccrb & 0x07];
+            view.remainder = timer.remainder;
+            earliest(CyclesUntilTimerEvent(view));
+        }
+
+        // Same TOP per mode as SimulateTimer1/3/4/5; 0 stands for OCRnA
+        static const std::uint16_t Tops16[16] = {0xFFFF, 0x00FF, 0x01FF, 0x03FF, 0, 0x00FF, 0x01FF, 0x03FF,
+                                                 0xFFFF, 0, 0xFFFF, 0, 0, 0xFFFF, 0xFFFF, 0};
+        struct Timer16
+        {
+            std::uint16_t tccra, tccrb, tcnt, ocra, ocrb, ocrc;
+            double remainder;
+            bool up;
+        };
+        const Timer16 timers16[] = {
+            {AVR_TCCR1A, AVR_TCCR1B, AVR_TCNT1L, AVR_OCR1AL, AVR_OCR1BL, 0, _timer1Remainder, _timer1Up},
+            {AVR_TCCR3A, AVR_TCCR3B, AVR_TCNT3L, AVR_OCR3AL, AVR_OCR3BL, AVR_OCR3CL, _timer3Remainder, _timer3Up},
+            {AVR_TCCR4A, AVR_TCCR4B, AVR_TCNT4L, AVR_OCR4AL, AVR_OCR4BL, AVR_OCR4CL, _timer4Remainder, _timer4Up},
+            {AVR_TCCR5A, AVR_TCCR5B, AVR_TCNT5L, AVR_OCR5AL, AVR_OCR5BL, AVR_OCR5CL, _timer5Remainder, _timer5Up},
+        };
+        const std::size_t timer16Count = Board::HasTimers345 ? 4 : 1;
+        for (std::size_t t = 0; t < timer16Count; ++t)
         {
-            // Sequential access is faster, random access has more latency
-            if (pc != _lastFlashAddress + 1)
+            const Timer16 &timer = timers16[t];
+            std::uint8_t tccrb = GetIo(timer.tccrb);
+            if ((tccrb & 0x07) == 0)
+                continue;
+            std::uint8_t wgm = static_cast<std::uint8_t>((GetIo(timer.tccra) & 0x03) | ((tccrb & 0x18) >> 1));
+            TimerView view{};
+            view.counter = readWord(timer.tcnt);
+            view.compare[0] = readWord(timer.ocra);
+            view.compare[1] = readWord(timer.ocrb);
+            view.compareCount = 2;
+            if (timer.ocrc != 0)
             {
-                _flashAccessDelay = 2; // Non-sequential access penalty
-                _perf.flashAccessCycles += 2;
+                view.compare[2] = readWord(timer.ocrc);
+                view.compareCount = 3;
             }
-            _lastFlashAddress = pc;
+            view.top = Tops16[wgm] != 0 ? Tops16[wgm] : view.compare[0];
+            view.phaseCorrect = (wgm >= 1 && wgm <= 3) || (wgm >= 8 && wgm <= 11);
+            view.up = timer.up;
+            view.prescaler = Timer01Prescalers[tccrb & 0x07];
+            view.remainder = timer.remainder;
+            earliest(CyclesUntilTimerEvent(view));
         }
 
-        if (_flashAccessDelay > 0)
+        for (int channel = 0; channel < Board::UartCount; ++channel)
         {
-            _flashAccessDelay--;
+            const auto &uart = _uarts[static_cast<std::size_t>(channel)];
+            if (IsUartRxEnabled(channel) && !uart.rxReady)
+            {
+                if (uart.rxCyclesRemaining > 0.0)
+                    earliest(CyclesUntil(uart.rxCyclesRemaining));
+                else if (!uart.rxQueue.empty())
+                    earliest(1); // The next byte starts at the next sync
+            }
+            if (IsUartTxEnabled(channel))
+            {
+                if (uart.txActive)
+                    earliest(CyclesUntil(uart.txCyclesRemaining));
+                else if (!uart.txPending.empty())
+                    earliest(1);
+                if (uart.udrEmptyCyclesRemaining > 0.0)
+                    earliest(CyclesUntil(uart.udrEmptyCyclesRemaining));
+            }
         }
+
+        if (_spiActive)
+            earliest(CyclesUntil(_spiCyclesRemaining));
+        if (_twiActive)
+            earliest(CyclesUntil(_twiCyclesRemaining));
+
+        if (_adcCyclesRemaining > 0.0)
+            earliest(CyclesUntil(_adcCyclesRemaining));
+        else if ((GetIo(AVR_ADCSRA) & (1u << 6)) != 0)
+            earliest(1); // The conversion is timed from the next sync
+
+        std::uint8_t wdtcsr = GetIo(AVR_WDTCSR);
+        if ((wdtcsr & (1u << 3)) != 0 || (wdtcsr & (1u << 6)) != 0)
+            earliest(_wdtCyclesRemaining > 0.0 ? CyclesUntil(_wdtCyclesRemaining) : 1);
+        return next;
     }
 
     void VirtualMcu::CheckPeripheralConstraints()
@@ -3631,25 +3902,7 @@ namespace firmware
             }
         }
 
-        // Timer Overflow Detection
-        // Check if TCNT registers have overflowed
-        std::uint8_t tifr0 = GetIo(0x35); // TIFR0
-        if (tifr0 & 0x01)                 // TOV0 flag
-        {
-            _perf.timerOverflows++;
-        }
-
-        std::uint8_t tifr1 = GetIo(0x36); // TIFR1
-        if (tifr1 & 0x01)                 // TOV1 flag
-        {
-            _perf.timerOverflows++;
-        }
-
-        std::uint8_t tifr2 = GetIo(0x37); // TIFR2
-        if (tifr2 & 0x01)                 // TOV2 flag
-        {
-            _perf.timerOverflows++;
-        }
+        // Timer overflows are counted where the timers wrap
     }
 
     void VirtualMcu::TrackGpioChanges()
@@ -23,6 +23,7 @@ namespace firmware
         std::vector<std::uint8_t> eeprom;
         std::vector<std::uint8_t> io;
         std::vector<std::uint8_t> regs;
+        std::vector<AvrDecoded> decoded; // Predecoded flash, one entry per word
         AvrCore core{};
     };
 
@@ -49,9 +50,11 @@ namespace firmware
             std::uint64_t watchdogResets = 0;
             std::uint64_t brownOutResets = 0;
             std::uint64_t sleepCycles = 0;
-            std::uint64_t flashAccessCycles = 0;
+            std::uint64_t idleLoopCycles = 0; // Polling loops fast-forwarded by the core
+            std::uint64_t runtimeHleCalls = 0; // Division helpers computed natively
+            std::uint64_t flashAccessCycles = 0; // Extra cycles of LPM program-memory loads
             std::uint64_t uartOverflows = 0;
-            std::uint64_t timerOverflows = 0;
+            std::uint64_t timerOverflows = 0; // Counter wraps (TOV) across all timers
             // Robotics Development Metrics
             std::uint64_t gpioStateChanges = 0;
             std::uint64_t pwmCycles = 0;
@@ -142,13 +145,33 @@ namespace firmware
         const std::vector<SpiTransaction> &GetSpiLog() const { return _spiLog; }
         const std::vector<InterruptEvent> &GetInterruptLog() const { return _interruptLog; }
         void ClearDevelopmentLogs();
-        void SetDeterministicMode(bool enabled) { _deterministicMode = enabled; }
+        void SetDeterministicMode(bool enabled)
+        {
+            _deterministicMode = enabled;
+            SelectStepLoop();
+        }
         void SetRealtimeDeadline(std::uint64_t cycles) { _realtimeDeadline = cycles; }
-        void EnableDevelopmentTracking(bool enabled) { _enableDevelopmentTracking = enabled; }
+        void EnableDevelopmentTracking(bool enabled)
+        {
+            _enableDevelopmentTracking = enabled;
+            SelectStepLoop();
+        }
         void SetTrackingSampleInterval(std::uint64_t interval) { _trackingSampleInterval = interval; }
         double GetAverageInterruptLatency() const;
         std::uint64_t GetMaxInterruptLatency() const { return _perf.interruptLatencyMax; }
-        void EnableCpuTrace(bool enabled) { _traceCpuEnabled = enabled; }
+        void EnableCpuTrace(bool enabled)
+        {
+            _traceCpuEnabled = enabled;
+            SelectStepLoop();
+        }
+        // Opt-in: libgcc division helpers run natively with their exact
+        // cycle cost and results. A call is not split at a peripheral event,
+        // so an interrupt due during it is taken up to one call late.
+        void EnableRuntimeHle(bool enabled)
+        {
+            _runtimeHle = enabled;
+            AVR_SetRuntimeHle(&_state.core, enabled ? 1 : 0);
+        }
         void SetCpuTraceInterval(std::uint32_t interval) { _traceCpuInterval = interval > 0 ? interval : 1; }
         bool PopCpuTrace(CpuTraceEvent &out);
 
@@ -185,6 +208,16 @@ namespace firmware
         bool MeasureHexMaxAddress(const std::string &hexText, std::size_t &outMax);
         static void IoWriteHook(AvrCore *core, std::uint16_t address, std::uint8_t value, void *user);
         static void IoReadHook(AvrCore *core, std::uint16_t address, std::uint8_t value, void *user);
+        static void IoSyncHook(AvrCore *core, std::uint16_t address, void *user);
+        void RegisterIoWriteHandlers();
+        void OnEecrWrite(std::uint16_t address, std::uint8_t value);
+        void OnWdtcsrWrite(std::uint16_t address, std::uint8_t value);
+        void OnSmcrWrite(std::uint16_t address, std::uint8_t value);
+        void OnSpdrWrite(std::uint16_t address, std::uint8_t value);
+        void OnTwdrWrite(std::uint16_t address, std::uint8_t value);
+        void OnTwcrWrite(std::uint16_t address, std::uint8_t value);
+        void OnUcsrAWrite(std::uint16_t address, std::uint8_t value);
+        void OnUdrWrite(std::uint16_t address, std::uint8_t value);
         double ComputeUartCyclesPerByte(int channel);
         double ComputeUartCyclesPerBit(int channel);
         std::uint32_t NextUartErrorSeed(int channel, std::uint8_t data);
@@ -192,14 +225,28 @@ namespace firmware
         bool IsUartTxEnabled(int channel) const;
         bool IsUartParityEnabled(int channel) const;
         bool HasUart(int channel) const;
+        bool IsMega2560() const { return _state.core.mcu_kind == AVR_MCU_2560; }
         double ComputeSpiCyclesPerBit() const;
         double ComputeTwiCyclesPerBit() const;
         void CheckStackIntegrity();
         bool ValidateMemoryAccess(std::uint16_t address, bool isWrite);
         void UpdateWatchdogTimer(std::uint64_t cycles);
         void CheckBrownOutCondition();
-        void SimulatePowerMode();
-        void EnforceFlashAccessLatency();
+        void SimulatePowerMode(std::uint64_t cycles);
+        // StepCycles runs one StepLoop instantiation, picked by
+        // SelectStepLoop whenever the board or instrumentation changes.
+        void SelectStepLoop();
+        template <class Board, class Policy>
+        void StepLoop(std::uint64_t totalCycles);
+        template <class Board>
+        void AdvancePeripherals(std::uint64_t executed);
+        void SyncPeripherals();
+        template <class Board>
+        void SyncPeripheralsFor();
+        template <class Board>
+        std::uint64_t NextEventTick();
+        template <class Board>
+        std::uint64_t CyclesUntilNextEvent();
         void CheckPeripheralConstraints();
         void TrackGpioChanges();
         void AnalyzePwmOutputs();
@@ -252,6 +299,19 @@ namespace firmware
         std::uint32_t _adcNoiseSeed = 0x1234567u;
         std::array<UartState, 4> _uarts{};
         std::uint64_t _tickCount = 0;
+        // Peripherals are simulated up to _peripheralTick only. StepCycles
+        // runs the core to _nextEventTick, the earliest compare match,
+        // overflow, finished byte or conversion, before catching them up.
+        std::uint64_t _peripheralTick = 0;
+        std::uint64_t _nextEventTick = 0;
+        bool _scheduleDirty = false;
+        void (VirtualMcu::*_stepLoop)(std::uint64_t) = nullptr;
+        void (VirtualMcu::*_syncPeripherals)() = nullptr;
+        int _uartCount = 1; // Board::UartCount of the selected step loop
+        // Registers whose writes have side effects, indexed by address; the
+        // core only calls IoWriteHook for these.
+        using IoWriteHandler = void (VirtualMcu::*)(std::uint16_t, std::uint8_t);
+        std::array<IoWriteHandler, AVR_IO_SYNC_END> _ioWriteHandlers{};
         // Realism tracking:
         bool _inInterrupt = false;
         std::uint16_t _stackMinAddress = 0xFFFF;
@@ -268,8 +328,6 @@ namespace firmware
         double _vccVoltage = 5.0;
         double _brownOutThreshold = 2.7;
         // Flash Access Latency
-        std::uint64_t _flashAccessDelay = 0;
-        std::uint16_t _lastFlashAddress = 0;
         // Peripheral Constraints
         std::uint16_t _uartRxBufferSize = 128;
         std::uint16_t _uartTxBufferSize = 128;
@@ -284,6 +342,7 @@ namespace firmware
         bool _inCriticalSection = false;
         std::uint64_t _realtimeDeadline = 0;
         bool _deterministicMode = false;
+        bool _runtimeHle = false;
         std::uint32_t _randomSeed = 0x12345678;
         std::size_t _maxGpioHistory = 10000;
         std::size_t _maxI2cLog = 1000;
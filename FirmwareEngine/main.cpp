@@ -342,6 +342,7 @@ int main(int argc, char **argv)
     bool selfTest = false;
     bool traceLockstep = false;
     bool traceCpu = false;
+    bool runtimeHle = false;
     std::uint32_t traceCpuInterval = 1;
     std::uint32_t traceCpuMax = 256;
     std::string ideComPort;
@@ -428,6 +429,11 @@ int main(int argc, char **argv)
             traceCpu = true;
             continue;
         }
+        if (ParseArg(argv[i], "--runtime-hle"))
+        {
+            runtimeHle = true;
+            continue;
+        }
         if (ParseArg(argv[i], "--trace-cpu-interval") && i + 1 < argc)
         {
             traceCpuInterval = static_cast<std::uint32_t>(std::max(1, std::atoi(argv[i + 1])));
@@ -552,6 +558,8 @@ int main(int argc, char **argv)
         std::printf("  --trace-cpu              Enable instruction trace logging\n");
         std::printf("  --trace-cpu-interval <n> Instruction trace sampling interval (default: 1)\n");
         std::printf("  --trace-cpu-max <n>      Max trace lines sent per step (default: 256)\n");
+        std::printf("  --runtime-hle            Compute libgcc division helpers natively\n");
+        std::printf("                           (interrupts wait for the call to return)\n");
         std::printf("\n");
         std::printf("IDE Integration:\n");
         std::printf("  --ide-com <port>         COM port for STK500 protocol (e.g., COM3)\n");
@@ -764,6 +772,7 @@ int main(int argc, char **argv)
             }
             state.mcu = std::make_unique<VirtualMcu>(state.profile);
             state.mcu->EnableCpuTrace(traceCpu);
+            state.mcu->EnableRuntimeHle(runtimeHle);
             state.mcu->SetCpuTraceInterval(traceCpuInterval);
             state.lastTime = QueryNowSeconds();
             state.driftPpm = driftDist(rng);
@@ -800,6 +809,7 @@ int main(int argc, char **argv)
                 }
                 it->second.mcu = std::make_unique<VirtualMcu>(it->second.profile);
                 it->second.mcu->EnableCpuTrace(traceCpu);
+                it->second.mcu->EnableRuntimeHle(runtimeHle);
                 it->second.mcu->SetCpuTraceInterval(traceCpuInterval);
                 it->second.hasFirmware = false;
                 it->second.remainder = 0.0;
@@ -32,6 +32,8 @@ UNITY_EXPORT void SetComponentXY(uint32_t index, uint32_t x, uint32_t y);
 UNITY_EXPORT int GetAvrCount(void);
 UNITY_EXPORT float GetPinVoltageForAvr(int avrIndex, int pinIndex);
 UNITY_EXPORT int SetAnalogVoltageForAvr(int avrIndex, int pinIndex, float voltage);
+// Stamp steady PWM pins at their average voltage instead of edge by edge
+UNITY_EXPORT int SetPwmAveragingForAvr(int avrIndex, int enabled);
 
 // --- New Generic Circuit API ---
 UNITY_EXPORT void Native_CreateContext();
@@ -40,8 +42,69 @@ UNITY_EXPORT int Native_AddNode();
 UNITY_EXPORT int Native_AddComponent(int type, int paramCount, float *params);
 // Component Types: Resistor=0, VoltageSource=1
 UNITY_EXPORT void Native_Connect(int compId, int pinIndex, int nodeId);
+// Builds a whole binary netlist (Circuit/NetlistFormat.hpp) into the current
+// context. nodeIds[i] receives the id of netlist node i + 1, componentIds[i]
+// the id of component record i (either may be NULL). Returns the number of
+// components created, or -1 without modifying the context.
+UNITY_EXPORT int Native_LoadNetlist(const uint8_t *buffer, uint32_t size,
+                                    int32_t *nodeIds, uint32_t nodeCapacity,
+                                    int32_t *componentIds,
+                                    uint32_t componentCapacity);
 UNITY_EXPORT void Native_Step(float dt);
 UNITY_EXPORT float Native_GetVoltage(int nodeId);
+// Copies node voltages (index = node id, 0 = ground) into out. Returns the
+// number of values written: min(count, node count).
+UNITY_EXPORT int Native_GetVoltages(float *out, int count);
+
+// --- Circuit State Block ---
+// Snapshot published after every Native_Step while publishing is enabled.
+// Two blocks alternate, so the pointer returned by Native_GetCircuitState
+// (and the arrays it references) stays valid until the second Native_Step
+// after the call.
+typedef struct {
+  uint64_t sequence; // Increments on every publish
+  double time;       // Simulated circuit time (s)
+  uint32_t node_count;
+  uint32_t source_count;
+  uint32_t component_count;
+  uint32_t reserved;
+  const float *node_voltages;    // [node_count], index = node id
+  const uint32_t *source_ids;    // [source_count] voltage source ids
+  const float *source_currents;  // [source_count] A out of the + terminal
+  const uint32_t *component_ids; // [component_count]
+  const float *component_power;  // [component_count] W absorbed (<0 = delivered)
+} CircuitState;
+
+UNITY_EXPORT void Native_SetStatePublishing(int enabled);
+// NULL while publishing is disabled
+UNITY_EXPORT const CircuitState *Native_GetCircuitState(void);
+
+// --- Circuit Solver Statistics ---
+// Work done by the last Native_Step. Times stay 0 unless profiling is
+// enabled (it adds two clock reads per timed section).
+typedef struct {
+  uint32_t partition_count;
+  uint32_t partitions_solved; // Partitions re-solved this step
+  uint32_t unknowns;          // Sum of partition matrix sizes
+  uint32_t largest_partition;
+  uint64_t nonzeros; // Matrix entries stored (sparse) or nonzero (dense)
+  uint32_t newton_iterations;
+  uint32_t factorizations;
+  uint32_t factor_reuses; // Solves that reused the previous LU factors
+  uint32_t iterative_iterations;
+  uint32_t pivot_warnings; // Near-zero pivots skipped (singular circuit)
+  uint32_t nonconverged;   // Newton or iterative solves that hit their limit
+  uint32_t events;         // Event-driven component pauses
+  uint32_t reserved;
+  double stamp_ms;
+  double solve_ms;
+  double component_ms;
+  double step_ms;
+} CircuitStats;
+
+// Returns 0 when out is NULL
+UNITY_EXPORT int Native_GetCircuitStats(CircuitStats *out);
+UNITY_EXPORT void Native_SetCircuitProfiling(int enabled);
 UNITY_EXPORT int LoadHexFromFile(const char *path);
 UNITY_EXPORT int LoadHexFromText(const char *hexText);
 UNITY_EXPORT int LoadBvmFromMemory(const uint8_t *buffer, uint32_t size);
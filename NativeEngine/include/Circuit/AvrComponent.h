@@ -4,6 +4,7 @@
 #include "CircuitComponent.h"
 #include "CircuitContext.h"
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <vector>
 
@@ -22,7 +23,9 @@ namespace NativeEngine::Circuit
     AvrCore m_cpu;
     std::vector<std::uint8_t> m_flash;
     std::vector<std::uint8_t> m_sram;
-    std::uint8_t m_io[0x80];
+    // One predecoded instruction per flash word, filled as the core runs
+    std::vector<AvrDecoded> m_decoded;
+    std::uint8_t m_io[0xE0]; // 0x20-0xFF, extended I/O (Timer2) included
     std::uint8_t m_regs[32];
 
     // Norton Equivalent Driver Parameters
@@ -31,6 +34,14 @@ namespace NativeEngine::Circuit
     double G_out;
     double G_in;
 
+    // PWM averaging (opt-in): a timer compare output in a PWM mode, or a pin
+    // the firmware toggles at a steady period, is stamped at its
+    // duty-weighted average voltage. Its edges then no longer end
+    // StepUntilEvent(), so the circuit is solved at the caller's step rate.
+    bool m_pwmAveraging = false;
+    // Slower PWM stays edge-resolved (visible blinking, servo frames)
+    double m_pwmMinFrequency = 100.0;
+
     AvrComponent(std::uint32_t id) : Component(id, ComponentType::IC_Pin)
     {
       G_out = 1.0 / R_out;
@@ -46,6 +57,20 @@ namespace NativeEngine::Circuit
       AVR_Init(&m_cpu, m_flash.data(), static_cast<uint32_t>(m_flash.size()),
                m_sram.data(), static_cast<uint32_t>(m_sram.size()), m_io,
                sizeof(m_io), m_regs, sizeof(m_regs));
+      m_decoded.resize(m_flash.size() / 2);
+      AVR_SetDecodeCache(&m_cpu, m_decoded.data(), m_decoded.size());
+      std::memset(m_stampedPort, 0, sizeof(m_stampedPort));
+      std::memset(m_stampedDdr, 0, sizeof(m_stampedDdr));
+      std::memset(m_connectedMask, 0, sizeof(m_connectedMask));
+      std::memset(m_lastPort, 0, sizeof(m_lastPort));
+      std::fill(m_stampedDuty, m_stampedDuty + PIN_COUNT, -1.0);
+      AVR_SetIoWriteHook(&m_cpu, IoWriteHook, this);
+      // Stack and plain register stores skip the hook
+      for (std::uint16_t address = AVR_IO_BASE; address < AVR_IO_SYNC_END;
+           ++address)
+        AVR_SetIoWriteNotify(&m_cpu, address, 0);
+      for (std::uint16_t address : HOOKED_REGISTERS)
+        AVR_SetIoWriteNotify(&m_cpu, address, 1);
     }
 
     void Connect(std::uint8_t pinIndex, std::uint32_t nodeId) override
@@ -53,36 +78,64 @@ namespace NativeEngine::Circuit
       if (pinIndex < PIN_COUNT)
       {
         m_pinNodes[pinIndex] = nodeId;
+        UpdateConnectedMasks();
       }
+      MarkDirty();
     }
 
-    void Step(double dt) override
+    void GetNodes(std::vector<std::uint32_t> &out) const override
     {
-      // Calculate cycles
-      // 16MHz clock
-      std::uint64_t cycles = static_cast<std::uint64_t>(dt * 16000000.0);
-      if (cycles == 0)
-        cycles = 1;
+      out.insert(out.end(), m_pinNodes, m_pinNodes + PIN_COUNT);
+    }
+
+    // Input pins sample the solved node voltages during Stamp().
+    bool IsNonlinear() const override { return true; }
+
+    // Port writes that change a driven pin end StepUntilEvent() so the
+    // circuit is re-solved (and inputs re-sampled) at the right cycle.
+    bool IsEventDriven() const override { return true; }
 
-      // Cap at 100ms prevents freeze if dt is huge (e.g. breakpoint)
-      if (cycles > 1600000)
-        cycles = 1600000;
+    void Step(double dt) override
+    {
+      RunCycles(dt, false);
+    }
 
-      // We should really interleave simulation and execution for accuracy.
-      // But for now, step entire CPU chunk, then Sync?
-      // Or Step 1 instruction, Step Circuit?
-      // "System Step" is usually small (e.g. 1us = 16 cycles).
+    double StepUntilEvent(double dt) override
+    {
+      return RunCycles(dt, true);
+    }
 
-      while (cycles > 0)
+    // Sum over connected pins of the power drawn by the driver/input models
+    double GetPower(const Context &ctx) const override
+    {
+      static const int portOf[PortCount] = {PortD, PortB, PortC};
+      static const int offsets[PortCount] = {0, 8, 14};
+      static const int counts[PortCount] = {8, 6, 6};
+      double power = 0.0;
+      for (int p = 0; p < PortCount; ++p)
       {
-        std::uint8_t cost = AVR_ExecuteNext(&m_cpu);
-        if (cost == 0)
-          cost = 1; // Safety
-        if (cycles >= cost)
-          cycles -= cost;
-        else
-          cycles = 0;
+        int port = portOf[p];
+        for (int i = 0; i < counts[p]; ++i)
+        {
+          std::uint32_t nodeId = m_pinNodes[offsets[p] + i];
+          if (nodeId == 0)
+            continue;
+          double v = ctx.GetVoltageSafe(nodeId);
+          if (m_stampedDdr[port] & (1 << i))
+          {
+            double duty = m_stampedDuty[offsets[p] + i];
+            double targetV = duty >= 0.0 ? 5.0 * duty
+                             : (m_stampedPort[port] & (1 << i)) ? 5.0
+                                                                 : 0.0;
+            power += v * (v - targetV) * G_out;
+          }
+          else
+          {
+            power += v * v * G_in;
+          }
+        }
       }
+      return power;
     }
 
     void Stamp(Context &ctx) override
@@ -91,22 +144,459 @@ namespace NativeEngine::Circuit
       // Sync Output Pins (Read CPU Register -> Stamp Voltage Source)
 
       // Pin 0-7: PORTD
-      SyncPort(ctx, AVR_PORTD, AVR_DDRD, AVR_PIND, 0, 8);
+      SyncPort(ctx, PortD, AVR_PORTD, AVR_DDRD, AVR_PIND, 0, 8);
 
       // Pin 8-13: PORTB
-      SyncPort(ctx, AVR_PORTB, AVR_DDRB, AVR_PINB, 8, 6);
+      SyncPort(ctx, PortB, AVR_PORTB, AVR_DDRB, AVR_PINB, 8, 6);
 
       // Pin 14-19: PORTC
-      SyncPort(ctx, AVR_PORTC, AVR_DDRC, AVR_PINC, 14, 6);
+      SyncPort(ctx, PortC, AVR_PORTC, AVR_DDRC, AVR_PINC, 14, 6);
     }
 
   private:
-    void SyncPort(Context &ctx, int portReg, int ddrReg, int pinReg,
+    enum
+    {
+      PortB = 0,
+      PortC = 1,
+      PortD = 2,
+      PortCount = 3
+    };
+
+    static constexpr double CLOCK_HZ = 16000000.0;
+    // Cap at 100ms prevents freeze if dt is huge (e.g. breakpoint)
+    static constexpr std::uint64_t MAX_CYCLES_PER_STEP = 1600000;
+    // Matching periods before a toggled pin counts as steady PWM
+    static constexpr int PWM_LOCK_PERIODS = 3;
+    // Registers IoWriteHook handles
+    static constexpr std::uint16_t HOOKED_REGISTERS[] = {
+        AVR_PORTB,  AVR_DDRB,   AVR_PORTC,  AVR_DDRC,   AVR_PORTD,
+        AVR_DDRD,   AVR_TCCR0A, AVR_TCCR0B, AVR_OCR0A,  AVR_OCR0B,
+        AVR_TCCR1A, AVR_TCCR1B, AVR_ICR1L,  AVR_ICR1H,  AVR_OCR1AL,
+        AVR_OCR1AH, AVR_OCR1BL, AVR_OCR1BH, AVR_TCCR2A, AVR_TCCR2B,
+        AVR_OCR2A,  AVR_OCR2B};
+    // Software PWM duty drift that triggers a restamp
+    static constexpr double PWM_DUTY_TOLERANCE = 0.005;
+
+    // Edge history of a firmware-toggled pin, in CPU cycles
+    struct PwmTracker
+    {
+      std::uint64_t lastRise = 0;
+      std::uint64_t lastFall = 0;
+      std::uint64_t period = 0;
+      std::uint64_t high = 0;
+      int matches = 0;
+      bool seenRise = false;
+      bool steady = false;
+    };
+
+    // PORT/DDR values used by the last Stamp. The circuit only needs a
+    // re-solve when firmware changes what a connected pin drives.
+    std::uint8_t m_stampedPort[PortCount];
+    std::uint8_t m_stampedDdr[PortCount];
+    std::uint8_t m_connectedMask[PortCount];
+    bool m_outputEvent = false;
+
+    std::uint8_t m_lastPort[PortCount]; // PORT as of the last write
+    double m_stampedDuty[PIN_COUNT];    // Averaged duty stamped, -1 = level
+    PwmTracker m_pwm[PIN_COUNT];
+    std::uint64_t m_cycles = 0;
+    std::uint64_t m_pwmDeadline = 0; // Next steady-PWM timeout check, 0 = none
+
+    double RunCycles(double dt, bool stopOnEvent)
+    {
+      // 16MHz clock
+      std::uint64_t cycles = static_cast<std::uint64_t>(dt * CLOCK_HZ);
+      if (cycles == 0)
+      {
+        // Less than one cycle left in an interleaved step: nothing to run.
+        if (stopOnEvent)
+          return dt;
+        cycles = 1;
+      }
+      if (cycles > MAX_CYCLES_PER_STEP)
+        cycles = MAX_CYCLES_PER_STEP;
+
+      m_outputEvent = false;
+      std::uint64_t executed = 0;
+      while (executed < cycles)
+      {
+        // Blocks end at port and timer writes, so hooks and stopOnEvent see
+        // the same instruction boundaries as single stepping did.
+        std::uint64_t budget = cycles - executed;
+        if (m_pwmDeadline != 0)
+          budget = std::min<std::uint64_t>(
+              budget, m_pwmDeadline > m_cycles ? m_pwmDeadline - m_cycles : 1);
+        std::uint32_t cost = AVR_ExecuteBlock(
+            &m_cpu, static_cast<std::uint32_t>(budget), nullptr);
+        if (cost == 0)
+          cost = 1; // Safety
+        executed += cost;
+        m_cycles += cost;
+        if (m_pwmDeadline != 0 && m_cycles >= m_pwmDeadline)
+          CheckPwmTimeouts();
+        if (stopOnEvent && m_outputEvent)
+          break;
+      }
+
+      double elapsed = static_cast<double>(executed) / CLOCK_HZ;
+      return elapsed < dt ? elapsed : dt;
+    }
+
+    void UpdateConnectedMasks()
+    {
+      std::memset(m_connectedMask, 0, sizeof(m_connectedMask));
+      for (int pin = 0; pin < PIN_COUNT; ++pin)
+      {
+        if (m_pinNodes[pin] == 0)
+          continue;
+        if (pin < 8)
+          m_connectedMask[PortD] |= static_cast<std::uint8_t>(1u << pin);
+        else if (pin < 14)
+          m_connectedMask[PortB] |= static_cast<std::uint8_t>(1u << (pin - 8));
+        else
+          m_connectedMask[PortC] |= static_cast<std::uint8_t>(1u << (pin - 14));
+      }
+    }
+
+    static void IoWriteHook(AvrCore *core, std::uint16_t address,
+                            std::uint8_t value, void *user)
+    {
+      (void)core;
+      (void)value;
+      auto *self = static_cast<AvrComponent *>(user);
+      if (!self)
+        return;
+      switch (address)
+      {
+      case AVR_PORTB:
+      case AVR_DDRB:
+        self->OnPortWrite(PortB, AVR_PORTB, AVR_DDRB);
+        break;
+      case AVR_PORTC:
+      case AVR_DDRC:
+        self->OnPortWrite(PortC, AVR_PORTC, AVR_DDRC);
+        break;
+      case AVR_PORTD:
+      case AVR_DDRD:
+        self->OnPortWrite(PortD, AVR_PORTD, AVR_DDRD);
+        break;
+      case AVR_TCCR0A:
+      case AVR_TCCR0B:
+      case AVR_OCR0A:
+      case AVR_OCR0B:
+      case AVR_TCCR1A:
+      case AVR_TCCR1B:
+      case AVR_ICR1L:
+      case AVR_ICR1H:
+      case AVR_OCR1AL:
+      case AVR_OCR1AH:
+      case AVR_OCR1BL:
+      case AVR_OCR1BH:
+      case AVR_TCCR2A:
+      case AVR_TCCR2B:
+      case AVR_OCR2A:
+      case AVR_OCR2B:
+        self->OnTimerWrite();
+        break;
+      default:
+        break;
+      }
+    }
+
+    void OnPortWrite(int port, int portReg, int ddrReg)
+    {
+      std::uint8_t portVal = m_io[portReg - AVR_IO_BASE];
+      std::uint8_t ddrVal = m_io[ddrReg - AVR_IO_BASE];
+      // Direction changes always restamp; level changes only matter on
+      // pins configured as outputs (PORT on inputs selects the pull-up,
+      // which the pin model ignores).
+      std::uint8_t changed = static_cast<std::uint8_t>(
+          (ddrVal ^ m_stampedDdr[port]) |
+          ((portVal ^ m_stampedPort[port]) & ddrVal));
+      if (m_pwmAveraging)
+        changed = TrackPwmEdges(port, portVal, ddrVal, changed);
+      m_lastPort[port] = portVal;
+      if (changed & m_connectedMask[port])
+      {
+        m_outputEvent = true;
+        MarkDirty();
+      }
+    }
+
+    // Records edges on connected output pins and returns `changed` with
+    // averaged pins masked out, unless their stamped average must change.
+    std::uint8_t TrackPwmEdges(int port, std::uint8_t portVal,
+                               std::uint8_t ddrVal, std::uint8_t changed)
+    {
+      std::uint8_t edges = static_cast<std::uint8_t>(
+          (portVal ^ m_lastPort[port]) & ddrVal & m_connectedMask[port]);
+      std::uint8_t ddrChanged =
+          static_cast<std::uint8_t>(ddrVal ^ m_stampedDdr[port]);
+      for (int bit = 0; bit < 8; ++bit)
+      {
+        std::uint8_t mask = static_cast<std::uint8_t>(1u << bit);
+        if (!(m_connectedMask[port] & mask))
+          continue;
+        int pin = PortPinOffset(port) + bit;
+        if (edges & mask)
+          TrackEdge(pin, (portVal & mask) != 0);
+        if (ddrChanged & mask)
+          continue; // Direction changes always restamp
+
+        double stamped = m_stampedDuty[pin];
+        double duty = PinAverage(pin);
+        if (duty >= 0.0)
+        {
+          changed = static_cast<std::uint8_t>(changed & ~mask);
+          if (stamped < 0.0 || std::abs(duty - stamped) > PWM_DUTY_TOLERANCE)
+            changed |= mask;
+        }
+        else if (stamped >= 0.0)
+        {
+          changed |= mask; // Lost the lock: back to logic levels
+        }
+      }
+      return changed;
+    }
+
+    // A steady pattern is PWM_LOCK_PERIODS rise-to-rise periods in a row
+    // with the same period and high time (within ~3% or a few cycles).
+    void TrackEdge(int pin, bool rising)
+    {
+      PwmTracker &t = m_pwm[pin];
+      const std::uint64_t now = m_cycles;
+      if (!rising)
+      {
+        t.lastFall = now;
+        return;
+      }
+      if (t.seenRise && t.lastFall > t.lastRise)
+      {
+        std::uint64_t period = now - t.lastRise;
+        std::uint64_t high = t.lastFall - t.lastRise;
+        std::uint64_t tolerance = period / 32 + 4;
+        auto near = [tolerance](std::uint64_t a, std::uint64_t b)
+        { return (a > b ? a - b : b - a) <= tolerance; };
+        bool same = near(period, t.period) && near(high, t.high);
+        t.matches = same ? t.matches + 1 : 0;
+        t.period = period;
+        t.high = high;
+        t.steady = t.matches >= PWM_LOCK_PERIODS &&
+                   CLOCK_HZ / static_cast<double>(period) >= m_pwmMinFrequency;
+      }
+      else
+      {
+        t.matches = 0;
+        t.steady = false;
+      }
+      t.seenRise = true;
+      t.lastRise = now;
+      if (t.steady)
+      {
+        std::uint64_t due = now + 2 * t.period + 1;
+        if (m_pwmDeadline == 0 || due < m_pwmDeadline)
+          m_pwmDeadline = due;
+      }
+    }
+
+    // Steady pins that stopped toggling for two periods lose their lock.
+    void CheckPwmTimeouts()
+    {
+      m_pwmDeadline = 0;
+      for (int pin = 0; pin < PIN_COUNT; ++pin)
+      {
+        PwmTracker &t = m_pwm[pin];
+        if (!t.steady)
+          continue;
+        std::uint64_t lastEdge = std::max(t.lastRise, t.lastFall);
+        std::uint64_t due = lastEdge + 2 * t.period + 1;
+        if (m_cycles < due)
+        {
+          if (m_pwmDeadline == 0 || due < m_pwmDeadline)
+            m_pwmDeadline = due;
+          continue;
+        }
+        t = PwmTracker();
+        if (m_stampedDuty[pin] >= 0.0 && PinAverage(pin) < 0.0)
+        {
+          m_outputEvent = true;
+          MarkDirty();
+        }
+      }
+    }
+
+    void OnTimerWrite()
+    {
+      if (!m_pwmAveraging)
+        return;
+      static const int comparePins[] = {3, 5, 6, 9, 10, 11};
+      for (int pin : comparePins)
+      {
+        if (m_pinNodes[pin] != 0 && PinAverage(pin) != m_stampedDuty[pin])
+        {
+          m_outputEvent = true;
+          MarkDirty();
+        }
+      }
+    }
+
+    // Averaged duty of an output pin, or -1 when it is driven as a level.
+    // A timer compare output overrides PORT, as on the real part.
+    double PinAverage(int pin) const
+    {
+      if (!m_pwmAveraging || !IsOutputPin(pin))
+        return -1.0;
+      double duty = HardwareDuty(pin);
+      if (duty >= 0.0)
+        return duty;
+      const PwmTracker &t = m_pwm[pin];
+      return t.steady ? static_cast<double>(t.high) / t.period : -1.0;
+    }
+
+    // Uno compare outputs: OC2B=D3, OC0B=D5, OC0A=D6, OC1A=D9, OC1B=D10,
+    // OC2A=D11
+    double HardwareDuty(int pin) const
+    {
+      switch (pin)
+      {
+      case 3:
+        return Timer8Duty(AVR_TCCR2A, AVR_TCCR2B, AVR_OCR2A, AVR_OCR2B, 4, true);
+      case 5:
+        return Timer8Duty(AVR_TCCR0A, AVR_TCCR0B, AVR_OCR0A, AVR_OCR0B, 4, false);
+      case 6:
+        return Timer8Duty(AVR_TCCR0A, AVR_TCCR0B, AVR_OCR0A, AVR_OCR0A, 6, false);
+      case 9:
+        return Timer1Duty(AVR_OCR1AL, 6);
+      case 10:
+        return Timer1Duty(AVR_OCR1BL, 4);
+      case 11:
+        return Timer8Duty(AVR_TCCR2A, AVR_TCCR2B, AVR_OCR2A, AVR_OCR2A, 6, true);
+      default:
+        return -1.0;
+      }
+    }
+
+    double Timer8Duty(int tccrA, int tccrB, int ocrA, int ocr, int comShift,
+                      bool timer2) const
+    {
+      // CS bits -> clock divider; 0 = stopped or external clock
+      static const double prescale01[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+      static const double prescale2[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+      std::uint8_t a = Io(tccrA);
+      std::uint8_t b = Io(tccrB);
+      int com = (a >> comShift) & 3;
+      int wgm = (a & 3) | ((b >> 1) & 4);
+      bool channelA = comShift == 6;
+      unsigned top = 0xFF;
+      bool fast = false;
+      switch (wgm)
+      {
+      case 1: // Phase correct, TOP = 0xFF
+        break;
+      case 3: // Fast, TOP = 0xFF
+        fast = true;
+        break;
+      case 5: // Phase correct, TOP = OCRA (OCxA only toggles)
+      case 7: // Fast, TOP = OCRA
+        if (channelA)
+          return -1.0;
+        top = Io(ocrA);
+        fast = wgm == 7;
+        break;
+      default:
+        return -1.0;
+      }
+      double prescale = (timer2 ? prescale2 : prescale01)[b & 7];
+      return CompareDuty(com, Io(ocr), top, fast, prescale);
+    }
+
+    double Timer1Duty(int ocrLow, int comShift) const
+    {
+      static const double prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+      std::uint8_t a = Io(AVR_TCCR1A);
+      std::uint8_t b = Io(AVR_TCCR1B);
+      int com = (a >> comShift) & 3;
+      int wgm = (a & 3) | ((b >> 1) & 0xC);
+      bool channelA = comShift == 6;
+      unsigned top = 0;
+      bool fast = false;
+      switch (wgm)
+      {
+      case 1: // Phase correct 8/9/10-bit
+      case 2:
+      case 3:
+        top = (0x100u << (wgm - 1)) - 1;
+        break;
+      case 5: // Fast 8/9/10-bit
+      case 6:
+      case 7:
+        top = (0x100u << (wgm - 5)) - 1;
+        fast = true;
+        break;
+      case 8: // Phase (and frequency) correct, TOP = ICR1
+      case 10:
+        top = Io16(AVR_ICR1L);
+        break;
+      case 14: // Fast, TOP = ICR1
+        top = Io16(AVR_ICR1L);
+        fast = true;
+        break;
+      case 9: // TOP = OCR1A (OC1A only toggles)
+      case 11:
+      case 15:
+        if (channelA)
+          return -1.0;
+        top = Io16(AVR_OCR1AL);
+        fast = wgm == 15;
+        break;
+      default:
+        return -1.0;
+      }
+      return CompareDuty(com, Io16(ocrLow), top, fast, prescale[b & 7]);
+    }
+
+    // Non-inverting (COM = 2) or inverting (COM = 3) compare output duty
+    double CompareDuty(int com, unsigned ocr, unsigned top, bool fast,
+                       double prescale) const
+    {
+      if (com < 2 || prescale <= 0.0 || top == 0)
+        return -1.0;
+      double periodCycles = prescale * (fast ? top + 1.0 : 2.0 * top);
+      if (CLOCK_HZ / periodCycles < m_pwmMinFrequency)
+        return -1.0;
+      double duty = fast ? (ocr >= top ? 1.0 : (ocr + 1.0) / (top + 1.0))
+                         : std::min(1.0, static_cast<double>(ocr) / top);
+      return com == 3 ? 1.0 - duty : duty;
+    }
+
+    std::uint8_t Io(int address) const { return m_io[address - AVR_IO_BASE]; }
+    unsigned Io16(int low) const
+    {
+      return Io(low) | (static_cast<unsigned>(Io(low + 1)) << 8);
+    }
+
+    bool IsOutputPin(int pin) const
+    {
+      if (pin < 8)
+        return (Io(AVR_DDRD) >> pin) & 1;
+      if (pin < 14)
+        return (Io(AVR_DDRB) >> (pin - 8)) & 1;
+      return (Io(AVR_DDRC) >> (pin - 14)) & 1;
+    }
+
+    static int PortPinOffset(int port)
+    {
+      return port == PortD ? 0 : port == PortB ? 8 : 14;
+    }
+
+    void SyncPort(Context &ctx, int port, int portReg, int ddrReg, int pinReg,
                   int pinOffset, int count)
     {
       std::uint8_t portVal = AVR_IoRead(&m_cpu, portReg);
       std::uint8_t ddrVal = AVR_IoRead(&m_cpu, ddrReg);
       std::uint8_t pinVal = 0; // Input read accumulator
+      m_stampedPort[port] = portVal;
+      m_stampedDdr[port] = ddrVal;
 
       for (int i = 0; i < count; ++i)
       {
@@ -129,7 +619,9 @@ namespace NativeEngine::Circuit
           // Stamp Current Source I_Norton.
           // Stamp Conductance G.
 
-          double targetV = isHigh ? 5.0 : 0.0;
+          double duty = PinAverage(pinIndex);
+          m_stampedDuty[pinIndex] = duty;
+          double targetV = duty >= 0.0 ? 5.0 * duty : (isHigh ? 5.0 : 0.0);
           double In = targetV * G_out;
 
           // Stamp Resistor (Conductance) to Ground?
@@ -162,6 +654,7 @@ namespace NativeEngine::Circuit
         {
           // Input Mode
           // High Impedance to Ground
+          m_stampedDuty[pinIndex] = -1.0;
           ctx.StampConductance(nodeId, 0, G_in);
 
           // Read Voltage
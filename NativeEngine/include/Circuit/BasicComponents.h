@@ -18,13 +18,25 @@ public:
       m_nodeA = nodeId;
     else if (pinIndex == 1)
       m_nodeB = nodeId;
+    MarkDirty();
+  }
+
+  void GetNodes(std::vector<std::uint32_t> &out) const override {
+    out.push_back(m_nodeA);
+    out.push_back(m_nodeB);
   }
 
   void Stamp(Context &ctx) override {
     ctx.StampConductance(m_nodeA, m_nodeB, m_conductance);
   }
 
+  double GetPower(const Context &ctx) const override {
+    double v = ctx.GetVoltageSafe(m_nodeA) - ctx.GetVoltageSafe(m_nodeB);
+    return v * v * m_conductance;
+  }
+
   double GetResistance() const { return m_resistance; }
+  double GetConductance() const { return m_conductance; }
 
   std::uint32_t m_nodeA = 0;
   std::uint32_t m_nodeB = 0;
@@ -44,6 +56,12 @@ public:
       m_nodePos = nodeId; // +
     else if (pinIndex == 1)
       m_nodeNeg = nodeId; // -
+    MarkDirty();
+  }
+
+  void GetNodes(std::vector<std::uint32_t> &out) const override {
+    out.push_back(m_nodePos);
+    out.push_back(m_nodeNeg);
   }
 
   void Stamp(Context &ctx) override {
@@ -65,12 +83,23 @@ public:
     ctx.AddToRHS(idx, m_voltage);
   }
 
+  double GetPower(const Context &ctx) const override {
+    return -m_voltage * m_current;
+  }
+
   double GetVoltage() const { return m_voltage; }
-  void SetVoltage(double v) { m_voltage = v; }
+  void SetVoltage(double v) {
+    if (v != m_voltage)
+      MarkDirty();
+    m_voltage = v;
+  }
+  // Branch current out of the + terminal at the last solve
+  double GetCurrent() const { return m_current; }
 
   std::uint32_t m_nodePos = 0;
   std::uint32_t m_nodeNeg = 0;
   std::size_t m_matrixIndex = 0;
+  double m_current = 0.0; // Written by the context after each solve
 
 private:
   double m_voltage;
@@ -89,6 +118,11 @@ public:
     if (pinIndex == 0) {
       m_node = nodeId;
     }
+    MarkDirty();
+  }
+
+  void GetNodes(std::vector<std::uint32_t> &out) const override {
+    out.push_back(m_node);
   }
 
   void Stamp(Context &ctx) override {
@@ -101,7 +135,16 @@ public:
     ctx.StampCurrent(0, m_node, m_voltage * m_conductance);
   }
 
-  void SetVoltage(double v) { m_voltage = v; }
+  double GetPower(const Context &ctx) const override {
+    double v = ctx.GetVoltageSafe(m_node);
+    return v * (v - m_voltage) * m_conductance;
+  }
+
+  void SetVoltage(double v) {
+    if (v != m_voltage)
+      MarkDirty();
+    m_voltage = v;
+  }
   double GetVoltage() const { return m_voltage; }
 
   void SetResistance(double r) {
@@ -110,6 +153,7 @@ public:
     }
     m_resistance = r;
     m_conductance = 1.0 / m_resistance;
+    MarkDirty();
   }
 
   std::uint32_t m_node = 0;
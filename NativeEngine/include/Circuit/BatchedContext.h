@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NativeEngine::Circuit {
+/// <summary>
+/// One netlist topology solved for many parameter sets at once (tolerance
+/// and Monte Carlo sweeps). Every matrix entry, parameter and result holds
+/// one value per lane, stored contiguously, so the elimination runs across
+/// instances with AVX2 where available. Pivot rows are chosen from lane 0;
+/// lanes whose pivot vanishes under that order are reported invalid.
+/// </summary>
+class BatchedContext {
+public:
+  explicit BatchedContext(std::size_t lanes);
+
+  std::size_t GetLaneCount() const { return m_lanes; }
+
+  // Topology (shared by all lanes). Node 0 is ground.
+  std::uint32_t CreateNode();
+  // Each Add* returns the element index used by the parameter API. The
+  // given value seeds every lane.
+  std::size_t AddResistor(std::uint32_t nodeA, std::uint32_t nodeB,
+                          double ohms);
+  std::size_t AddVoltageSource(std::uint32_t nodePos, std::uint32_t nodeNeg,
+                               double volts);
+  // Swept parameter is the saturation current Is
+  std::size_t AddDiode(std::uint32_t anode, std::uint32_t cathode,
+                       double saturationCurrent = 1e-12);
+
+  // Parameters: ohms, volts or Is depending on the element
+  void SetParameter(std::size_t element, std::size_t lane, double value);
+  // values[lane] for one element
+  void SetParameters(std::size_t element, const double *values);
+  // values[element * lanes + lane] for every element
+  void SetParameterTable(const double *values);
+
+  // Solves every lane; returns the number of lanes that converged.
+  std::size_t Solve();
+
+  double GetNodeVoltage(std::uint32_t node, std::size_t lane) const;
+  // out[node * lanes + lane] for every node, ground included
+  void GetVoltages(double *out) const;
+  bool IsLaneValid(std::size_t lane) const;
+
+  int m_maxIterations = 50;
+  double m_epsilon = 1e-6;
+
+private:
+  enum class ElementType { Resistor, VoltageSource, Diode };
+  struct Element {
+    ElementType type;
+    std::uint32_t nodeA;
+    std::uint32_t nodeB;
+    std::size_t branch; // Voltage sources: matrix row of the branch current
+  };
+
+  std::size_t AddElement(ElementType type, std::uint32_t nodeA,
+                         std::uint32_t nodeB, double value);
+  void Resize();
+  void Stamp();
+  void Factor();
+  double *Entry(std::size_t row, std::size_t col) {
+    return &m_matrix[(row * m_size + col) * m_stride];
+  }
+
+  std::size_t m_lanes;
+  std::size_t m_stride; // Lanes rounded up to the SIMD width
+  std::uint32_t m_nodeCount = 1;
+  std::size_t m_sourceCount = 0;
+  std::size_t m_size = 0; // Unknowns: nodes - 1 + voltage sources
+  bool m_nonlinear = false;
+  std::vector<Element> m_elements;
+  std::vector<double> m_params;   // [element][stride]
+  std::vector<double> m_matrix;   // [row][col][stride]
+  std::vector<double> m_rhs;      // [row][stride]
+  std::vector<double> m_voltages; // [node][stride], Newton state and result
+  std::vector<double> m_scratch;  // Per-lane factors
+  std::vector<std::size_t> m_columns; // Nonzero columns of the pivot row
+  std::vector<std::uint8_t> m_valid;
+  std::vector<std::uint8_t> m_converged;
+};
+} // namespace NativeEngine::Circuit
@@ -18,7 +18,9 @@ enum class ComponentType {
   LED,
   Switch,
   IC_Pin, // Connection point for complex ICs like AVR
-  AnalogDriver // Norton-style voltage driver (conductance + current)
+  AnalogDriver, // Norton-style voltage driver (conductance + current)
+  Capacitor,
+  Inductor
 };
 
 /// <summary>
@@ -36,14 +38,49 @@ public:
   // Connect a specific pin of this component to a circuit node
   virtual void Connect(std::uint8_t pinIndex, std::uint32_t nodeId) = 0;
 
+  // Append every node this component is attached to (used to split the
+  // netlist into independently solvable partitions)
+  virtual void GetNodes(std::vector<std::uint32_t> &out) const = 0;
+
+  // True when Stamp() depends on the node voltages of the previous Newton
+  // iteration (diodes, MCU input sampling)
+  virtual bool IsNonlinear() const { return false; }
+
+  // True when the stamp changes with simulated time even if nothing was
+  // written to the component (forces a solve every step)
+  virtual bool IsTimeDependent() const { return false; }
+
   // Populate the MNA Matrix (Modified Nodal Analysis)
   virtual void Stamp(Context &ctx) = 0;
 
+  // Power absorbed from the circuit at the last solve, in watts (negative
+  // when the component delivers energy, e.g. sources)
+  virtual double GetPower(const Context &ctx) const { return 0.0; }
+
   // Step simulation time (Optional, for CPUs etc)
   virtual void Step(double dt) {}
 
+  // True when Step() can be split at internal events that change the stamp
+  // (MCU port writes). The context then re-solves the partition at each
+  // event instead of once per step.
+  virtual bool IsEventDriven() const { return false; }
+
+  // Advance by at most dt, returning early after the first event that
+  // marks the component dirty. Returns the simulated time consumed.
+  virtual double StepUntilEvent(double dt) {
+    Step(dt);
+    return dt;
+  }
+
+  // Stamp invalidation: a partition is re-solved only if one of its
+  // components changed its stamp since the last solve.
+  void MarkDirty() { m_dirty = true; }
+  void ClearDirty() { m_dirty = false; }
+  bool IsDirty() const { return m_dirty; }
+
 protected:
   std::uint32_t m_id;
   ComponentType m_type;
+  bool m_dirty = true;
 };
 } // namespace NativeEngine::Circuit
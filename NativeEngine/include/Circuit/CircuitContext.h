@@ -1,12 +1,19 @@
 #pragma once
 
 #include "CircuitComponent.h"
+#include "IterativeSolver.h"
+#include "MnaKernels.h"
+#include "ThreadPool.h"
+#include <cstddef>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 
 namespace NativeEngine::Circuit {
+class Diode;
+
 struct Node {
   std::uint32_t id;
   double voltage;
@@ -14,33 +21,219 @@ struct Node {
   bool isGround;
 };
 
+enum class IntegrationMethod {
+  BackwardEuler, // L-stable, first order: no ringing after hard edges
+  Trapezoidal    // Second order; used between discontinuities
+};
+
+enum class LinearSolverBackend {
+  Direct,   // Dense LU (fixed-size kernels for small partitions)
+  Iterative // Sparse PCG / BiCGSTAB for partitions past a size threshold
+};
+
+/// <summary>
+/// Diodes of one partition in structure-of-arrays form. Parameters are
+/// captured when partitions are built and reloaded from any diode whose
+/// setters marked it dirty, and the exponentials of every junction are
+/// evaluated in one pass before the stamps are scattered.
+/// </summary>
+struct DiodeBatch {
+  std::vector<const Diode *> device;
+  std::vector<std::uint32_t> anodeNode;
+  std::vector<std::uint32_t> cathodeNode;
+  std::vector<int> anodeRow; // -1 = ground
+  std::vector<int> cathodeRow;
+  std::vector<double> is;
+  std::vector<double> thermalV;
+  std::vector<double> vmax;
+  std::vector<double> gmin;
+  std::vector<double> vd;  // Scratch: junction voltages
+  std::vector<double> expV; // Scratch: exp(min(vd, vmax) / thermalV)
+  // Matrix entries (Partition::Slot) of each stamp, -1 = ground row
+  std::vector<std::ptrdiff_t> slotAA;
+  std::vector<std::ptrdiff_t> slotKK;
+  std::vector<std::ptrdiff_t> slotAK;
+  std::vector<std::ptrdiff_t> slotKA;
+
+  // Device bypass: last linearization, reused while vd stays within tolerance
+  std::vector<double> lastVd;
+  std::vector<double> g;
+  std::vector<double> iSource;
+  std::vector<std::size_t> active; // Scratch: diodes relinearized this pass
+  bool linearized = false;         // g/iSource valid (false after a rebuild)
+
+  std::size_t Size() const { return anodeNode.size(); }
+};
+
+/// <summary>
+/// Solver work for one Context::Step. Each partition counts its own, and
+/// Context sums them after the step. Times are only measured while
+/// Context::m_profileTimings is set; partitions solved in parallel add up
+/// their thread time.
+/// </summary>
+struct StepStats {
+  // Structure (all partitions, solved or not)
+  std::uint32_t partitionCount = 0;
+  std::uint32_t unknowns = 0;         // Summed over partitions
+  std::uint32_t largestPartition = 0; // Unknowns of the biggest system
+  std::uint64_t nonzeros = 0;         // Stamped entries (pattern if sparse)
+
+  // Work
+  std::uint32_t partitionsSolved = 0; // SolvePartition calls
+  std::uint32_t newtonIterations = 0;
+  std::uint32_t factorizations = 0;
+  std::uint32_t factorReuses = 0;
+  std::uint32_t iterativeIterations = 0;
+  std::uint32_t pivotWarnings = 0; // Columns skipped: |pivot| < 1e-12
+  std::uint32_t nonConverged = 0;  // Newton or Krylov hit its iteration cap
+  std::uint32_t events = 0;        // Mid-step re-solves
+
+  double stampSeconds = 0.0;
+  double solveSeconds = 0.0;
+  double componentSeconds = 0.0; // Component Step/StepUntilEvent
+  double stepSeconds = 0.0;      // Whole Context::Step
+
+  void AddWork(const StepStats &other);
+};
+
+/// <summary>
+/// A connected component of the netlist (ground excluded). Partitions share
+/// no unknowns, so each one owns its MNA system and is solved on its own.
+/// </summary>
+struct Partition {
+  std::vector<std::uint32_t> nodes;      // Matrix row i <-> nodes[i]
+  std::vector<Component *> components;
+  std::vector<Component *> eventComponents; // Stepped between re-solves
+  std::vector<double> eventClock;           // Per event component, within dt
+  std::vector<Component *> reactive;        // Capacitors/inductors
+  std::vector<Component *> stampComponents; // Stamped through the vtable
+  std::vector<Component *> voltageSources;  // Branch rows after the nodes
+  DiodeBatch diodes;                        // Stamped in one batch
+  std::size_t matrixSize = 0;            // Nodes + voltage source branches
+  const LuKernel *luKernel = nullptr;    // Unrolled for small systems
+  bool nonlinear = false;
+  bool timeDependent = false;
+  bool sparse = false;    // CSR storage, solved iteratively
+  bool symmetric = false; // No voltage source rows: CG instead of BiCGSTAB
+  bool dirty = true;                     // Forces a solve on the next Step
+  bool converged = false;
+  std::uint64_t solveCount = 0;
+  std::uint64_t eventCount = 0; // Re-solves triggered inside a step
+  std::uint64_t factorCount = 0;
+  std::uint64_t factorReuseCount = 0; // Newton passes that only substituted
+  std::uint64_t bypassCount = 0;      // Diode linearizations reused
+  std::uint64_t iterativeIterations = 0;
+  std::uint64_t iterativeFailures = 0; // Solves that hit the iteration cap
+  std::size_t nonzeros = 0; // Stamped entries at the last factorization
+  StepStats stats;          // Work of the current Step only
+
+  // Transient integration (partitions with reactive components)
+  double time = 0.0;    // Integrated up to, within the current Step
+  double substep = 0.0; // Next internal step proposed by the LTE control
+  bool restart = true;  // Discontinuity: next substep uses backward Euler
+  bool settled = false; // Reactive state stopped moving; skip until dirty
+  std::uint64_t acceptedSteps = 0;
+  std::uint64_t rejectedSteps = 0;
+
+  // Matrix storage: dense row-major, or CSR values when sparse
+  std::vector<double> baseMatrix; // Constant resistor stamps, summed once
+  std::vector<double> matrix;
+  std::vector<double> rhs;
+  std::vector<double> solution; // Also the warm start of iterative solves
+  // LU factors of factoredMatrix; reused while matrix compares equal
+  std::vector<double> factoredMatrix;
+  std::vector<double> lu;
+  std::vector<std::size_t> pivots;
+  bool factored = false;
+  // Sparse pattern: every pair of rows some component couples
+  std::vector<std::size_t> rowStart;
+  std::vector<std::uint32_t> columns;
+  std::vector<double> work; // Krylov scratch vectors
+
+  // Index of entry (row, col) in matrix/baseMatrix, or -1 when it is out of
+  // range or outside the sparse pattern.
+  std::ptrdiff_t Slot(std::size_t row, std::size_t col) const;
+};
+
 class Context {
 public:
   Context();
   ~Context();
 
   void Reset();
+  // Pre-size storage before bulk construction (e.g. Native_LoadNetlist)
+  void Reserve(std::size_t nodeCount, std::size_t componentCount);
 
   // Graph Construction
   std::uint32_t CreateNode();
   void AddComponent(std::shared_ptr<Component> component);
+  bool ConnectComponent(std::uint32_t componentId, std::uint8_t pinIndex,
+                        std::uint32_t nodeId);
   Node *GetNode(std::uint32_t id);
+  Component *FindComponent(std::uint32_t componentId) const;
+  // Call after connecting pins outside ConnectComponent()
+  void InvalidateTopology() { m_topologyDirty = true; }
 
   // Simulation
   void Step(double dt);
   double GetNodeVoltage(std::uint32_t nodeId) const;
+  double GetTime() const { return m_time; }
+  // Counters and timings of the last Step
+  const StepStats &GetStepStats() const { return m_stepStats; }
 
   // Solver Configuration
   int m_maxIterations = 50;
   double m_epsilon = 1e-6;
+  // Partitions with at least this many unknowns are solved on the pool
+  std::size_t m_parallelMinUnknowns = 64;
+  // 0 = hardware_concurrency - 1, 1 = always solve on the calling thread
+  std::size_t m_solverThreads = 0;
+  // Partitions up to this many unknowns use the fixed-size kernels
+  // (0 disables, capped at kMaxFixedKernelSize). Applied on rebuild.
+  std::size_t m_fixedKernelMaxUnknowns = kMaxFixedKernelSize;
+  // Diodes whose junction voltage moved less than this since their last
+  // linearization reuse it (0 disables). When nothing in a partition's
+  // matrix changes, its LU factors are reused as well.
+  double m_bypassTolerance = 1e-6;
+  // Iterative backend: partitions with at least m_iterativeMinUnknowns
+  // unknowns are stored sparse and solved with PCG (conductance-only) or
+  // BiCGSTAB (voltage source rows), warm-started from the last solution.
+  // Applied on rebuild.
+  LinearSolverBackend m_linearSolver = LinearSolverBackend::Direct;
+  std::size_t m_iterativeMinUnknowns = 256;
+  double m_iterativeTolerance = 1e-10; // Relative residual
+  int m_iterativeMaxIterations = 1000;
+  // Measure stamp/solve/component times into GetStepStats()
+  bool m_profileTimings = false;
+  // Stop event-driven components (MCUs) at output changes and re-solve
+  // their partition there; false steps them once per Step like any other.
+  bool m_interleaveEvents = true;
+  // Step MCUs concurrently on the solver pool: one task per partition when
+  // interleaving events, else one per event-driven component. MCUs only
+  // exchange pin levels through Stamp, so the result does not change.
+  bool m_parallelComponents = true;
+  // Per partition and Step; past this the remaining time runs unsplit
+  std::size_t m_maxEventsPerStep = 4096;
+  // Reactive partitions take adaptive substeps inside each Step, sized so
+  // the local truncation error stays below relTol * |x| + absTol.
+  IntegrationMethod m_integrationMethod = IntegrationMethod::Trapezoidal;
+  double m_lteRelTol = 1e-3;
+  double m_lteAbsTol = 1e-6;
+  double m_minSubstep = 1e-9;
+  // State change per Step below which a reactive partition counts as settled
+  double m_settleTolerance = 1e-9;
 
   // Solver Interface
   std::size_t GetNodeCount() const { return m_nodes.size(); }
   const std::vector<std::shared_ptr<Component>> &GetComponents() const {
     return m_components;
   }
+  // Insertion-ordered components of one type (e.g. every AVR)
+  const std::vector<Component *> &GetComponentsOfType(ComponentType type) const;
+  const std::vector<Partition> &GetPartitions() const { return m_partitions; }
 
   // MNA Matrix helpers (Low Level)
+  // Indices are local to the partition currently being stamped.
   void AddToMatrix(std::size_t row, std::size_t col, double value);
   void AddToRHS(std::size_t row, double value); // Add to Right Hand Side vector
 
@@ -56,22 +249,36 @@ public:
 
   // Helper for Components to get their node voltages during iteration
   double GetVoltageSafe(std::uint32_t nodeId) const;
+  // Voltage at the start of the current (sub)step, for companion models
+  double GetLastVoltage(std::uint32_t nodeId) const;
 
   double m_timeIsTransient = false;
   double m_dt = 0.0;
 
-  // Matrix storage
-  std::vector<double> m_matrix;
-  std::vector<double> m_rhs;
-  std::vector<double> m_solution;
-
 private:
-  void SolveMNA();
-  void ResizeMatrix(std::size_t size);
+  void BuildPartitions();
+  void BuildSparsePattern(Partition &partition);
+  bool NeedsSolve(const Partition &partition) const;
+  void SolvePartition(Partition &partition);
+  void AdvanceEventComponents(Partition &partition, double dt);
+  void IntegratePartition(Partition &partition, double until);
+  void SolvePending(Partition &partition, double dt);
+  void StampDiodes(Partition &partition);
+  ThreadPool *GetThreadPool();
 
   std::vector<Node> m_nodes;
   std::vector<std::shared_ptr<Component>> m_components;
-  std::vector<int> m_nodeToMatrixIndex; // Cached during Solve
+  std::unordered_map<std::uint32_t, std::size_t> m_componentSlots; // id -> index
+  std::vector<std::vector<Component *>> m_componentsByType;
+  std::vector<int> m_nodeToMatrixIndex; // Partition-local, rebuilt on topology change
+  std::vector<Partition> m_partitions;
+  std::vector<Partition *> m_pendingPartitions;
+  std::vector<Component *> m_steppedComponents; // Not owned by an event loop
+  std::vector<Partition *> m_eventPartitions;   // Partitions with MCUs
+  std::vector<Component *> m_eventDriven;       // Every event-driven component
+  std::unique_ptr<ThreadPool> m_threadPool;
+  StepStats m_stepStats;
+  bool m_topologyDirty = true;
   double m_time;
 };
 } // namespace NativeEngine::Circuit
@@ -9,16 +9,6 @@
 namespace NativeEngine::Circuit {
 class Diode : public Component {
 public:
-  // Standard Silicon Diode Parameters
-  // Is = 1pA, Vt = 25.85mV, N = 1
-  double Is = 1e-12;
-  double Vt = 0.02585;
-  double N = 1.0;
-
-  // Linearization limits to prevent overflow
-  double Vmax = 3.0;   // Above this, just linear extension
-  double Gmin = 1e-12; // Leakage
-
   std::uint32_t m_nodeAnode = 0;
   std::uint32_t m_nodeCathode = 0;
 
@@ -29,6 +19,42 @@ public:
       m_nodeAnode = nodeId; // Anode
     else if (pinIndex == 1)
       m_nodeCathode = nodeId; // Cathode
+    MarkDirty();
+  }
+
+  void GetNodes(std::vector<std::uint32_t> &out) const override {
+    out.push_back(m_nodeAnode);
+    out.push_back(m_nodeCathode);
+  }
+
+  bool IsNonlinear() const override { return true; }
+
+  // Model parameters. Context keeps a copy per partition; the setters mark
+  // the diode dirty so the next solve picks the new values up.
+  double GetIs() const { return m_is; }
+  double GetVt() const { return m_vt; }
+  double GetN() const { return m_n; }
+  double GetVmax() const { return m_vmax; }
+  double GetGmin() const { return m_gmin; }
+  void SetIs(double is) {
+    m_is = is;
+    MarkDirty();
+  }
+  void SetVt(double vt) {
+    m_vt = vt;
+    MarkDirty();
+  }
+  void SetN(double n) {
+    m_n = n;
+    MarkDirty();
+  }
+  void SetVmax(double vmax) {
+    m_vmax = vmax;
+    MarkDirty();
+  }
+  void SetGmin(double gmin) {
+    m_gmin = gmin;
+    MarkDirty();
   }
 
   void Stamp(Context &ctx) override {
@@ -37,34 +63,12 @@ public:
     double vK = ctx.GetVoltageSafe(m_nodeCathode);
     double vD = vA - vK;
 
-    double thermalV = N * Vt;
+    double thermalV = m_n * m_vt;
+    double expV = std::exp(std::min(vD, m_vmax) / thermalV);
 
     double G_eq = 0;
-    double I_diode = 0;
-
-    if (vD > Vmax) {
-      // Linear extension
-      double expMax = std::exp(Vmax / thermalV);
-      double I_max = Is * (expMax - 1);
-      double G_max = (Is / thermalV) * expMax;
-
-      I_diode = I_max + G_max * (vD - Vmax);
-      G_eq = G_max;
-    } else if (vD < -5.0) {
-      // Reverse bias
-      G_eq = Gmin;
-      I_diode = -Is;
-    } else {
-      // Normal
-      double expV = std::exp(vD / thermalV);
-      I_diode = Is * (expV - 1);
-      G_eq = (Is / thermalV) * expV + Gmin;
-    }
-
-    // Norton Equivalent:
-    // Current I = G_eq * V + I_eq
-    // I_eq = I - G_eq * V
-    double I_source = I_diode - G_eq * vD;
+    double I_source = 0;
+    Linearize(vD, expV, m_is, thermalV, m_vmax, m_gmin, G_eq, I_source);
 
     // Stamp Resistor G_eq
     ctx.StampConductance(m_nodeAnode, m_nodeCathode, G_eq);
@@ -85,5 +89,56 @@ public:
 
     ctx.StampCurrent(m_nodeAnode, m_nodeCathode, I_source);
   }
+
+  double GetPower(const Context &ctx) const override {
+    double vD = ctx.GetVoltageSafe(m_nodeAnode) - ctx.GetVoltageSafe(m_nodeCathode);
+    double thermalV = m_n * m_vt;
+    double expV = std::exp(std::min(vD, m_vmax) / thermalV);
+    double G_eq = 0;
+    double I_source = 0;
+    Linearize(vD, expV, m_is, thermalV, m_vmax, m_gmin, G_eq, I_source);
+    return vD * (G_eq * vD + I_source);
+  }
+
+  // Companion model at junction voltage vD. expV must be
+  // exp(min(vD, vmax) / thermalV); it is passed in so many diodes can have
+  // their exponentials evaluated in one batch (see Context::StampDiodes).
+  static void Linearize(double vD, double expV, double is, double thermalV,
+                        double vmax, double gmin, double &G_eq,
+                        double &I_source) {
+    double I_diode = 0;
+    if (vD > vmax) {
+      // Linear extension
+      double I_max = is * (expV - 1);
+      double G_max = (is / thermalV) * expV;
+
+      I_diode = I_max + G_max * (vD - vmax);
+      G_eq = G_max;
+    } else if (vD < -5.0) {
+      // Reverse bias
+      G_eq = gmin;
+      I_diode = -is;
+    } else {
+      // Normal
+      I_diode = is * (expV - 1);
+      G_eq = (is / thermalV) * expV + gmin;
+    }
+
+    // Norton Equivalent:
+    // Current I = G_eq * V + I_eq
+    // I_eq = I - G_eq * V
+    I_source = I_diode - G_eq * vD;
+  }
+
+private:
+  // Standard Silicon Diode Parameters
+  // Is = 1pA, Vt = 25.85mV, N = 1
+  double m_is = 1e-12;
+  double m_vt = 0.02585;
+  double m_n = 1.0;
+
+  // Linearization limits to prevent overflow
+  double m_vmax = 3.0;   // Above this, just linear extension
+  double m_gmin = 1e-12; // Leakage
 };
 } // namespace NativeEngine::Circuit
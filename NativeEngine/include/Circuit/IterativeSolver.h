@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace NativeEngine::Circuit {
+// Read-only view of a square CSR matrix (columns sorted within each row)
+struct CsrMatrix {
+  std::size_t n = 0;
+  const std::size_t *rowStart = nullptr; // n + 1 entries
+  const std::uint32_t *columns = nullptr;
+  const double *values = nullptr;
+};
+
+struct IterativeResult {
+  int iterations = 0;
+  double residual = 0.0; // ||b - Ax|| / ||b|| at exit
+  bool converged = false;
+};
+
+// Scratch doubles the solvers below need for an n-unknown system
+constexpr std::size_t kIterativeWorkVectors = 8;
+
+/// <summary>
+/// Jacobi-preconditioned conjugate gradient for symmetric positive definite
+/// systems (conductance-only MNA). x holds the initial guess on entry, so a
+/// partition's previous solution warm-starts the solve.
+/// </summary>
+IterativeResult SolveConjugateGradient(const CsrMatrix &A, const double *b,
+                                       double *x, double *work,
+                                       double tolerance, int maxIterations);
+
+/// <summary>
+/// Jacobi-preconditioned BiCGSTAB for general systems (MNA with voltage
+/// source rows). Rows with a zero diagonal are left unscaled. Warm-started
+/// from x like SolveConjugateGradient.
+/// </summary>
+IterativeResult SolveBiCgStab(const CsrMatrix &A, const double *b, double *x,
+                              double *work, double tolerance,
+                              int maxIterations);
+} // namespace NativeEngine::Circuit
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace NativeEngine::Circuit {
+// General dense solve (partial pivoting), used for partitions of any size.
+// A is row-major n x n; A and b are overwritten.
+void SolveLinearSystem(std::vector<double> &A, std::vector<double> &b,
+                       std::vector<double> &x, std::size_t n);
+
+// Largest partition handled by the fixed-size kernels
+constexpr std::size_t kMaxFixedKernelSize = 16;
+
+namespace detail {
+constexpr double kPivotEpsilon = 1e-12;
+
+// The elimination of SolveLinearSystem split into factor and substitute, so
+// a factorization can be reused while the matrix stays the same. N != 0
+// fixes the size at compile time; N == 0 takes it from `count`. Returns the
+// number of columns skipped for a near-zero pivot (singular matrix).
+template <std::size_t N>
+std::size_t FactorLU(double *a, std::size_t *pivots, std::size_t count) {
+  const std::size_t n = N ? N : count;
+  std::size_t singular = 0;
+  for (std::size_t k = 0; k < n; ++k) {
+    std::size_t maxRow = k;
+    double maxVal = std::abs(a[k * n + k]);
+    for (std::size_t i = k + 1; i < n; ++i) {
+      if (std::abs(a[i * n + k]) > maxVal) {
+        maxVal = std::abs(a[i * n + k]);
+        maxRow = i;
+      }
+    }
+    pivots[k] = maxRow;
+    if (maxRow != k) {
+      // Whole rows, so the stored multipliers follow their row
+      for (std::size_t j = 0; j < n; ++j)
+        std::swap(a[k * n + j], a[maxRow * n + j]);
+    }
+
+    const double pivot = a[k * n + k];
+    if (std::abs(pivot) < kPivotEpsilon) {
+      // Column skipped, as in SolveLinearSystem
+      for (std::size_t i = k + 1; i < n; ++i)
+        a[i * n + k] = 0.0;
+      ++singular;
+      continue;
+    }
+
+    for (std::size_t i = k + 1; i < n; ++i) {
+      const double factor = a[i * n + k] / pivot;
+      a[i * n + k] = factor;
+      for (std::size_t j = k + 1; j < n; ++j)
+        a[i * n + j] -= factor * a[k * n + j];
+    }
+  }
+  return singular;
+}
+
+// b is overwritten
+template <std::size_t N>
+void SubstituteLU(const double *lu, const std::size_t *pivots, double *b,
+                  double *x, std::size_t count) {
+  const std::size_t n = N ? N : count;
+  // Rows were swapped whole, so all swaps apply before the forward sweep
+  for (std::size_t k = 0; k < n; ++k) {
+    if (pivots[k] != k)
+      std::swap(b[k], b[pivots[k]]);
+  }
+  for (std::size_t k = 0; k < n; ++k) {
+    for (std::size_t i = k + 1; i < n; ++i)
+      b[i] -= lu[i * n + k] * b[k];
+  }
+  for (std::size_t r = n; r-- > 0;) {
+    double sum = 0.0;
+    for (std::size_t j = r + 1; j < n; ++j)
+      sum += lu[r * n + j] * x[j];
+    const double diag = lu[r * n + r];
+    x[r] = std::abs(diag) > kPivotEpsilon ? (b[r] - sum) / diag : 0.0;
+  }
+}
+} // namespace detail
+
+/// <summary>
+/// Same elimination as SolveLinearSystem with N known at compile time: the
+/// system is copied to stack arrays and every loop has constant bounds, so
+/// the compiler unrolls it completely for the small partitions that make up
+/// most board circuits.
+/// </summary>
+template <std::size_t N>
+void SolveFixedSize(const double *matrix, const double *rhs, double *x) {
+  std::array<double, N * N> a;
+  std::array<double, N> b;
+  std::array<std::size_t, N> pivots;
+  for (std::size_t i = 0; i < N * N; ++i)
+    a[i] = matrix[i];
+  for (std::size_t i = 0; i < N; ++i)
+    b[i] = rhs[i];
+  detail::FactorLU<N>(a.data(), pivots.data(), N);
+  detail::SubstituteLU<N>(a.data(), pivots.data(), b.data(), x, N);
+}
+
+// Factor in stack storage, then store the factors for reuse.
+template <std::size_t N>
+std::size_t FactorFixedSize(double *lu, std::size_t *pivots, std::size_t) {
+  std::array<double, N * N> a;
+  for (std::size_t i = 0; i < N * N; ++i)
+    a[i] = lu[i];
+  std::size_t singular = detail::FactorLU<N>(a.data(), pivots, N);
+  for (std::size_t i = 0; i < N * N; ++i)
+    lu[i] = a[i];
+  return singular;
+}
+
+template <std::size_t N>
+void SubstituteFixedSize(const double *lu, const std::size_t *pivots,
+                         double *b, double *x, std::size_t) {
+  std::array<double, N> y;
+  for (std::size_t i = 0; i < N; ++i)
+    y[i] = b[i];
+  detail::SubstituteLU<N>(lu, pivots, y.data(), x, N);
+}
+
+using FixedSizeSolver = void (*)(const double *, const double *, double *);
+
+/// <summary>
+/// Factor/substitute pair for one system size. Context keeps the factors
+/// and only substitutes while a partition's matrix does not change.
+/// </summary>
+struct LuKernel {
+  // Returns the number of near-zero pivots skipped
+  std::size_t (*factor)(double *lu, std::size_t *pivots, std::size_t n);
+  void (*substitute)(const double *lu, const std::size_t *pivots, double *b,
+                     double *x, std::size_t n);
+};
+
+// Runtime-size pair, for partitions above kMaxFixedKernelSize
+inline constexpr LuKernel kDenseLuKernel = {&detail::FactorLU<0>,
+                                            &detail::SubstituteLU<0>};
+
+namespace detail {
+template <std::size_t... Sizes>
+constexpr std::array<FixedSizeSolver, sizeof...(Sizes) + 1>
+MakeFixedSizeTable(std::index_sequence<Sizes...>) {
+  return {nullptr, &SolveFixedSize<Sizes + 1>...};
+}
+
+template <std::size_t... Sizes>
+constexpr std::array<LuKernel, sizeof...(Sizes) + 1>
+MakeLuKernelTable(std::index_sequence<Sizes...>) {
+  return {LuKernel{nullptr, nullptr},
+          LuKernel{&FactorFixedSize<Sizes + 1>,
+                   &SubstituteFixedSize<Sizes + 1>}...};
+}
+} // namespace detail
+
+// Kernel for an n-unknown system, or nullptr when n is 0 or too large.
+inline FixedSizeSolver GetFixedSizeSolver(std::size_t n) {
+  static constexpr auto table = detail::MakeFixedSizeTable(
+      std::make_index_sequence<kMaxFixedKernelSize>{});
+  return n < table.size() ? table[n] : nullptr;
+}
+
+// Factor/substitute pair for an n-unknown system, or nullptr when n is 0
+// or too large.
+inline const LuKernel *GetFixedSizeLuKernel(std::size_t n) {
+  static constexpr auto table = detail::MakeLuKernelTable(
+      std::make_index_sequence<kMaxFixedKernelSize>{});
+  return (n > 0 && n < table.size()) ? &table[n] : nullptr;
+}
+} // namespace NativeEngine::Circuit
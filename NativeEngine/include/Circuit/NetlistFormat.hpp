@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Compact binary netlist consumed by Native_LoadNetlist.
+//
+// Layout (little-endian, 4-byte aligned, no padding between blocks):
+//   NetlistHeader
+//   NetlistComponent[component_count]
+//   NetlistConnection[connection_count]
+//   float params[param_count]      (pool indexed by NetlistComponent)
+//
+// Node references are local to the netlist: 0 is ground, 1..node_count are
+// the nodes created by the load; node_count may not exceed connection_count.
+// Component references index the component table.
+namespace netlist
+{
+    constexpr std::uint32_t kMagic = 0x54454E52; // "RNET"
+    constexpr std::uint16_t kVersionMajor = 1;
+    constexpr std::uint16_t kVersionMinor = 0;
+
+    struct NetlistHeader
+    {
+        std::uint32_t magic;
+        std::uint16_t version_major;
+        std::uint16_t version_minor;
+        std::uint32_t node_count;
+        std::uint32_t component_count;
+        std::uint32_t connection_count;
+        std::uint32_t param_count;
+    };
+
+    struct NetlistComponent
+    {
+        std::uint16_t type; // NativeEngine::Circuit::ComponentType
+        std::uint16_t param_count;
+        std::uint32_t param_offset;
+    };
+
+    struct NetlistConnection
+    {
+        std::uint32_t component;
+        std::uint16_t pin;
+        std::uint16_t reserved;
+        std::uint32_t node;
+    };
+
+    static_assert(sizeof(NetlistHeader) == 24, "NetlistHeader layout");
+    static_assert(sizeof(NetlistComponent) == 8, "NetlistComponent layout");
+    static_assert(sizeof(NetlistConnection) == 12, "NetlistConnection layout");
+
+    struct NetlistView
+    {
+        const NetlistHeader* header = nullptr;
+        const NetlistComponent* components = nullptr;
+        const NetlistConnection* connections = nullptr;
+        const float* params = nullptr;
+    };
+
+    // Validates every table bound and reference; a view returned from a
+    // successful Open can be walked without further checks.
+    bool Open(const std::uint8_t* buffer, std::size_t size, NetlistView& view, const char** error);
+}
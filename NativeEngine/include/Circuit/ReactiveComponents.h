@@ -0,0 +1,187 @@
+#pragma once
+
+#include "CircuitComponent.h"
+#include "CircuitContext.h"
+#include <algorithm>
+#include <cmath>
+
+namespace NativeEngine::Circuit {
+/// <summary>
+/// Base for energy-storage elements. Each internal substep the context calls
+/// SetTimestep(), solves with the resulting companion model (conductance +
+/// current source), then either Accept()s the step or rolls the node
+/// voltages back to Node::lastVoltage and retries with a smaller h.
+/// </summary>
+class ReactiveComponent : public Component {
+public:
+  ReactiveComponent(std::uint32_t id, ComponentType type)
+      : Component(id, type) {}
+
+  void Connect(std::uint8_t pinIndex, std::uint32_t nodeId) override {
+    if (pinIndex == 0)
+      m_nodeA = nodeId;
+    else if (pinIndex == 1)
+      m_nodeB = nodeId;
+    MarkDirty();
+  }
+
+  void GetNodes(std::vector<std::uint32_t> &out) const override {
+    out.push_back(m_nodeA);
+    out.push_back(m_nodeB);
+  }
+
+  bool IsTimeDependent() const override { return true; }
+
+  void SetTimestep(double h, IntegrationMethod method) {
+    m_h = h;
+    m_method = method;
+  }
+
+  // Ratio of the local truncation error estimate to the allowed error;
+  // above 1 the substep should be rejected.
+  virtual double ErrorRatio(const Context &ctx, double relTol,
+                            double absTol) const = 0;
+
+  // Commit the solved state as the start of the next substep. Returns the
+  // change of the state variable (volts or amps).
+  virtual double Accept(const Context &ctx) = 0;
+
+  std::uint32_t m_nodeA = 0;
+  std::uint32_t m_nodeB = 0;
+
+protected:
+  double Voltage(const Context &ctx) const {
+    return ctx.GetVoltageSafe(m_nodeA) - ctx.GetVoltageSafe(m_nodeB);
+  }
+  double LastVoltage(const Context &ctx) const {
+    return ctx.GetLastVoltage(m_nodeA) - ctx.GetLastVoltage(m_nodeB);
+  }
+
+  // Milne-style estimate: distance between the solved state and a forward
+  // Euler prediction from the previous slope. Exact for backward Euler,
+  // conservative for trapezoidal.
+  static double Ratio(double solved, double previous, double slope, double h,
+                      double relTol, double absTol) {
+    double predicted = previous + h * slope;
+    double error = 0.5 * std::abs(solved - predicted);
+    double tol =
+        relTol * std::max(std::abs(solved), std::abs(previous)) + absTol;
+    return error / tol;
+  }
+
+  double m_h = 1e-3;
+  IntegrationMethod m_method = IntegrationMethod::BackwardEuler;
+};
+
+class Capacitor : public ReactiveComponent {
+public:
+  Capacitor(std::uint32_t id, double capacitance)
+      : ReactiveComponent(id, ComponentType::Capacitor),
+        m_capacitance(capacitance) {
+    if (m_capacitance < 1e-18)
+      m_capacitance = 1e-18;
+  }
+
+  void Stamp(Context &ctx) override {
+    // Backward Euler: i = C/h (v - v0)
+    // Trapezoidal:    i = 2C/h (v - v0) - i0
+    double vPrev = LastVoltage(ctx);
+    double g = Conductance();
+    double iEq = g * vPrev;
+    if (m_method == IntegrationMethod::Trapezoidal)
+      iEq += m_current;
+    ctx.StampConductance(m_nodeA, m_nodeB, g);
+    ctx.StampCurrent(m_nodeB, m_nodeA, iEq);
+  }
+
+  double ErrorRatio(const Context &ctx, double relTol,
+                    double absTol) const override {
+    return Ratio(Voltage(ctx), LastVoltage(ctx), m_current / m_capacitance,
+                 m_h, relTol, absTol);
+  }
+
+  double Accept(const Context &ctx) override {
+    double v = Voltage(ctx);
+    double vPrev = LastVoltage(ctx);
+    double i = Conductance() * (v - vPrev);
+    if (m_method == IntegrationMethod::Trapezoidal)
+      i -= m_current;
+    m_current = i;
+    return std::abs(v - vPrev);
+  }
+
+  double GetPower(const Context &ctx) const override {
+    return Voltage(ctx) * m_current;
+  }
+
+  double GetCapacitance() const { return m_capacitance; }
+  double GetCurrent() const { return m_current; }
+
+private:
+  double Conductance() const {
+    double g = m_capacitance / m_h;
+    return m_method == IntegrationMethod::Trapezoidal ? 2.0 * g : g;
+  }
+
+  double m_capacitance;
+  double m_current = 0.0; // A -> B through the capacitor
+};
+
+class Inductor : public ReactiveComponent {
+public:
+  Inductor(std::uint32_t id, double inductance)
+      : ReactiveComponent(id, ComponentType::Inductor),
+        m_inductance(inductance) {
+    if (m_inductance < 1e-15)
+      m_inductance = 1e-15;
+  }
+
+  void Stamp(Context &ctx) override {
+    // Backward Euler: i = i0 + h/L v
+    // Trapezoidal:    i = i0 + h/2L (v + v0)
+    double g = Conductance();
+    double iEq = m_current;
+    if (m_method == IntegrationMethod::Trapezoidal)
+      iEq += g * LastVoltage(ctx);
+    ctx.StampConductance(m_nodeA, m_nodeB, g);
+    ctx.StampCurrent(m_nodeA, m_nodeB, iEq);
+  }
+
+  double ErrorRatio(const Context &ctx, double relTol,
+                    double absTol) const override {
+    return Ratio(Solved(ctx), m_current, LastVoltage(ctx) / m_inductance, m_h,
+                 relTol, absTol);
+  }
+
+  double Accept(const Context &ctx) override {
+    double i = Solved(ctx);
+    double change = std::abs(i - m_current);
+    m_current = i;
+    return change;
+  }
+
+  double GetPower(const Context &ctx) const override {
+    return Voltage(ctx) * m_current;
+  }
+
+  double GetInductance() const { return m_inductance; }
+  double GetCurrent() const { return m_current; }
+
+private:
+  double Conductance() const {
+    double g = m_h / m_inductance;
+    return m_method == IntegrationMethod::Trapezoidal ? 0.5 * g : g;
+  }
+
+  double Solved(const Context &ctx) const {
+    double g = Conductance();
+    double i = m_current + g * Voltage(ctx);
+    if (m_method == IntegrationMethod::Trapezoidal)
+      i += g * LastVoltage(ctx);
+    return i;
+  }
+
+  double m_inductance;
+  double m_current = 0.0; // A -> B through the coil
+};
+} // namespace NativeEngine::Circuit
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NativeEngine::Circuit {
+/// <summary>
+/// Minimal fork/join worker pool used by the circuit solver.
+/// ParallelFor hands out indices to the workers and the calling thread and
+/// returns once every index has been processed (acts as a barrier).
+/// </summary>
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t workerCount);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::size_t GetWorkerCount() const { return m_workers.size(); }
+
+  void ParallelFor(std::size_t count,
+                   const std::function<void(std::size_t)> &task);
+
+private:
+  void WorkerLoop();
+  void Drain();
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  const std::function<void(std::size_t)> *m_task = nullptr;
+  std::size_t m_count = 0;
+  std::atomic<std::size_t> m_next{0};
+  std::size_t m_busy = 0;
+  std::uint64_t m_generation = 0;
+  bool m_stop = false;
+};
+} // namespace NativeEngine::Circuit
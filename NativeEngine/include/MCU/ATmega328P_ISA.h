@@ -17,6 +17,11 @@ extern "C"
         AVR_EEPROM_END = 0x03FF
     };
 
+    enum
+    {
+        AVR_IO_SYNC_END = 0x200 // AVR_SetIoReadSync and AVR_SetIoWriteNotify cover addresses below this
+    };
+
     enum
     {
         AVR_IO_BASE = 0x20,
@@ -86,6 +91,8 @@ extern "C"
         AVR_TCCR1B = 0x81,
         AVR_TCNT1L = 0x84,
         AVR_TCNT1H = 0x85,
+        AVR_ICR1L = 0x86,
+        AVR_ICR1H = 0x87,
         AVR_OCR1AL = 0x88,
         AVR_OCR1AH = 0x89,
         AVR_OCR1BL = 0x8A,
@@ -175,6 +182,25 @@ extern "C"
         AVR_TIMSK5 = 0x73
     };
 
+    // libgcc runtime routines AVR_SetRuntimeHle recognizes
+    enum
+    {
+        AVR_HLE_UDIVMODQI4 = 0,
+        AVR_HLE_UDIVMODHI4 = 1,
+        AVR_HLE_UDIVMODSI4 = 2,
+        AVR_HLE_ROUTINES = 3
+    };
+
+    // One predecoded flash word: handler (op), operands and base cycle cost.
+    typedef struct AvrDecoded
+    {
+        uint8_t op;     // Handler index; 0 = not decoded yet
+        uint8_t d;      // Destination register / I/O bit owner
+        uint8_t r;      // Source register, immediate or bit number
+        uint8_t cycles; // Cost when no branch is taken
+        uint16_t k;     // I/O or data address, branch offset, second word
+    } AvrDecoded;
+
     typedef struct AvrCore
     {
         uint8_t *flash;
@@ -186,14 +212,38 @@ extern "C"
         uint8_t *regs;
         size_t regs_size;
         uint16_t pc;
-        uint8_t zero_flag;
-        uint8_t carry_flag;
+        // H/S/V/N/Z/C are evaluated lazily: the last flag-setting instruction
+        // leaves its kind, operands and result here, and AVR_GetSreg (or an
+        // SREG read) derives the flags from them. I and T stay in io.
+        uint8_t flags_op;
+        uint8_t flags_base; // Flags the last instruction did not change
+        uint16_t flags_lhs;
+        uint16_t flags_rhs;
+        uint16_t flags_result;
         uint16_t sp;
         void *io_write_user;
         void (*io_write_hook)(struct AvrCore *core, uint16_t address, uint8_t value, void *user);
         void *io_read_user;
         void (*io_read_hook)(struct AvrCore *core, uint16_t address, uint8_t value, void *user);
+        void *io_sync_user;
+        void (*io_sync_hook)(struct AvrCore *core, uint16_t address, void *user);
+        uint32_t io_read_sync[AVR_IO_SYNC_END / 32]; // Bit per address, AVR_SetIoReadSync
+        // What AVR_IoWrite does for each register: store, write-one-to-clear
+        // or core state, whether the write hook runs and whether interrupts
+        // are re-evaluated. Indexed by address.
+        uint8_t io_write_kind[AVR_IO_SYNC_END];
+        uint16_t data_sram_start; // First data address that is plain SRAM
         uint8_t mcu_kind;
+        AvrDecoded *decoded; // Optional, one entry per flash word
+        size_t decoded_size;
+        uint32_t irq_flagged; // Sources with flag and enable bit set
+        uint32_t irq_pending; // irq_flagged while SREG.I is set, else 0
+        uint64_t idle_loop_cycles; // Polling-loop cycles AVR_ExecuteBlock skipped
+        uint64_t flash_loads;      // LPM instructions executed
+        uint8_t sleeping;          // SLEEP ran with SMCR.SE set; an interrupt clears it
+        uint8_t runtime_hle;                  // AVR_SetRuntimeHle
+        uint16_t hle_entry[AVR_HLE_ROUTINES]; // Word address found in flash, 0xFFFF if none
+        uint64_t hle_calls;                   // Routine calls computed natively
     } AvrCore;
 
     enum
@@ -210,10 +260,58 @@ extern "C"
     void AVR_SetMcuKind(AvrCore *core, uint8_t mcu_kind);
     void AVR_SetIoWriteHook(AvrCore *core, void (*hook)(AvrCore *core, uint16_t address, uint8_t value, void *user), void *user);
     void AVR_SetIoReadHook(AvrCore *core, void (*hook)(AvrCore *core, uint16_t address, uint8_t value, void *user), void *user);
+    // Called before an instruction writes I/O, and before it reads a register
+    // marked with AVR_SetIoReadSync, so a caller that advances peripherals
+    // lazily can bring them up to that instruction first.
+    void AVR_SetIoSyncHook(AvrCore *core, void (*hook)(AvrCore *core, uint16_t address, void *user), void *user);
+    // Marks a register whose value the caller computes when read (a timer
+    // counter): IN and LDS of it run as blocks of their own and call the sync
+    // hook first. Drops the decode cache.
+    void AVR_SetIoReadSync(AvrCore *core, uint16_t address, uint8_t sync);
+    // Whether a write to address calls the write hook. Every register does
+    // after AVR_Init; a caller that handles only some of them clears the
+    // rest, so stack and plain register stores skip the hook.
+    void AVR_SetIoWriteNotify(AvrCore *core, uint16_t address, uint8_t notify);
+
+    // Predecode cache owned by the caller (flash_size / 2 entries). Words are
+    // decoded on first execution and reused until invalidated; pass NULL to
+    // decode every instruction again.
+    void AVR_SetDecodeCache(AvrCore *core, AvrDecoded *cache, size_t entries);
+    // Flash bytes [byte_address, byte_address + size) were rewritten: drops the
+    // decoded words of every flash page the range touches.
+    void AVR_InvalidateFlash(AvrCore *core, uint32_t byte_address, size_t size);
+
+    // High-level emulation of libgcc's unsigned division helpers
+    // (__udivmodqi4, __udivmodhi4, __udivmodsi4; the signed ones call them).
+    // Flash is searched for their code now; AVR_InvalidateFlash rechecks only
+    // copies that overlap the rewritten bytes.
+    // Entering one computes it natively: registers, SREG and cycles come out
+    // as the routine leaves them, and execution resumes at its RET. The call
+    // runs as a block of its own and may return more than max_cycles (up to
+    // 72, 205 and 661 cycles): an interrupt that falls due during it is taken
+    // after the RET rather than inside the routine.
+    void AVR_SetRuntimeHle(AvrCore *core, uint8_t enabled);
 
-    uint8_t AVR_ExecuteNext(AvrCore *core);
+    uint32_t AVR_ExecuteNext(AvrCore *core);
+    // Runs instructions until max_cycles are used or an instruction writes
+    // I/O or the stack pointer; that instruction always runs as a block of
+    // its own, first and last. Pending interrupts are taken only on entry.
+    // Returns the cycles used; steps (optional) gets the instructions run,
+    // counting an interrupt entry as one. A loop whose iterations change no
+    // register, flag or memory is fast-forwarded to the end of the block;
+    // cycles and steps still count every iteration. A sleeping core uses all
+    // of max_cycles at once without running anything.
+    uint32_t AVR_ExecuteBlock(AvrCore *core, uint32_t max_cycles, uint32_t *steps);
     uint8_t AVR_IoRead(AvrCore *core, uint16_t address);
+    // SREG with the lazily kept flags materialized; no read hook
+    uint8_t AVR_GetSreg(const AvrCore *core);
     void AVR_IoWrite(AvrCore *core, uint16_t address, uint8_t value);
+    // Peripheral side of a flag register: sets bits where AVR_IoWrite would
+    // clear write-one-to-clear flags, and runs no hook.
+    void AVR_IoSetFlags(AvrCore *core, uint16_t address, uint8_t bits);
+    // Recomputes irq_flagged / irq_pending. AVR_IoWrite and AVR_IoSetFlags
+    // keep them current; call this after writing core->io directly.
+    void AVR_UpdateInterrupts(AvrCore *core);
     void AVR_IoSetBit(AvrCore *core, uint16_t address, uint8_t bit, uint8_t state);
     uint8_t AVR_IoGetBit(AvrCore *core, uint16_t address, uint8_t bit);
 
@@ -0,0 +1,298 @@
+#include "../../include/Circuit/BatchedContext.h"
+#include "../../include/Circuit/Diode.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace NativeEngine::Circuit {
+namespace {
+constexpr std::size_t kSimdWidth = 4; // doubles per AVX2 register
+constexpr double kPivotEpsilon = 1e-12;
+
+// dst[l] -= f[l] * src[l] over a lane-padded row
+inline void SubtractScaled(double *dst, const double *f, const double *src,
+                           std::size_t stride) {
+#if defined(__AVX2__)
+  for (std::size_t l = 0; l < stride; l += kSimdWidth) {
+    __m256d d = _mm256_loadu_pd(dst + l);
+    __m256d s = _mm256_loadu_pd(src + l);
+    __m256d k = _mm256_loadu_pd(f + l);
+    _mm256_storeu_pd(dst + l, _mm256_sub_pd(d, _mm256_mul_pd(k, s)));
+  }
+#else
+  for (std::size_t l = 0; l < stride; ++l)
+    dst[l] -= f[l] * src[l];
+#endif
+}
+
+inline void AddConstant(double *dst, double value, std::size_t stride) {
+  for (std::size_t l = 0; l < stride; ++l)
+    dst[l] += value;
+}
+
+int RowOf(std::uint32_t node) { return node == 0 ? -1 : int(node) - 1; }
+} // namespace
+
+BatchedContext::BatchedContext(std::size_t lanes)
+    : m_lanes(lanes == 0 ? 1 : lanes) {
+  m_stride = (m_lanes + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+}
+
+std::uint32_t BatchedContext::CreateNode() { return m_nodeCount++; }
+
+std::size_t BatchedContext::AddResistor(std::uint32_t nodeA,
+                                        std::uint32_t nodeB, double ohms) {
+  return AddElement(ElementType::Resistor, nodeA, nodeB, ohms);
+}
+
+std::size_t BatchedContext::AddVoltageSource(std::uint32_t nodePos,
+                                             std::uint32_t nodeNeg,
+                                             double volts) {
+  return AddElement(ElementType::VoltageSource, nodePos, nodeNeg, volts);
+}
+
+std::size_t BatchedContext::AddDiode(std::uint32_t anode,
+                                     std::uint32_t cathode,
+                                     double saturationCurrent) {
+  m_nonlinear = true;
+  return AddElement(ElementType::Diode, anode, cathode, saturationCurrent);
+}
+
+std::size_t BatchedContext::AddElement(ElementType type, std::uint32_t nodeA,
+                                       std::uint32_t nodeB, double value) {
+  Element element{type, nodeA < m_nodeCount ? nodeA : 0,
+                  nodeB < m_nodeCount ? nodeB : 0, 0};
+  if (type == ElementType::VoltageSource)
+    element.branch = m_sourceCount++;
+  m_elements.push_back(element);
+  // Padding lanes keep the seed value so they never divide by zero.
+  m_params.resize(m_elements.size() * m_stride, value);
+  return m_elements.size() - 1;
+}
+
+void BatchedContext::SetParameter(std::size_t element, std::size_t lane,
+                                  double value) {
+  if (element < m_elements.size() && lane < m_lanes)
+    m_params[element * m_stride + lane] = value;
+}
+
+void BatchedContext::SetParameters(std::size_t element, const double *values) {
+  if (element >= m_elements.size() || !values)
+    return;
+  std::copy(values, values + m_lanes, m_params.begin() + element * m_stride);
+}
+
+void BatchedContext::SetParameterTable(const double *values) {
+  if (!values)
+    return;
+  for (std::size_t e = 0; e < m_elements.size(); ++e)
+    SetParameters(e, values + e * m_lanes);
+}
+
+void BatchedContext::Resize() {
+  m_size = (m_nodeCount - 1) + m_sourceCount;
+  m_matrix.assign(m_size * m_size * m_stride, 0.0);
+  m_rhs.assign(m_size * m_stride, 0.0);
+  // Node-major, so growing keeps the previous solution as a warm start.
+  m_voltages.resize(std::size_t(m_nodeCount) * m_stride, 0.0);
+  m_scratch.assign(2 * m_stride, 0.0);
+  m_valid.assign(m_lanes, 1);
+  m_converged.assign(m_lanes, 0);
+}
+
+void BatchedContext::Stamp() {
+  std::fill(m_matrix.begin(), m_matrix.end(), 0.0);
+  std::fill(m_rhs.begin(), m_rhs.end(), 0.0);
+
+  static const Diode kDiode(0); // Model constants shared by every lane
+  const double thermalV = kDiode.GetN() * kDiode.GetVt();
+  const std::size_t L = m_stride;
+
+  for (std::size_t e = 0; e < m_elements.size(); ++e) {
+    const Element &el = m_elements[e];
+    const double *param = &m_params[e * L];
+    const int a = RowOf(el.nodeA);
+    const int b = RowOf(el.nodeB);
+
+    switch (el.type) {
+    case ElementType::Resistor:
+    case ElementType::Diode: {
+      double *g = m_scratch.data();
+      double *iSource = m_scratch.data() + L;
+      if (el.type == ElementType::Resistor) {
+        for (std::size_t l = 0; l < L; ++l) {
+          g[l] = 1.0 / std::max(param[l], 1e-9);
+          iSource[l] = 0.0;
+        }
+      } else {
+        const double *va = &m_voltages[el.nodeA * L];
+        const double *vb = &m_voltages[el.nodeB * L];
+        for (std::size_t l = 0; l < L; ++l) {
+          double vD = va[l] - vb[l];
+          double expV = std::exp(std::min(vD, kDiode.GetVmax()) / thermalV);
+          Diode::Linearize(vD, expV, param[l], thermalV, kDiode.GetVmax(),
+                           kDiode.GetGmin(), g[l], iSource[l]);
+        }
+      }
+      for (std::size_t l = 0; l < L; ++l) {
+        if (a != -1) {
+          Entry(a, a)[l] += g[l];
+          m_rhs[a * L + l] -= iSource[l];
+        }
+        if (b != -1) {
+          Entry(b, b)[l] += g[l];
+          m_rhs[b * L + l] += iSource[l];
+        }
+        if (a != -1 && b != -1) {
+          Entry(a, b)[l] -= g[l];
+          Entry(b, a)[l] -= g[l];
+        }
+      }
+      break;
+    }
+    case ElementType::VoltageSource: {
+      const std::size_t row = (m_nodeCount - 1) + el.branch;
+      if (a != -1) {
+        AddConstant(Entry(a, row), 1.0, L);
+        AddConstant(Entry(row, a), 1.0, L);
+      }
+      if (b != -1) {
+        AddConstant(Entry(b, row), -1.0, L);
+        AddConstant(Entry(row, b), -1.0, L);
+      }
+      std::copy(param, param + L, m_rhs.begin() + row * L);
+      break;
+    }
+    }
+  }
+}
+
+void BatchedContext::Factor() {
+  const std::size_t n = m_size;
+  const std::size_t L = m_stride;
+  double *factor = m_scratch.data();
+  double *inverse = m_scratch.data() + L;
+
+  for (std::size_t k = 0; k < n; ++k) {
+    // One pivot order for all lanes, chosen on lane 0.
+    std::size_t pivotRow = k;
+    double best = std::abs(Entry(k, k)[0]);
+    for (std::size_t i = k + 1; i < n; ++i) {
+      double v = std::abs(Entry(i, k)[0]);
+      if (v > best) {
+        best = v;
+        pivotRow = i;
+      }
+    }
+    if (pivotRow != k) {
+      std::swap_ranges(Entry(k, k), Entry(k, 0) + n * L, Entry(pivotRow, k));
+      std::swap_ranges(&m_rhs[k * L], &m_rhs[k * L] + L, &m_rhs[pivotRow * L]);
+    }
+
+    const double *pivot = Entry(k, k);
+    for (std::size_t l = 0; l < L; ++l) {
+      if (std::abs(pivot[l]) < kPivotEpsilon) {
+        inverse[l] = 0.0;
+        if (l < m_lanes)
+          m_valid[l] = 0;
+      } else {
+        inverse[l] = 1.0 / pivot[l];
+      }
+    }
+
+    // Topology is shared, so the pivot row's nonzero columns are nearly the
+    // same in every lane; only those take part in the row updates.
+    m_columns.clear();
+    for (std::size_t j = k; j < n; ++j) {
+      const double *entry = Entry(k, j);
+      for (std::size_t l = 0; l < L; ++l) {
+        if (entry[l] != 0.0) {
+          m_columns.push_back(j);
+          break;
+        }
+      }
+    }
+
+    for (std::size_t i = k + 1; i < n; ++i) {
+      const double *column = Entry(i, k);
+      bool any = false;
+      for (std::size_t l = 0; l < L; ++l) {
+        factor[l] = column[l] * inverse[l];
+        any = any || factor[l] != 0.0;
+      }
+      if (!any)
+        continue; // MNA rows are sparse; most of them skip here
+      for (std::size_t j : m_columns)
+        SubtractScaled(Entry(i, j), factor, Entry(k, j), L);
+      SubtractScaled(&m_rhs[i * L], factor, &m_rhs[k * L], L);
+    }
+  }
+
+  // Back substitution in place: m_rhs becomes the solution.
+  for (std::size_t i = n; i-- > 0;) {
+    double *x = &m_rhs[i * L];
+    for (std::size_t j = i + 1; j < n; ++j)
+      SubtractScaled(x, Entry(i, j), &m_rhs[j * L], L);
+    const double *diag = Entry(i, i);
+    for (std::size_t l = 0; l < L; ++l)
+      x[l] = std::abs(diag[l]) < kPivotEpsilon ? 0.0 : x[l] / diag[l];
+  }
+}
+
+std::size_t BatchedContext::Solve() {
+  Resize();
+  const std::size_t L = m_stride;
+  const int iterations = m_nonlinear ? m_maxIterations : 1;
+
+  for (int iter = 0; iter < iterations; ++iter) {
+    Stamp();
+    Factor();
+
+    double *maxDelta = m_scratch.data();
+    std::fill(maxDelta, maxDelta + L, 0.0);
+    for (std::uint32_t node = 1; node < m_nodeCount; ++node) {
+      double *v = &m_voltages[node * L];
+      const double *x = &m_rhs[(node - 1) * L];
+      for (std::size_t l = 0; l < L; ++l) {
+        maxDelta[l] = std::max(maxDelta[l], std::abs(x[l] - v[l]));
+        v[l] = x[l];
+      }
+    }
+
+    bool all = true;
+    for (std::size_t l = 0; l < m_lanes; ++l) {
+      m_converged[l] = m_valid[l] && (!m_nonlinear || maxDelta[l] < m_epsilon);
+      all = all && (m_converged[l] || !m_valid[l]);
+    }
+    if (all)
+      break;
+  }
+
+  return static_cast<std::size_t>(
+      std::count(m_converged.begin(), m_converged.end(), 1));
+}
+
+double BatchedContext::GetNodeVoltage(std::uint32_t node,
+                                      std::size_t lane) const {
+  if (node == 0 || node >= m_nodeCount || lane >= m_lanes ||
+      m_voltages.size() < std::size_t(m_nodeCount) * m_stride)
+    return 0.0;
+  return m_voltages[node * m_stride + lane];
+}
+
+void BatchedContext::GetVoltages(double *out) const {
+  if (!out)
+    return;
+  for (std::uint32_t node = 0; node < m_nodeCount; ++node) {
+    for (std::size_t lane = 0; lane < m_lanes; ++lane)
+      out[node * m_lanes + lane] = GetNodeVoltage(node, lane);
+  }
+}
+
+bool BatchedContext::IsLaneValid(std::size_t lane) const {
+  return lane < m_valid.size() && m_valid[lane];
+}
+} // namespace NativeEngine::Circuit
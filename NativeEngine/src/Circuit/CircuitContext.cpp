@@ -1,10 +1,55 @@
 #include "../../include/Circuit/CircuitContext.h"
 #include "../../include/Circuit/BasicComponents.h"
+#include "../../include/Circuit/Diode.h"
+#include "../../include/Circuit/ReactiveComponents.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <numeric>
+#include <thread>
 
 namespace NativeEngine::Circuit {
+namespace {
+// Partition whose MNA system receives AddToMatrix/AddToRHS calls on this
+// thread. Set for the duration of SolvePartition().
+thread_local Partition *t_stampTarget = nullptr;
+
+// Adds the scope's duration to `target` when profiling is enabled
+class ScopedTimer {
+public:
+  ScopedTimer(bool enabled, double &target)
+      : m_target(enabled ? &target : nullptr) {
+    if (m_target)
+      m_start = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer() {
+    if (m_target)
+      *m_target += std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - m_start)
+                       .count();
+  }
+
+private:
+  double *m_target;
+  std::chrono::steady_clock::time_point m_start;
+};
+} // namespace
+
+void StepStats::AddWork(const StepStats &other) {
+  partitionsSolved += other.partitionsSolved;
+  newtonIterations += other.newtonIterations;
+  factorizations += other.factorizations;
+  factorReuses += other.factorReuses;
+  iterativeIterations += other.iterativeIterations;
+  pivotWarnings += other.pivotWarnings;
+  nonConverged += other.nonConverged;
+  events += other.events;
+  stampSeconds += other.stampSeconds;
+  solveSeconds += other.solveSeconds;
+  componentSeconds += other.componentSeconds;
+}
+
 Context::Context() : m_time(0.0) {
   m_nodes.push_back({0, 0.0, 0.0, true}); // Ground
 }
@@ -14,18 +59,63 @@ Context::~Context() {}
 void Context::Reset() {
   m_nodes.clear();
   m_components.clear();
+  m_componentSlots.clear();
+  m_componentsByType.clear();
+  m_partitions.clear();
   m_nodes.push_back({0, 0.0, 0.0, true});
+  m_topologyDirty = true;
   m_time = 0.0;
 }
 
+void Context::Reserve(std::size_t nodeCount, std::size_t componentCount) {
+  m_nodes.reserve(nodeCount);
+  m_components.reserve(componentCount);
+  m_componentSlots.reserve(componentCount);
+}
+
 std::uint32_t Context::CreateNode() {
   std::uint32_t id = static_cast<std::uint32_t>(m_nodes.size());
   m_nodes.push_back({id, 0.0, 0.0, false});
+  m_topologyDirty = true;
   return id;
 }
 
 void Context::AddComponent(std::shared_ptr<Component> component) {
-  m_components.push_back(component);
+  if (!component)
+    return;
+  m_componentSlots[component->GetId()] = m_components.size();
+  std::size_t type = static_cast<std::size_t>(component->GetType());
+  if (type >= m_componentsByType.size())
+    m_componentsByType.resize(type + 1);
+  m_componentsByType[type].push_back(component.get());
+  m_components.push_back(std::move(component));
+  m_topologyDirty = true;
+}
+
+Component *Context::FindComponent(std::uint32_t componentId) const {
+  auto it = m_componentSlots.find(componentId);
+  if (it == m_componentSlots.end())
+    return nullptr;
+  return m_components[it->second].get();
+}
+
+const std::vector<Component *> &
+Context::GetComponentsOfType(ComponentType type) const {
+  static const std::vector<Component *> empty;
+  std::size_t index = static_cast<std::size_t>(type);
+  if (index >= m_componentsByType.size())
+    return empty;
+  return m_componentsByType[index];
+}
+
+bool Context::ConnectComponent(std::uint32_t componentId,
+                               std::uint8_t pinIndex, std::uint32_t nodeId) {
+  Component *comp = FindComponent(componentId);
+  if (!comp)
+    return false;
+  comp->Connect(pinIndex, nodeId);
+  m_topologyDirty = true;
+  return true;
 }
 
 Node *Context::GetNode(std::uint32_t id) {
@@ -46,22 +136,41 @@ double Context::GetVoltageSafe(std::uint32_t nodeId) const {
   return 0.0;
 }
 
-void Context::ResizeMatrix(std::size_t size) {
-  m_matrix.assign(size * size, 0.0);
-  m_rhs.assign(size, 0.0);
-  m_solution.assign(size, 0.0);
+double Context::GetLastVoltage(std::uint32_t nodeId) const {
+  if (nodeId < m_nodes.size())
+    return m_nodes[nodeId].lastVoltage;
+  return 0.0;
+}
+
+std::ptrdiff_t Partition::Slot(std::size_t row, std::size_t col) const {
+  if (row >= matrixSize || col >= matrixSize)
+    return -1;
+  if (!sparse)
+    return static_cast<std::ptrdiff_t>(row * matrixSize + col);
+  auto first = columns.begin() + rowStart[row];
+  auto last = columns.begin() + rowStart[row + 1];
+  auto it = std::lower_bound(first, last, static_cast<std::uint32_t>(col));
+  if (it == last || *it != col)
+    return -1;
+  return it - columns.begin();
 }
 
 void Context::AddToMatrix(std::size_t row, std::size_t col, double value) {
-  std::size_t size = m_rhs.size();
-  if (row < size && col < size) {
-    m_matrix[row * size + col] += value;
+  Partition *p = t_stampTarget;
+  if (!p)
+    return;
+  std::ptrdiff_t slot = p->Slot(row, col);
+  if (slot != -1) {
+    p->matrix[slot] += value;
   }
 }
 
 void Context::AddToRHS(std::size_t row, double value) {
-  if (row < m_rhs.size()) {
-    m_rhs[row] += value;
+  Partition *p = t_stampTarget;
+  if (!p)
+    return;
+  if (row < p->matrixSize) {
+    p->rhs[row] += value;
   }
 }
 
@@ -142,6 +251,8 @@ void SolveLinearSystem(std::vector<double> &A, std::vector<double> &b,
 }
 
 void Context::Step(double dt) {
+  m_stepStats = StepStats();
+  ScopedTimer stepTimer(m_profileTimings, m_stepStats.stepSeconds);
   m_dt = dt;
   m_timeIsTransient = true;
 
@@ -149,49 +260,643 @@ void Context::Step(double dt) {
     node.lastVoltage = node.voltage;
   }
 
-  for (int iter = 0; iter < m_maxIterations; ++iter) {
-    SolveMNA();
+  if (m_topologyDirty) {
+    BuildPartitions();
   }
 
-  // Step Components (e.g. CPU)
-  for (auto &comp : m_components) {
-    comp->Step(dt);
+  m_pendingPartitions.clear();
+  std::size_t parallelCount = 0;
+  for (auto &partition : m_partitions) {
+    partition.time = 0.0;
+    partition.stats = StepStats();
+    if (!NeedsSolve(partition))
+      continue;
+    m_pendingPartitions.push_back(&partition);
+    if (partition.matrixSize >= m_parallelMinUnknowns)
+      ++parallelCount;
+  }
+
+  ThreadPool *pool = parallelCount > 1 ? GetThreadPool() : nullptr;
+  if (pool) {
+    // Large partitions first so the pool is not left waiting on a big
+    // straggler picked up last.
+    std::stable_partition(m_pendingPartitions.begin(),
+                          m_pendingPartitions.end(), [this](Partition *p) {
+                            return p->matrixSize >= m_parallelMinUnknowns;
+                          });
+    pool->ParallelFor(parallelCount, [this, dt](std::size_t i) {
+      SolvePending(*m_pendingPartitions[i], dt);
+    });
+    for (std::size_t i = parallelCount; i < m_pendingPartitions.size(); ++i) {
+      SolvePending(*m_pendingPartitions[i], dt);
+    }
+  } else {
+    for (Partition *partition : m_pendingPartitions) {
+      SolvePending(*partition, dt);
+    }
+  }
+
+  // Step Components (e.g. CPU). Partitions share no nodes, and MCUs
+  // stepped unsplit only see the levels solved above, so both loops fan
+  // out to the pool; ParallelFor returns once all are done, before the
+  // next solve.
+  if (m_interleaveEvents) {
+    ThreadPool *componentPool =
+        m_parallelComponents && m_eventPartitions.size() > 1 ? GetThreadPool()
+                                                             : nullptr;
+    if (componentPool) {
+      componentPool->ParallelFor(m_eventPartitions.size(),
+                                 [this, dt](std::size_t i) {
+                                   AdvanceEventComponents(*m_eventPartitions[i],
+                                                          dt);
+                                 });
+    } else {
+      for (Partition *partition : m_eventPartitions)
+        AdvanceEventComponents(*partition, dt);
+    }
+    ScopedTimer timer(m_profileTimings, m_stepStats.componentSeconds);
+    for (Component *comp : m_steppedComponents) {
+      comp->Step(dt);
+    }
+  } else {
+    ScopedTimer timer(m_profileTimings, m_stepStats.componentSeconds);
+    ThreadPool *componentPool =
+        m_parallelComponents && m_eventDriven.size() > 1 ? GetThreadPool()
+                                                         : nullptr;
+    if (componentPool) {
+      componentPool->ParallelFor(m_eventDriven.size(), [this, dt](std::size_t i) {
+        m_eventDriven[i]->Step(dt);
+      });
+      for (auto &comp : m_components) {
+        if (!comp->IsEventDriven())
+          comp->Step(dt);
+      }
+    } else {
+      for (auto &comp : m_components) {
+        comp->Step(dt);
+      }
+    }
+  }
+
+  m_stepStats.partitionCount = static_cast<std::uint32_t>(m_partitions.size());
+  for (const auto &partition : m_partitions) {
+    m_stepStats.AddWork(partition.stats);
+    m_stepStats.unknowns += static_cast<std::uint32_t>(partition.matrixSize);
+    m_stepStats.largestPartition =
+        std::max(m_stepStats.largestPartition,
+                 static_cast<std::uint32_t>(partition.matrixSize));
+    m_stepStats.nonzeros += partition.nonzeros;
   }
 
   m_time += dt;
 }
 
-void Context::SolveMNA() {
-  m_nodeToMatrixIndex.assign(m_nodes.size(), -1);
-  std::size_t matrixSize = 0;
+ThreadPool *Context::GetThreadPool() {
+  if (m_solverThreads == 1)
+    return nullptr;
+  if (!m_threadPool) {
+    std::size_t workers = m_solverThreads;
+    if (workers == 0) {
+      unsigned hw = std::thread::hardware_concurrency();
+      workers = hw > 1 ? static_cast<std::size_t>(hw) : 1;
+    }
+    // The calling thread also works, so spawn one fewer.
+    if (workers <= 1)
+      return nullptr;
+    m_threadPool = std::make_unique<ThreadPool>(workers - 1);
+  }
+  return m_threadPool.get();
+}
 
-  for (std::size_t i = 1; i < m_nodes.size(); ++i) {
-    m_nodeToMatrixIndex[i] = static_cast<int>(matrixSize++);
+void Context::BuildPartitions() {
+  const std::size_t nodeCount = m_nodes.size();
+  std::vector<std::uint32_t> parent(nodeCount);
+  std::iota(parent.begin(), parent.end(), 0u);
+  auto find = [&parent](std::uint32_t n) {
+    while (parent[n] != n) {
+      parent[n] = parent[parent[n]];
+      n = parent[n];
+    }
+    return n;
+  };
+
+  // Union every non-ground node a component touches. Ground is the shared
+  // reference and does not join islands.
+  std::vector<std::uint32_t> pins;
+  std::vector<std::uint32_t> componentRoot(m_components.size(), 0);
+  for (std::size_t c = 0; c < m_components.size(); ++c) {
+    pins.clear();
+    m_components[c]->GetNodes(pins);
+    std::uint32_t root = 0;
+    for (std::uint32_t node : pins) {
+      if (node == 0 || node >= nodeCount)
+        continue;
+      std::uint32_t r = find(node);
+      if (root == 0) {
+        root = r;
+      } else if (r != root) {
+        parent[r] = root;
+      }
+    }
+    componentRoot[c] = root;
   }
 
+  m_partitions.clear();
+  m_steppedComponents.clear();
+  m_eventPartitions.clear();
+  m_eventDriven.clear();
+  std::vector<int> rootToPartition(nodeCount, -1);
+  for (std::size_t c = 0; c < m_components.size(); ++c) {
+    Component *comp = m_components[c].get();
+    if (componentRoot[c] == 0) {
+      // Only touches ground: contributes nothing, but may still run
+      m_steppedComponents.push_back(comp);
+      continue;
+    }
+    std::uint32_t root = find(componentRoot[c]);
+    if (rootToPartition[root] == -1) {
+      rootToPartition[root] = static_cast<int>(m_partitions.size());
+      m_partitions.emplace_back();
+    }
+    Partition &partition = m_partitions[rootToPartition[root]];
+    partition.components.push_back(comp);
+    partition.nonlinear = partition.nonlinear || comp->IsNonlinear();
+    if (comp->GetType() == ComponentType::Capacitor ||
+        comp->GetType() == ComponentType::Inductor) {
+      // Integrated with adaptive substeps; may settle and stop solving
+      partition.reactive.push_back(comp);
+    } else {
+      partition.timeDependent =
+          partition.timeDependent || comp->IsTimeDependent();
+    }
+    if (comp->IsEventDriven()) {
+      partition.eventComponents.push_back(comp);
+    } else {
+      m_steppedComponents.push_back(comp);
+    }
+  }
   for (auto &comp : m_components) {
-    if (comp->GetType() == ComponentType::VoltageSource) {
-      auto vs = std::static_pointer_cast<VoltageSource>(comp);
-      vs->m_matrixIndex = matrixSize++;
+    if (comp->IsEventDriven())
+      m_eventDriven.push_back(comp.get());
+  }
+  for (auto &partition : m_partitions) {
+    if (!partition.eventComponents.empty())
+      m_eventPartitions.push_back(&partition);
+  }
+
+  m_nodeToMatrixIndex.assign(nodeCount, -1);
+  for (std::uint32_t n = 1; n < nodeCount; ++n) {
+    int index = rootToPartition[find(n)];
+    if (index == -1) {
+      m_nodes[n].voltage = 0.0; // Floating node with nothing attached
+      continue;
+    }
+    Partition &partition = m_partitions[index];
+    m_nodeToMatrixIndex[n] = static_cast<int>(partition.nodes.size());
+    partition.nodes.push_back(n);
+  }
+
+  for (auto &partition : m_partitions) {
+    std::size_t matrixSize = partition.nodes.size();
+    for (Component *comp : partition.components) {
+      if (comp->GetType() == ComponentType::VoltageSource) {
+        static_cast<VoltageSource *>(comp)->m_matrixIndex = matrixSize++;
+        partition.voltageSources.push_back(comp);
+      }
+    }
+    partition.matrixSize = matrixSize;
+    partition.sparse = m_linearSolver == LinearSolverBackend::Iterative &&
+                       matrixSize >= m_iterativeMinUnknowns;
+    std::size_t entries = matrixSize * matrixSize;
+    if (partition.sparse) {
+      BuildSparsePattern(partition);
+      partition.symmetric = partition.voltageSources.empty();
+      partition.work.assign(kIterativeWorkVectors * matrixSize, 0.0);
+      entries = partition.columns.size();
+      partition.nonzeros = entries;
+    } else {
+      partition.luKernel = matrixSize <= m_fixedKernelMaxUnknowns
+                               ? GetFixedSizeLuKernel(matrixSize)
+                               : nullptr;
+      if (!partition.luKernel)
+        partition.luKernel = &kDenseLuKernel;
+      partition.pivots.assign(matrixSize, 0);
+    }
+    partition.baseMatrix.assign(entries, 0.0);
+    partition.matrix.assign(entries, 0.0);
+    partition.rhs.assign(matrixSize, 0.0);
+    // Current voltages are the warm start after a rebuild; branch currents
+    // start from zero.
+    partition.solution.assign(matrixSize, 0.0);
+    for (std::size_t i = 0; i < partition.nodes.size(); ++i)
+      partition.solution[i] = m_nodes[partition.nodes[i]].voltage;
+    partition.eventClock.assign(partition.eventComponents.size(), 0.0);
+
+    // Sort components into stamp batches: resistors are folded into the
+    // base matrix here, diodes go to the SoA batch, the rest stay virtual.
+    DiodeBatch &diodes = partition.diodes;
+    for (Component *comp : partition.components) {
+      if (comp->GetType() == ComponentType::Resistor) {
+        auto *r = static_cast<Resistor *>(comp);
+        int a = GetMatrixIndex(r->m_nodeA);
+        int b = GetMatrixIndex(r->m_nodeB);
+        double g = r->GetConductance();
+        if (a != -1)
+          partition.baseMatrix[partition.Slot(a, a)] += g;
+        if (b != -1)
+          partition.baseMatrix[partition.Slot(b, b)] += g;
+        if (a != -1 && b != -1) {
+          partition.baseMatrix[partition.Slot(a, b)] -= g;
+          partition.baseMatrix[partition.Slot(b, a)] -= g;
+        }
+      } else if (comp->GetType() == ComponentType::Diode) {
+        auto *d = static_cast<Diode *>(comp);
+        // Out-of-range pins read as ground, like GetVoltageSafe()
+        diodes.anodeNode.push_back(d->m_nodeAnode < nodeCount ? d->m_nodeAnode : 0);
+        diodes.cathodeNode.push_back(
+            d->m_nodeCathode < nodeCount ? d->m_nodeCathode : 0);
+        const int a = GetMatrixIndex(d->m_nodeAnode);
+        const int k = GetMatrixIndex(d->m_nodeCathode);
+        diodes.anodeRow.push_back(a);
+        diodes.cathodeRow.push_back(k);
+        diodes.slotAA.push_back(a != -1 ? partition.Slot(a, a) : -1);
+        diodes.slotKK.push_back(k != -1 ? partition.Slot(k, k) : -1);
+        const bool both = a != -1 && k != -1;
+        diodes.slotAK.push_back(both ? partition.Slot(a, k) : -1);
+        diodes.slotKA.push_back(both ? partition.Slot(k, a) : -1);
+        diodes.device.push_back(d);
+        diodes.is.push_back(d->GetIs());
+        diodes.thermalV.push_back(d->GetN() * d->GetVt());
+        diodes.vmax.push_back(d->GetVmax());
+        diodes.gmin.push_back(d->GetGmin());
+      } else {
+        partition.stampComponents.push_back(comp);
+      }
+    }
+    diodes.vd.assign(diodes.Size(), 0.0);
+    diodes.expV.assign(diodes.Size(), 0.0);
+    diodes.lastVd.assign(diodes.Size(), 0.0);
+    diodes.g.assign(diodes.Size(), 0.0);
+    diodes.iSource.assign(diodes.Size(), 0.0);
+    diodes.active.reserve(diodes.Size());
+  }
+
+  m_topologyDirty = false;
+}
+
+void Context::BuildSparsePattern(Partition &partition) {
+  const std::size_t n = partition.matrixSize;
+  std::vector<std::vector<std::uint32_t>> rows(n);
+  for (std::size_t i = 0; i < n; ++i)
+    rows[i].push_back(static_cast<std::uint32_t>(i)); // Jacobi needs the diagonal
+
+  // A component can only couple the rows of its own pins (and its branch)
+  std::vector<std::uint32_t> pins;
+  std::vector<std::uint32_t> local;
+  for (Component *comp : partition.components) {
+    pins.clear();
+    local.clear();
+    comp->GetNodes(pins);
+    for (std::uint32_t node : pins) {
+      int row = GetMatrixIndex(node);
+      if (row != -1)
+        local.push_back(static_cast<std::uint32_t>(row));
     }
+    if (comp->GetType() == ComponentType::VoltageSource)
+      local.push_back(static_cast<std::uint32_t>(
+          static_cast<VoltageSource *>(comp)->m_matrixIndex));
+    for (std::uint32_t r : local)
+      rows[r].insert(rows[r].end(), local.begin(), local.end());
   }
 
-  if (matrixSize == 0)
+  partition.rowStart.assign(n + 1, 0);
+  partition.columns.clear();
+  for (std::size_t i = 0; i < n; ++i) {
+    std::sort(rows[i].begin(), rows[i].end());
+    rows[i].erase(std::unique(rows[i].begin(), rows[i].end()), rows[i].end());
+    partition.columns.insert(partition.columns.end(), rows[i].begin(),
+                             rows[i].end());
+    partition.rowStart[i + 1] = partition.columns.size();
+  }
+}
+
+bool Context::NeedsSolve(const Partition &partition) const {
+  if (partition.dirty || !partition.converged || partition.timeDependent)
+    return true;
+  if (!partition.reactive.empty() && !partition.settled)
+    return true;
+  for (const Component *comp : partition.components) {
+    if (comp->IsDirty())
+      return true;
+  }
+  return false;
+}
+
+void Context::AdvanceEventComponents(Partition &partition, double dt) {
+  auto &components = partition.eventComponents;
+  auto &clock = partition.eventClock;
+  std::fill(clock.begin(), clock.end(), 0.0);
+
+  std::size_t events = 0;
+  for (;;) {
+    // Advance whichever component lags furthest behind, so with several
+    // MCUs on one net the events are applied roughly in time order.
+    std::size_t next = components.size();
+    double earliest = dt;
+    for (std::size_t i = 0; i < components.size(); ++i) {
+      if (clock[i] < earliest) {
+        earliest = clock[i];
+        next = i;
+      }
+    }
+    if (next == components.size())
+      break;
+
+    Component *comp = components[next];
+    double remaining = dt - earliest;
+    if (events >= m_maxEventsPerStep) {
+      ScopedTimer timer(m_profileTimings, partition.stats.componentSeconds);
+      comp->Step(remaining);
+      clock[next] = dt;
+      continue;
+    }
+
+    double advanced = 0.0;
+    {
+      ScopedTimer timer(m_profileTimings, partition.stats.componentSeconds);
+      advanced = comp->StepUntilEvent(remaining);
+    }
+    clock[next] =
+        (advanced <= 0.0 || advanced >= remaining) ? dt : earliest + advanced;
+    if (comp->IsDirty()) {
+      // Output changed mid-step: re-solve so inputs sampled from here on
+      // (by every component in the partition) see the new levels.
+      if (partition.reactive.empty())
+        SolvePartition(partition);
+      else
+        IntegratePartition(partition, clock[next]);
+      ++partition.eventCount;
+      ++partition.stats.events;
+      ++events;
+    }
+  }
+
+  if (!partition.reactive.empty())
+    IntegratePartition(partition, dt);
+}
+
+void Context::SolvePending(Partition &partition, double dt) {
+  if (partition.reactive.empty()) {
+    SolvePartition(partition);
+  } else if (partition.eventComponents.empty() || !m_interleaveEvents) {
+    IntegratePartition(partition, dt);
+  }
+  // Otherwise AdvanceEventComponents integrates between the MCU events.
+}
+
+void Context::IntegratePartition(Partition &partition, double until) {
+  bool changed = partition.dirty;
+  for (const Component *comp : partition.components) {
+    changed = changed || comp->IsDirty();
+  }
+  if (changed) {
+    partition.restart = true;
+    partition.settled = false;
+  }
+  if (partition.settled) {
+    partition.time = std::max(partition.time, until);
     return;
+  }
+
+  double remaining = until - partition.time;
+  if (remaining < m_minSubstep) {
+    if (!changed)
+      return;
+    // A new stamp landed at the current time; give it a minimal step.
+    remaining = m_minSubstep;
+  }
+  const double end = partition.time + remaining;
+
+  double h = partition.substep > 0.0 ? std::min(partition.substep, remaining)
+                                     : remaining;
+  double movement = 0.0;
+  while (end - partition.time > 0.5 * m_minSubstep) {
+    const double left = end - partition.time;
+    h = std::min(h, left);
+    if (left - h < m_minSubstep)
+      h = left; // Do not leave a sliver for the next iteration
+
+    // Backward Euler right after a discontinuity: trapezoidal would ring.
+    const IntegrationMethod method = partition.restart
+                                         ? IntegrationMethod::BackwardEuler
+                                         : m_integrationMethod;
+    for (Component *comp : partition.reactive) {
+      static_cast<ReactiveComponent *>(comp)->SetTimestep(h, method);
+    }
+    SolvePartition(partition);
 
-  ResizeMatrix(matrixSize);
+    double ratio = 0.0;
+    for (Component *comp : partition.reactive) {
+      ratio = std::max(ratio, static_cast<ReactiveComponent *>(comp)->ErrorRatio(
+                                  *this, m_lteRelTol, m_lteAbsTol));
+    }
 
-  for (auto &comp : m_components) {
-    comp->Stamp(*this);
+    if ((ratio > 1.0 || !partition.converged) && h > m_minSubstep) {
+      // Reject: roll back to the start of the substep and retry smaller.
+      for (std::uint32_t n : partition.nodes) {
+        m_nodes[n].voltage = m_nodes[n].lastVoltage;
+      }
+      double shrink = partition.converged ? 0.9 / std::sqrt(ratio) : 0.25;
+      h = std::max(m_minSubstep, h * std::max(0.1, shrink));
+      ++partition.rejectedSteps;
+      continue;
+    }
+
+    double stepMovement = 0.0;
+    for (Component *comp : partition.reactive) {
+      stepMovement = std::max(
+          stepMovement, static_cast<ReactiveComponent *>(comp)->Accept(*this));
+    }
+    movement += stepMovement;
+    for (std::uint32_t n : partition.nodes) {
+      m_nodes[n].lastVoltage = m_nodes[n].voltage;
+    }
+    partition.time += h;
+    partition.restart = false;
+    ++partition.acceptedSteps;
+
+    // LTE of both methods is estimated at O(h^2), hence the square root.
+    double grow = ratio > 0.0 ? 0.9 / std::sqrt(ratio) : 4.0;
+    h *= std::min(4.0, grow);
+    partition.substep = h;
+  }
+
+  partition.settled =
+      !changed && partition.converged && movement < m_settleTolerance;
+}
+
+void Context::StampDiodes(Partition &partition) {
+  DiodeBatch &d = partition.diodes;
+  const std::size_t count = d.Size();
+  if (count == 0)
+    return;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    d.vd[i] = m_nodes[d.anodeNode[i]].voltage - m_nodes[d.cathodeNode[i]].voltage;
+  }
+
+  // Only diodes that moved are relinearized; the rest restamp their last
+  // companion model, so a quiet partition stamps a bit-identical matrix.
+  // A dirty diode had its parameters changed through its setters: reload
+  // them and never bypass it.
+  d.active.clear();
+  const bool all = !d.linearized || m_bypassTolerance <= 0.0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const Diode *device = d.device[i];
+    const bool dirty = device->IsDirty();
+    if (dirty) {
+      d.is[i] = device->GetIs();
+      d.thermalV[i] = device->GetN() * device->GetVt();
+      d.vmax[i] = device->GetVmax();
+      d.gmin[i] = device->GetGmin();
+    }
+    if (all || dirty || std::abs(d.vd[i] - d.lastVd[i]) >= m_bypassTolerance)
+      d.active.push_back(i);
+  }
+  partition.bypassCount += count - d.active.size();
+
+  // Branch-free argument so this loop can use a vector exp.
+  const std::size_t activeCount = d.active.size();
+  for (std::size_t j = 0; j < activeCount; ++j) {
+    const std::size_t i = d.active[j];
+    d.expV[j] = std::exp(std::min(d.vd[i], d.vmax[i]) / d.thermalV[i]);
+  }
+  for (std::size_t j = 0; j < activeCount; ++j) {
+    const std::size_t i = d.active[j];
+    Diode::Linearize(d.vd[i], d.expV[j], d.is[i], d.thermalV[i], d.vmax[i],
+                     d.gmin[i], d.g[i], d.iSource[i]);
+    d.lastVd[i] = d.vd[i];
+  }
+  d.linearized = true;
+
+  double *matrix = partition.matrix.data();
+  double *rhs = partition.rhs.data();
+  for (std::size_t i = 0; i < count; ++i) {
+    const double g = d.g[i];
+    const double iSource = d.iSource[i];
+    const int a = d.anodeRow[i];
+    const int k = d.cathodeRow[i];
+    if (a != -1) {
+      matrix[d.slotAA[i]] += g;
+      rhs[a] -= iSource;
+    }
+    if (k != -1) {
+      matrix[d.slotKK[i]] += g;
+      rhs[k] += iSource;
+    }
+    if (a != -1 && k != -1) {
+      matrix[d.slotAK[i]] -= g;
+      matrix[d.slotKA[i]] -= g;
+    }
   }
+}
+
+void Context::SolvePartition(Partition &partition) {
+  const std::size_t n = partition.matrixSize;
+  if (n == 0)
+    return;
+
+  StepStats &stats = partition.stats;
+  ++stats.partitionsSolved;
+  t_stampTarget = &partition;
+  bool converged = false;
+  for (int iter = 0; iter < m_maxIterations; ++iter) {
+    ++stats.newtonIterations;
+    {
+      ScopedTimer timer(m_profileTimings, stats.stampSeconds);
+      std::copy(partition.baseMatrix.begin(), partition.baseMatrix.end(),
+                partition.matrix.begin());
+      std::fill(partition.rhs.begin(), partition.rhs.end(), 0.0);
+
+      StampDiodes(partition);
+      for (Component *comp : partition.stampComponents) {
+        comp->Stamp(*this);
+      }
+    }
+
+    ScopedTimer solveTimer(m_profileTimings, stats.solveSeconds);
+    if (partition.sparse) {
+      // Warm-started from the previous solution, which is nearly right
+      CsrMatrix view{n, partition.rowStart.data(), partition.columns.data(),
+                     partition.matrix.data()};
+      IterativeResult result =
+          partition.symmetric
+              ? SolveConjugateGradient(view, partition.rhs.data(),
+                                       partition.solution.data(),
+                                       partition.work.data(),
+                                       m_iterativeTolerance,
+                                       m_iterativeMaxIterations)
+              : SolveBiCgStab(view, partition.rhs.data(),
+                              partition.solution.data(), partition.work.data(),
+                              m_iterativeTolerance, m_iterativeMaxIterations);
+      partition.iterativeIterations += result.iterations;
+      stats.iterativeIterations += static_cast<std::uint32_t>(result.iterations);
+      if (!result.converged) {
+        ++partition.iterativeFailures;
+        ++stats.nonConverged;
+      }
+    } else {
+      // Refactor only when the stamped matrix differs from the factored one
+      // (bypassed diodes, constant sources and resistors leave it as is).
+      if (partition.factored &&
+          std::equal(partition.matrix.begin(), partition.matrix.end(),
+                     partition.factoredMatrix.begin())) {
+        ++partition.factorReuseCount;
+        ++stats.factorReuses;
+      } else {
+        partition.factoredMatrix = partition.matrix;
+        partition.lu = partition.matrix;
+        stats.pivotWarnings += static_cast<std::uint32_t>(
+            partition.luKernel->factor(partition.lu.data(),
+                                       partition.pivots.data(), n));
+        partition.factored = true;
+        partition.nonzeros = static_cast<std::size_t>(
+            partition.matrix.size() -
+            std::count(partition.matrix.begin(), partition.matrix.end(), 0.0));
+        ++partition.factorCount;
+        ++stats.factorizations;
+      }
+      partition.luKernel->substitute(
+          partition.lu.data(), partition.pivots.data(), partition.rhs.data(),
+          partition.solution.data(), n);
+    }
 
-  SolveLinearSystem(m_matrix, m_rhs, m_solution, matrixSize);
+    double maxDelta = 0.0;
+    for (std::size_t i = 0; i < partition.nodes.size(); ++i) {
+      Node &node = m_nodes[partition.nodes[i]];
+      maxDelta = std::max(maxDelta, std::abs(partition.solution[i] - node.voltage));
+      node.voltage = partition.solution[i];
+    }
 
-  for (std::size_t i = 1; i < m_nodes.size(); ++i) {
-    int idx = m_nodeToMatrixIndex[i];
-    if (idx != -1) {
-      m_nodes[i].voltage = m_solution[idx];
+    if (!partition.nonlinear || maxDelta < m_epsilon) {
+      converged = true;
+      break;
     }
   }
+  t_stampTarget = nullptr;
+  if (!converged)
+    ++stats.nonConverged;
+
+  // MNA branch unknowns are the current into the + terminal.
+  for (Component *comp : partition.voltageSources) {
+    auto *vs = static_cast<VoltageSource *>(comp);
+    vs->m_current = -partition.solution[vs->m_matrixIndex];
+  }
+  for (Component *comp : partition.components) {
+    comp->ClearDirty();
+  }
+  partition.dirty = false;
+  partition.converged = converged;
+  ++partition.solveCount;
 }
 } // namespace NativeEngine::Circuit
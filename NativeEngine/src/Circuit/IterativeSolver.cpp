@@ -0,0 +1,183 @@
+#include "../../include/Circuit/IterativeSolver.h"
+#include <cmath>
+
+namespace NativeEngine::Circuit {
+namespace {
+void Multiply(const CsrMatrix &A, const double *x, double *y) {
+  for (std::size_t i = 0; i < A.n; ++i) {
+    double sum = 0.0;
+    for (std::size_t k = A.rowStart[i]; k < A.rowStart[i + 1]; ++k)
+      sum += A.values[k] * x[A.columns[k]];
+    y[i] = sum;
+  }
+}
+
+double Dot(const double *a, const double *b, std::size_t n) {
+  double sum = 0.0;
+  for (std::size_t i = 0; i < n; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+// Inverse diagonal; 1 where the diagonal is (near) zero
+void BuildJacobi(const CsrMatrix &A, double *inverseDiag) {
+  for (std::size_t i = 0; i < A.n; ++i) {
+    double d = 0.0;
+    for (std::size_t k = A.rowStart[i]; k < A.rowStart[i + 1]; ++k) {
+      if (A.columns[k] == i) {
+        d = A.values[k];
+        break;
+      }
+    }
+    inverseDiag[i] = std::abs(d) > 1e-300 ? 1.0 / d : 1.0;
+  }
+}
+
+// r = b - Ax; returns ||b|| (1 when b is zero, so the tolerance is absolute)
+double Residual(const CsrMatrix &A, const double *b, const double *x,
+                double *r) {
+  Multiply(A, x, r);
+  for (std::size_t i = 0; i < A.n; ++i)
+    r[i] = b[i] - r[i];
+  double bNorm = std::sqrt(Dot(b, b, A.n));
+  return bNorm > 0.0 ? bNorm : 1.0;
+}
+} // namespace
+
+IterativeResult SolveConjugateGradient(const CsrMatrix &A, const double *b,
+                                       double *x, double *work,
+                                       double tolerance, int maxIterations) {
+  const std::size_t n = A.n;
+  double *r = work;
+  double *z = work + n;
+  double *p = work + 2 * n;
+  double *ap = work + 3 * n;
+  double *inverseDiag = work + 4 * n;
+
+  IterativeResult result;
+  BuildJacobi(A, inverseDiag);
+  const double bNorm = Residual(A, b, x, r);
+  result.residual = std::sqrt(Dot(r, r, n)) / bNorm;
+  if (result.residual <= tolerance) {
+    result.converged = true;
+    return result;
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    z[i] = inverseDiag[i] * r[i];
+    p[i] = z[i];
+  }
+  double rz = Dot(r, z, n);
+
+  while (result.iterations < maxIterations) {
+    ++result.iterations;
+    Multiply(A, p, ap);
+    const double pap = Dot(p, ap, n);
+    if (pap == 0.0)
+      break; // Breakdown: not positive definite
+    const double alpha = rz / pap;
+    for (std::size_t i = 0; i < n; ++i) {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * ap[i];
+    }
+    result.residual = std::sqrt(Dot(r, r, n)) / bNorm;
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      z[i] = inverseDiag[i] * r[i];
+    const double rzNext = Dot(r, z, n);
+    const double beta = rzNext / rz;
+    rz = rzNext;
+    for (std::size_t i = 0; i < n; ++i)
+      p[i] = z[i] + beta * p[i];
+  }
+  return result;
+}
+
+IterativeResult SolveBiCgStab(const CsrMatrix &A, const double *b, double *x,
+                              double *work, double tolerance,
+                              int maxIterations) {
+  const std::size_t n = A.n;
+  double *r = work;
+  double *rHat = work + n;
+  double *p = work + 2 * n;
+  double *v = work + 3 * n;
+  double *pHat = work + 4 * n;
+  double *sHat = work + 5 * n;
+  double *t = work + 6 * n;
+  double *inverseDiag = work + 7 * n;
+  double *s = r; // s replaces r within an iteration
+
+  IterativeResult result;
+  BuildJacobi(A, inverseDiag);
+  const double bNorm = Residual(A, b, x, r);
+  result.residual = std::sqrt(Dot(r, r, n)) / bNorm;
+  if (result.residual <= tolerance) {
+    result.converged = true;
+    return result;
+  }
+
+  // Shadow residual r0 plus a fixed pseudo-random part. r0 alone breaks
+  // down at once on voltage source rows: the branch unknown only reaches
+  // the residual through the node rows, so rHat . (A r0) starts at zero.
+  const double spread = result.residual * bNorm / std::sqrt(double(n));
+  std::uint32_t seed = 0x9E3779B9u;
+  for (std::size_t i = 0; i < n; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    double u = static_cast<double>(seed >> 8) / 8388608.0 - 1.0; // [-1, 1)
+    rHat[i] = r[i] + spread * u;
+    p[i] = 0.0;
+    v[i] = 0.0;
+  }
+  double rho = 1.0;
+  double alpha = 1.0;
+  double omega = 1.0;
+
+  while (result.iterations < maxIterations) {
+    ++result.iterations;
+    const double rhoNext = Dot(rHat, r, n);
+    if (rhoNext == 0.0 || omega == 0.0)
+      break; // Breakdown
+    const double beta = (rhoNext / rho) * (alpha / omega);
+    rho = rhoNext;
+    for (std::size_t i = 0; i < n; ++i) {
+      p[i] = r[i] + beta * (p[i] - omega * v[i]);
+      pHat[i] = inverseDiag[i] * p[i];
+    }
+    Multiply(A, pHat, v);
+    const double rHatV = Dot(rHat, v, n);
+    if (rHatV == 0.0)
+      break;
+    alpha = rho / rHatV;
+    for (std::size_t i = 0; i < n; ++i)
+      s[i] = r[i] - alpha * v[i];
+
+    double sNorm = std::sqrt(Dot(s, s, n)) / bNorm;
+    if (sNorm <= tolerance) {
+      for (std::size_t i = 0; i < n; ++i)
+        x[i] += alpha * pHat[i];
+      result.residual = sNorm;
+      result.converged = true;
+      break;
+    }
+
+    for (std::size_t i = 0; i < n; ++i)
+      sHat[i] = inverseDiag[i] * s[i];
+    Multiply(A, sHat, t);
+    const double tt = Dot(t, t, n);
+    omega = tt > 0.0 ? Dot(t, s, n) / tt : 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+      x[i] += alpha * pHat[i] + omega * sHat[i];
+      r[i] = s[i] - omega * t[i];
+    }
+    result.residual = std::sqrt(Dot(r, r, n)) / bNorm;
+    if (result.residual <= tolerance) {
+      result.converged = true;
+      break;
+    }
+  }
+  return result;
+}
+} // namespace NativeEngine::Circuit
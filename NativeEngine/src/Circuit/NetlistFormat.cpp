@@ -0,0 +1,93 @@
+#include "Circuit/NetlistFormat.hpp"
+
+namespace netlist
+{
+    bool Open(const std::uint8_t* buffer, std::size_t size, NetlistView& view, const char** error)
+    {
+        if (error) *error = nullptr;
+        if (!buffer || size < sizeof(NetlistHeader))
+        {
+            if (error) *error = "Buffer too small";
+            return false;
+        }
+        if ((reinterpret_cast<std::uintptr_t>(buffer) & 0x3u) != 0)
+        {
+            if (error) *error = "Buffer misaligned";
+            return false;
+        }
+
+        auto header = reinterpret_cast<const NetlistHeader*>(buffer);
+        if (header->magic != kMagic)
+        {
+            if (error) *error = "Invalid magic";
+            return false;
+        }
+        if (header->version_major != kVersionMajor)
+        {
+            if (error) *error = "Unsupported version";
+            return false;
+        }
+
+        // 64-bit arithmetic: counts come from untrusted input.
+        const std::uint64_t componentBytes = std::uint64_t(header->component_count) * sizeof(NetlistComponent);
+        const std::uint64_t connectionBytes = std::uint64_t(header->connection_count) * sizeof(NetlistConnection);
+        const std::uint64_t paramBytes = std::uint64_t(header->param_count) * sizeof(float);
+        const std::uint64_t total = sizeof(NetlistHeader) + componentBytes + connectionBytes + paramBytes;
+        if (total > size)
+        {
+            if (error) *error = "Tables out of bounds";
+            return false;
+        }
+
+        // Node ids go back to the caller as int32_t, and a node no pin
+        // touches is never solved, so more nodes than connections is as
+        // malformed as a table past the end of the buffer.
+        if (header->node_count > std::uint32_t(INT32_MAX) || header->node_count > header->connection_count)
+        {
+            if (error) *error = "Node count out of range";
+            return false;
+        }
+
+        const std::uint8_t* cursor = buffer + sizeof(NetlistHeader);
+        auto components = reinterpret_cast<const NetlistComponent*>(cursor);
+        cursor += componentBytes;
+        auto connections = reinterpret_cast<const NetlistConnection*>(cursor);
+        cursor += connectionBytes;
+        auto params = reinterpret_cast<const float*>(cursor);
+
+        for (std::uint32_t i = 0; i < header->component_count; ++i)
+        {
+            const auto& comp = components[i];
+            if (std::uint64_t(comp.param_offset) + comp.param_count > header->param_count)
+            {
+                if (error) *error = "Component parameters out of bounds";
+                return false;
+            }
+        }
+        for (std::uint32_t i = 0; i < header->connection_count; ++i)
+        {
+            const auto& conn = connections[i];
+            if (conn.component >= header->component_count)
+            {
+                if (error) *error = "Connection references unknown component";
+                return false;
+            }
+            if (conn.node > header->node_count)
+            {
+                if (error) *error = "Connection references unknown node";
+                return false;
+            }
+            if (conn.pin > 0xFF)
+            {
+                if (error) *error = "Pin index out of range";
+                return false;
+            }
+        }
+
+        view.header = header;
+        view.components = components;
+        view.connections = connections;
+        view.params = params;
+        return true;
+    }
+}
@@ -0,0 +1,78 @@
+#include "../../include/Circuit/ThreadPool.h"
+
+namespace NativeEngine::Circuit {
+ThreadPool::ThreadPool(std::size_t workerCount) {
+  m_workers.reserve(workerCount);
+  for (std::size_t i = 0; i < workerCount; ++i) {
+    m_workers.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto &worker : m_workers) {
+    if (worker.joinable())
+      worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(std::size_t count,
+                             const std::function<void(std::size_t)> &task) {
+  if (count == 0)
+    return;
+  if (m_workers.empty() || count == 1) {
+    for (std::size_t i = 0; i < count; ++i)
+      task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_count = count;
+    m_next.store(0, std::memory_order_relaxed);
+    m_busy = m_workers.size();
+    ++m_generation;
+  }
+  m_wake.notify_all();
+
+  // The calling thread takes part in the work instead of idling.
+  Drain();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this]() { return m_busy == 0; });
+  m_task = nullptr;
+}
+
+void ThreadPool::Drain() {
+  for (;;) {
+    std::size_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+    if (index >= m_count)
+      break;
+    (*m_task)(index);
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  std::uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&]() { return m_stop || m_generation != seen; });
+      if (m_stop)
+        return;
+      seen = m_generation;
+    }
+
+    Drain();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_busy == 0)
+      m_done.notify_one();
+  }
+}
+} // namespace NativeEngine::Circuit
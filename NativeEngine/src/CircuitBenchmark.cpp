@@ -0,0 +1,438 @@
+// Circuit solver benchmark: builds parameterized boards, steps them and
+// prints throughput, solver work and memory as JSON so solver changes can be
+// compared run against run.
+//
+//   CircuitBenchmark [--steps N] [--filter text] [--output file] [--list]
+
+#include "../include/Circuit/AvrComponent.h"
+#include "../include/Circuit/BasicComponents.h"
+#include "../include/Circuit/CircuitContext.h"
+#include "../include/Circuit/Diode.h"
+#include "../include/Circuit/ReactiveComponents.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace NativeEngine::Circuit;
+
+namespace {
+constexpr double kFrameDt = 0.001; // One 1 kHz simulation frame
+
+// A built board plus the hook that disturbs it before every timed step, so
+// each step has solver work to do instead of hitting the clean-skip path.
+struct Board {
+  std::unique_ptr<Context> ctx = std::make_unique<Context>();
+  std::uint32_t nextId = 1;
+  std::size_t componentCount = 0;
+  std::function<void(int step)> perturb;
+
+  template <typename T, typename... Args>
+  std::shared_ptr<T> Add(Args &&...args) {
+    auto comp = std::make_shared<T>(nextId++, std::forward<Args>(args)...);
+    ctx->AddComponent(comp);
+    ++componentCount;
+    return comp;
+  }
+
+  void Connect(const std::shared_ptr<Component> &comp, std::uint8_t pin,
+               std::uint32_t node) {
+    ctx->ConnectComponent(comp->GetId(), pin, node);
+  }
+
+  // Two-pin component between a and b
+  template <typename T, typename... Args>
+  std::shared_ptr<T> Link(std::uint32_t a, std::uint32_t b, Args &&...args) {
+    auto comp = Add<T>(std::forward<Args>(args)...);
+    Connect(comp, 0, a);
+    Connect(comp, 1, b);
+    return comp;
+  }
+};
+
+struct Scenario {
+  std::string name;
+  std::string family;
+  LinearSolverBackend solver;
+  std::function<void(Board &)> build;
+};
+
+// --- Generators ---
+
+// Supply -> chain of `length` resistors -> ground
+void BuildLadder(Board &board, int length) {
+  Context &ctx = *board.ctx;
+  std::uint32_t prev = ctx.CreateNode();
+  auto vs = board.Link<VoltageSource>(prev, 0, 5.0);
+  for (int i = 0; i < length; ++i) {
+    std::uint32_t next = (i + 1 < length) ? ctx.CreateNode() : 0;
+    board.Link<Resistor>(prev, next, 100.0 + (i % 7));
+    prev = next;
+  }
+  board.perturb = [vs](int step) { vs->SetVoltage(step % 2 ? 5.0 : 4.9); };
+}
+
+// side x side resistor grid fed at one corner, grounded at the other
+void BuildMesh(Board &board, int side) {
+  Context &ctx = *board.ctx;
+  std::vector<std::uint32_t> nodes(static_cast<std::size_t>(side) * side);
+  for (auto &node : nodes)
+    node = ctx.CreateNode();
+  for (int y = 0; y < side; ++y) {
+    for (int x = 0; x < side; ++x) {
+      double ohms = 1.0 + 0.01 * ((x * 7 + y * 13) % 10);
+      if (x + 1 < side)
+        board.Link<Resistor>(nodes[y * side + x], nodes[y * side + x + 1], ohms);
+      if (y + 1 < side)
+        board.Link<Resistor>(nodes[y * side + x], nodes[(y + 1) * side + x],
+                             ohms);
+    }
+  }
+  board.Link<Resistor>(nodes.back(), 0, 1.0);
+  std::uint32_t supply = ctx.CreateNode();
+  auto vs = board.Link<VoltageSource>(supply, 0, 5.0);
+  board.Link<Resistor>(supply, nodes.front(), 10.0);
+  board.perturb = [vs](int step) { vs->SetVoltage(step % 2 ? 5.0 : 4.9); };
+}
+
+// rows x cols LEDs, anodes on driven rows, cathodes through column
+// resistors; one row is lit per step, as a multiplexed display scans.
+void BuildLedMatrix(Board &board, int rows, int cols) {
+  Context &ctx = *board.ctx;
+  std::vector<std::shared_ptr<VoltageSource>> drivers;
+  std::vector<std::uint32_t> rowNodes;
+  for (int r = 0; r < rows; ++r) {
+    std::uint32_t drive = ctx.CreateNode();
+    std::uint32_t row = ctx.CreateNode();
+    drivers.push_back(board.Link<VoltageSource>(drive, 0, r == 0 ? 5.0 : 0.0));
+    board.Link<Resistor>(drive, row, 10.0);
+    rowNodes.push_back(row);
+  }
+  for (int c = 0; c < cols; ++c) {
+    std::uint32_t column = ctx.CreateNode();
+    board.Link<Resistor>(column, 0, 220.0);
+    for (std::uint32_t row : rowNodes)
+      board.Link<Diode>(row, column);
+  }
+  board.perturb = [drivers](int step) {
+    for (std::size_t r = 0; r < drivers.size(); ++r)
+      drivers[r]->SetVoltage(r == step % drivers.size() ? 5.0 : 0.0);
+  };
+}
+
+// Little-endian program words straight into flash
+bool LoadProgram(AvrComponent &avr, const std::vector<std::uint16_t> &words) {
+  if (words.size() * 2 > avr.m_flash.size())
+    return false;
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    avr.m_flash[2 * i] = static_cast<std::uint8_t>(words[i] & 0xFF);
+    avr.m_flash[2 * i + 1] = static_cast<std::uint8_t>(words[i] >> 8);
+  }
+  AVR_InvalidateFlash(&avr.m_cpu, 0, words.size() * 2);
+  return true;
+}
+
+std::uint16_t LdiR17(std::uint8_t k) {
+  return static_cast<std::uint16_t>(0xE010 | ((k & 0xF0) << 4) | (k & 0x0F));
+}
+
+// Square wave on D6 (high/low delay loops of `high`/`low` passes) while
+// mirroring input D2 onto the D13 LED.
+std::vector<std::uint16_t> ToggleAndMirror(std::uint8_t high,
+                                           std::uint8_t low) {
+  return {
+      0x9A56,       // sbi DDRD,6
+      0x9A25,       // sbi DDRB,5
+      0x9A5E,       // loop: sbi PORTD,6
+      LdiR17(high), //
+      0x951A,       // dec r17
+      0xF7F1,       // brne .-4
+      0x982D,       // cbi PORTB,5
+      0xB109,       // in r16,PIND
+      0x7004,       // andi r16,0x04
+      0xF009,       // breq .+2
+      0x9A2D,       // sbi PORTB,5
+      0x985E,       // cbi PORTD,6
+      LdiR17(low),  //
+      0x951A,       // dec r17
+      0xF7F1,       // brne .-4
+      0xCFF2,       // rjmp loop
+  };
+}
+
+// `count` AVRs, each D13 lighting an LED. In a ring each D6 drives the next
+// one's D2 through 1k (one partition); otherwise D6 feeds the AVR's own D2,
+// giving one partition per AVR.
+void BuildMultiAvr(Board &board, int count, bool ring) {
+  Context &ctx = *board.ctx;
+  std::vector<std::shared_ptr<AvrComponent>> avrs;
+  std::vector<std::uint32_t> inputs;
+  for (int i = 0; i < count; ++i) {
+    auto avr = board.Add<AvrComponent>();
+    LoadProgram(*avr, ToggleAndMirror(static_cast<std::uint8_t>(40 + 7 * i),
+                                      static_cast<std::uint8_t>(90)));
+    std::uint32_t input = ctx.CreateNode();
+    board.Link<Resistor>(input, 0, 10000.0);
+    board.Connect(avr, 2, input);
+    std::uint32_t led = ctx.CreateNode();
+    std::uint32_t anode = ctx.CreateNode();
+    board.Connect(avr, 13, led);
+    board.Link<Resistor>(led, anode, 220.0);
+    board.Link<Diode>(anode, 0);
+    avrs.push_back(avr);
+    inputs.push_back(input);
+  }
+  for (int i = 0; i < count; ++i) {
+    std::uint32_t out = ctx.CreateNode();
+    board.Connect(avrs[i], 6, out);
+    board.Link<Resistor>(out, inputs[ring ? (i + 1) % count : i], 1000.0);
+  }
+  // Firmware keeps the board busy on its own
+  board.perturb = [](int) {};
+}
+
+// `channels` AVRs with software PWM into RC filters
+void BuildPwmRc(Board &board, int channels, bool averaging) {
+  Context &ctx = *board.ctx;
+  for (int i = 0; i < channels; ++i) {
+    auto avr = board.Add<AvrComponent>();
+    avr->m_pwmAveraging = averaging;
+    LoadProgram(*avr, ToggleAndMirror(static_cast<std::uint8_t>(20 + 10 * i),
+                                      static_cast<std::uint8_t>(150)));
+    std::uint32_t pin = ctx.CreateNode();
+    std::uint32_t filtered = ctx.CreateNode();
+    board.Connect(avr, 6, pin);
+    board.Link<Resistor>(pin, filtered, 1000.0);
+    board.Link<Capacitor>(filtered, 0, 10e-6);
+  }
+  board.perturb = [](int) {};
+}
+
+std::vector<Scenario> MakeScenarios() {
+  const auto direct = LinearSolverBackend::Direct;
+  const auto iterative = LinearSolverBackend::Iterative;
+  std::vector<Scenario> list;
+  for (int length : {100, 1000}) {
+    auto build = [length](Board &b) { BuildLadder(b, length); };
+    list.push_back({"ladder_" + std::to_string(length), "ladder", direct, build});
+  }
+  list.push_back({"ladder_1000_iterative", "ladder", iterative,
+                  [](Board &b) { BuildLadder(b, 1000); }});
+  for (int side : {10, 32}) {
+    auto build = [side](Board &b) { BuildMesh(b, side); };
+    std::string size = std::to_string(side) + "x" + std::to_string(side);
+    list.push_back({"mesh_" + size, "mesh", direct, build});
+  }
+  for (int side : {32, 100}) {
+    auto build = [side](Board &b) { BuildMesh(b, side); };
+    std::string size = std::to_string(side) + "x" + std::to_string(side);
+    list.push_back({"mesh_" + size + "_iterative", "mesh", iterative, build});
+  }
+  for (int side : {8, 16}) {
+    auto build = [side](Board &b) { BuildLedMatrix(b, side, side); };
+    std::string size = std::to_string(side) + "x" + std::to_string(side);
+    list.push_back({"led_matrix_" + size, "led_matrix", direct, build});
+  }
+  for (int count : {2, 8}) {
+    auto build = [count](Board &b) { BuildMultiAvr(b, count, true); };
+    list.push_back(
+        {"multi_avr_" + std::to_string(count), "multi_avr", direct, build});
+  }
+  list.push_back({"multi_avr_8_separate", "multi_avr", direct,
+                  [](Board &b) { BuildMultiAvr(b, 8, false); }});
+  for (bool averaging : {false, true}) {
+    auto build = [averaging](Board &b) { BuildPwmRc(b, 4, averaging); };
+    list.push_back({std::string("pwm_rc_4") + (averaging ? "_averaged" : ""),
+                    "pwm_rc", direct, build});
+  }
+  return list;
+}
+
+// --- Measurement ---
+
+template <typename T> std::size_t Bytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+
+// Matrix, factor and Krylov storage held by the partitions
+std::size_t SolverBytes(const Context &ctx) {
+  std::size_t total = 0;
+  for (const Partition &p : ctx.GetPartitions()) {
+    total += Bytes(p.baseMatrix) + Bytes(p.matrix) + Bytes(p.rhs) +
+             Bytes(p.solution) + Bytes(p.factoredMatrix) + Bytes(p.lu) +
+             Bytes(p.pivots) + Bytes(p.rowStart) + Bytes(p.columns) +
+             Bytes(p.work);
+  }
+  return total;
+}
+
+struct Result {
+  const Scenario *scenario = nullptr;
+  std::size_t nodes = 0;
+  std::size_t components = 0;
+  double buildMs = 0.0;
+  double firstStepMs = 0.0; // Partitioning and first factorization
+  int steps = 0;
+  double wallMs = 0.0;
+  double maxStepMs = 0.0;
+  StepStats last;   // Structure after the final step
+  StepStats totals; // Work summed over the timed steps
+  std::size_t solverBytes = 0;
+};
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+Result Run(const Scenario &scenario, int steps) {
+  Result result;
+  result.scenario = &scenario;
+  result.steps = steps;
+
+  auto start = std::chrono::steady_clock::now();
+  Board board;
+  board.ctx->m_linearSolver = scenario.solver;
+  board.ctx->m_profileTimings = true;
+  scenario.build(board);
+  result.buildMs = MillisecondsSince(start);
+  result.nodes = board.ctx->GetNodeCount();
+  result.components = board.componentCount;
+
+  start = std::chrono::steady_clock::now();
+  board.ctx->Step(kFrameDt);
+  result.firstStepMs = MillisecondsSince(start);
+
+  for (int i = 0; i < steps; ++i) {
+    board.perturb(i);
+    auto stepStart = std::chrono::steady_clock::now();
+    board.ctx->Step(kFrameDt);
+    double ms = MillisecondsSince(stepStart);
+    result.wallMs += ms;
+    result.maxStepMs = std::max(result.maxStepMs, ms);
+    result.totals.AddWork(board.ctx->GetStepStats());
+  }
+  result.last = board.ctx->GetStepStats();
+  result.solverBytes = SolverBytes(*board.ctx);
+  return result;
+}
+
+const char *SolverName(LinearSolverBackend solver) {
+  return solver == LinearSolverBackend::Iterative ? "iterative" : "direct";
+}
+
+void WriteJson(std::FILE *out, const std::vector<Result> &results,
+               int steps) {
+  std::fprintf(out, "{\n  \"benchmark\": \"CircuitBenchmark\",\n");
+  std::fprintf(out, "  \"dt\": %g,\n  \"steps\": %d,\n  \"results\": [",
+               kFrameDt, steps);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    const StepStats &t = r.totals;
+    const double seconds = r.wallMs / 1000.0;
+    const double perSecond = seconds > 0.0 ? 1.0 / seconds : 0.0;
+    std::fprintf(out, "%s\n    {\n", i ? "," : "");
+    std::fprintf(out, "      \"name\": \"%s\",\n", r.scenario->name.c_str());
+    std::fprintf(out, "      \"family\": \"%s\",\n",
+                 r.scenario->family.c_str());
+    std::fprintf(out, "      \"solver\": \"%s\",\n",
+                 SolverName(r.scenario->solver));
+    std::fprintf(out, "      \"nodes\": %zu,\n", r.nodes);
+    std::fprintf(out, "      \"components\": %zu,\n", r.components);
+    std::fprintf(out, "      \"partitions\": %u,\n", r.last.partitionCount);
+    std::fprintf(out, "      \"unknowns\": %u,\n", r.last.unknowns);
+    std::fprintf(out, "      \"largest_partition\": %u,\n",
+                 r.last.largestPartition);
+    std::fprintf(out, "      \"nonzeros\": %llu,\n",
+                 static_cast<unsigned long long>(r.last.nonzeros));
+    std::fprintf(out, "      \"solver_bytes\": %zu,\n", r.solverBytes);
+    std::fprintf(out, "      \"build_ms\": %.3f,\n", r.buildMs);
+    std::fprintf(out, "      \"first_step_ms\": %.3f,\n", r.firstStepMs);
+    std::fprintf(out, "      \"wall_ms\": %.3f,\n", r.wallMs);
+    std::fprintf(out, "      \"step_ms_mean\": %.4f,\n",
+                 r.steps ? r.wallMs / r.steps : 0.0);
+    std::fprintf(out, "      \"step_ms_max\": %.4f,\n", r.maxStepMs);
+    std::fprintf(out, "      \"steps_per_sec\": %.1f,\n", r.steps * perSecond);
+    std::fprintf(out, "      \"solves\": %u,\n", t.partitionsSolved);
+    std::fprintf(out, "      \"solves_per_sec\": %.1f,\n",
+                 t.partitionsSolved * perSecond);
+    std::fprintf(out, "      \"newton_iterations\": %u,\n",
+                 t.newtonIterations);
+    std::fprintf(out, "      \"factorizations\": %u,\n", t.factorizations);
+    std::fprintf(out, "      \"factor_reuses\": %u,\n", t.factorReuses);
+    std::fprintf(out, "      \"iterative_iterations\": %u,\n",
+                 t.iterativeIterations);
+    std::fprintf(out, "      \"pivot_warnings\": %u,\n", t.pivotWarnings);
+    std::fprintf(out, "      \"nonconverged\": %u,\n", t.nonConverged);
+    std::fprintf(out, "      \"events\": %u,\n", t.events);
+    std::fprintf(out, "      \"stamp_ms\": %.3f,\n", t.stampSeconds * 1000.0);
+    std::fprintf(out, "      \"solve_ms\": %.3f,\n", t.solveSeconds * 1000.0);
+    std::fprintf(out, "      \"component_ms\": %.3f\n",
+                 t.componentSeconds * 1000.0);
+    std::fprintf(out, "    }");
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+}
+
+void PrintUsage() {
+  std::fprintf(stderr, "usage: CircuitBenchmark [--steps N] [--filter text] "
+                       "[--output file] [--list]\n");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  int steps = 200;
+  std::string filter;
+  std::string outputPath;
+  bool listOnly = false;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--steps") == 0 && hasValue) {
+      steps = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+      filter = argv[++i];
+    } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+      outputPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--list") == 0) {
+      listOnly = true;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  const std::vector<Scenario> scenarios = MakeScenarios();
+  std::vector<Result> results;
+  for (const Scenario &scenario : scenarios) {
+    if (!filter.empty() && scenario.name.find(filter) == std::string::npos)
+      continue;
+    if (listOnly) {
+      std::printf("%s\n", scenario.name.c_str());
+      continue;
+    }
+    std::fprintf(stderr, "%s...\n", scenario.name.c_str());
+    results.push_back(Run(scenario, steps));
+  }
+  if (listOnly)
+    return 0;
+
+  std::FILE *out = stdout;
+  if (!outputPath.empty()) {
+    out = std::fopen(outputPath.c_str(), "w");
+    if (!out) {
+      std::fprintf(stderr, "cannot open %s\n", outputPath.c_str());
+      return 1;
+    }
+  }
+  WriteJson(out, results, steps);
+  if (out != stdout)
+    std::fclose(out);
+  return 0;
+}
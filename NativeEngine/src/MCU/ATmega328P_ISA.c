@@ -1,21 +1,10 @@
 #include "MCU/ATmega328P_ISA.h"
+#include <string.h>
 
 uint8_t AVR_IoRead(AvrCore *core, uint16_t address);
 void AVR_IoWrite(AvrCore *core, uint16_t address, uint8_t value);
 static void AVR_Push(AvrCore *core, uint8_t value);
 
-static uint16_t AVR_FetchWord(AvrCore *core)
-{
-    size_t index = (size_t)core->pc * 2;
-    if (index + 1 >= core->flash_size)
-    {
-        return 0x0000;
-    }
-    uint16_t opcode = (uint16_t)(core->flash[index] | (core->flash[index + 1] << 8));
-    core->pc++;
-    return opcode;
-}
-
 static void AVR_UpdateSPRegisters(AvrCore *core)
 {
     uint8_t spl = (uint8_t)(core->sp & 0xFF);
@@ -37,28 +26,39 @@ static uint16_t AVR_GetSP(AvrCore *core)
 
 static uint8_t AVR_ReadData(AvrCore *core, uint16_t address)
 {
+    // Plain SRAM takes one compare; registers and I/O sit below it
+    if (address >= core->data_sram_start)
+    {
+        size_t idx = (size_t)(address - AVR_SRAM_START);
+        return idx < core->sram_size ? core->sram[idx] : 0;
+    }
     if (address < core->regs_size)
     {
         return core->regs[address];
     }
+    if (address == AVR_SREG)
+    {
+        return AVR_GetSreg(core);
+    }
     if (address >= AVR_IO_BASE && address < (AVR_IO_BASE + core->io_size))
     {
         size_t idx = (size_t)(address - AVR_IO_BASE);
         return core->io[idx];
     }
-    if (address >= AVR_SRAM_START)
+    return 0;
+}
+
+static void AVR_WriteData(AvrCore *core, uint16_t address, uint8_t value)
+{
+    if (address >= core->data_sram_start)
     {
         size_t idx = (size_t)(address - AVR_SRAM_START);
         if (idx < core->sram_size)
         {
-            return core->sram[idx];
+            core->sram[idx] = value;
         }
+        return;
     }
-    return 0;
-}
-
-static void AVR_WriteData(AvrCore *core, uint16_t address, uint8_t value)
-{
     if (address < core->regs_size)
     {
         core->regs[address] = value;
@@ -67,15 +67,6 @@ static void AVR_WriteData(AvrCore *core, uint16_t address, uint8_t value)
     if (address >= AVR_IO_BASE && address < (AVR_IO_BASE + core->io_size))
     {
         AVR_IoWrite(core, address, value);
-        return;
-    }
-    if (address >= AVR_SRAM_START)
-    {
-        size_t idx = (size_t)(address - AVR_SRAM_START);
-        if (idx < core->sram_size)
-        {
-            core->sram[idx] = value;
-        }
     }
 }
 
@@ -120,6 +111,281 @@ static void AVR_SetRegWord(AvrCore *core, uint8_t index, uint16_t value)
     core->regs[index + 1] = (uint8_t)((value >> 8) & 0xFF);
 }
 
+// SREG bits kept lazily in AvrCore.flags_*; I and T live in the I/O byte
+#define AVR_FLAG_C 0x01u
+#define AVR_FLAG_Z 0x02u
+#define AVR_FLAG_N 0x04u
+#define AVR_FLAG_V 0x08u
+#define AVR_FLAG_S 0x10u
+#define AVR_FLAG_H 0x20u
+#define AVR_FLAGS_ALL 0x3Fu
+
+// How AVR_Flags derives H/S/V/N/Z/C from flags_lhs, flags_rhs and
+// flags_result (8-bit results unless noted)
+enum
+{
+    AVR_FLAGS_STORED = 0, // flags_base holds all of them
+    AVR_FLAGS_ADD,        // ADD, ADC
+    AVR_FLAGS_SUB,        // SUB, SUBI, CP, CPI
+    AVR_FLAGS_SUB_CARRY,  // SBCI, CPC: Z also needs the previous Z (base)
+    AVR_FLAGS_LOGIC,      // EOR, ANDI, ORI: V cleared, H and C from base
+    AVR_FLAGS_DEC,        // H and C from base
+    AVR_FLAGS_ADIW,       // 16-bit, H from base
+    AVR_FLAGS_SBIW        // 16-bit, H from base
+};
+
+static uint8_t AVR_Flags(const AvrCore *core)
+{
+    uint8_t d = (uint8_t)core->flags_lhs;
+    uint8_t s = (uint8_t)core->flags_rhs;
+    uint8_t r = (uint8_t)core->flags_result;
+    uint8_t z = (uint8_t)(r == 0);
+    uint8_t carries;
+    uint8_t v;
+    uint8_t flags;
+
+    switch (core->flags_op)
+    {
+    case AVR_FLAGS_ADD:
+        carries = (uint8_t)((d & s) | (s & ~r) | (~r & d));
+        v = (uint8_t)(((d & s & ~r) | (~d & ~s & r)) >> 7);
+        flags = (uint8_t)(((carries >> 7) ? AVR_FLAG_C : 0) | ((carries & 0x08) ? AVR_FLAG_H : 0));
+        break;
+    case AVR_FLAGS_SUB:
+    case AVR_FLAGS_SUB_CARRY:
+        carries = (uint8_t)((~d & s) | (s & r) | (r & ~d));
+        v = (uint8_t)(((d & ~s & ~r) | (~d & s & r)) >> 7);
+        flags = (uint8_t)(((carries >> 7) ? AVR_FLAG_C : 0) | ((carries & 0x08) ? AVR_FLAG_H : 0));
+        if (core->flags_op == AVR_FLAGS_SUB_CARRY && !(core->flags_base & AVR_FLAG_Z))
+        {
+            z = 0; // Z can only stay set
+        }
+        break;
+    case AVR_FLAGS_LOGIC:
+        v = 0;
+        flags = (uint8_t)(core->flags_base & (AVR_FLAG_H | AVR_FLAG_C));
+        break;
+    case AVR_FLAGS_DEC:
+        v = (uint8_t)(r == 0x7F);
+        flags = (uint8_t)(core->flags_base & (AVR_FLAG_H | AVR_FLAG_C));
+        break;
+    case AVR_FLAGS_ADIW:
+    case AVR_FLAGS_SBIW:
+    {
+        uint8_t dh = (uint8_t)(core->flags_lhs >> 15);
+        uint8_t rh = (uint8_t)(core->flags_result >> 15);
+        uint8_t c = core->flags_op == AVR_FLAGS_ADIW ? (uint8_t)(dh & !rh) : (uint8_t)(rh & !dh);
+        v = core->flags_op == AVR_FLAGS_ADIW ? (uint8_t)(rh & !dh) : (uint8_t)(dh & !rh);
+        flags = (uint8_t)((core->flags_base & AVR_FLAG_H) | (c ? AVR_FLAG_C : 0) |
+                          (rh ? AVR_FLAG_N : 0) | (v ? AVR_FLAG_V : 0) | ((rh ^ v) ? AVR_FLAG_S : 0) |
+                          (core->flags_result == 0 ? AVR_FLAG_Z : 0));
+        return flags;
+    }
+    default:
+        return core->flags_base;
+    }
+    uint8_t n = (uint8_t)(r >> 7);
+    return (uint8_t)(flags | (z ? AVR_FLAG_Z : 0) | (n ? AVR_FLAG_N : 0) |
+                     (v ? AVR_FLAG_V : 0) | ((n ^ v) ? AVR_FLAG_S : 0));
+}
+
+// Z alone, for branches: no other flag is materialized
+static uint8_t AVR_FlagZ(const AvrCore *core)
+{
+    switch (core->flags_op)
+    {
+    case AVR_FLAGS_STORED:
+        return (uint8_t)((core->flags_base & AVR_FLAG_Z) != 0);
+    case AVR_FLAGS_SUB_CARRY:
+        return (uint8_t)((uint8_t)core->flags_result == 0 && (core->flags_base & AVR_FLAG_Z));
+    case AVR_FLAGS_ADIW:
+    case AVR_FLAGS_SBIW:
+        return (uint8_t)(core->flags_result == 0);
+    default:
+        return (uint8_t)((uint8_t)core->flags_result == 0);
+    }
+}
+
+static uint8_t AVR_FlagC(const AvrCore *core)
+{
+    return (uint8_t)(AVR_Flags(core) & AVR_FLAG_C);
+}
+
+static void AVR_SetFlags(AvrCore *core, uint8_t op, uint16_t lhs, uint16_t rhs, uint16_t result)
+{
+    core->flags_op = op;
+    core->flags_lhs = lhs;
+    core->flags_rhs = rhs;
+    core->flags_result = result;
+}
+
+// For instructions that leave some flags unchanged: keeps those in the base
+static void AVR_SetFlagsKeeping(AvrCore *core, uint8_t keep, uint8_t op, uint16_t lhs, uint16_t result)
+{
+    core->flags_base = (uint8_t)(AVR_Flags(core) & keep);
+    AVR_SetFlags(core, op, lhs, 0, result);
+}
+
+uint8_t AVR_GetSreg(const AvrCore *core)
+{
+    size_t idx = (size_t)(AVR_SREG - AVR_IO_BASE);
+    uint8_t high = idx < core->io_size ? (uint8_t)(core->io[idx] & ~AVR_FLAGS_ALL) : 0;
+    return (uint8_t)(high | AVR_Flags(core));
+}
+
+// Interrupt sources serviced by AVR_CheckInterrupts, highest priority
+// first; bit n of irq_flagged / irq_pending is entry n.
+typedef struct AvrIrqSource
+{
+    uint16_t flag_reg;
+    uint8_t flag_bit;
+    uint16_t enable_reg;
+    uint8_t enable_bit;
+    uint8_t ack;        // Entry clears the flag
+    uint16_t vector[2]; // By mcu_kind; 0 = not on this MCU
+} AvrIrqSource;
+
+static const AvrIrqSource AVR_IRQ_SOURCES[] = {
+    {AVR_PCIFR, 0, AVR_PCICR, 0, 1, {0x0006, 0x0012}},
+    {AVR_PCIFR, 1, AVR_PCICR, 1, 1, {0x0008, 0x0014}},
+    {AVR_PCIFR, 2, AVR_PCICR, 2, 1, {0x000A, 0x0016}},
+    {AVR_TIFR2, 1, AVR_TIMSK2, 1, 1, {0x000E, 0x001A}},
+    {AVR_TIFR2, 2, AVR_TIMSK2, 2, 1, {0x0010, 0x001C}},
+    {AVR_TIFR2, 0, AVR_TIMSK2, 0, 1, {0x0012, 0x001E}},
+    {AVR_TIFR1, 1, AVR_TIMSK1, 1, 1, {0x0016, 0x0022}},
+    {AVR_TIFR1, 2, AVR_TIMSK1, 2, 1, {0x0018, 0x0024}},
+    {AVR_TIFR1, 0, AVR_TIMSK1, 0, 1, {0x001A, 0x0026}},
+    {AVR_TIFR0, 1, AVR_TIMSK0, 1, 1, {0x001C, 0x0028}},
+    {AVR_TIFR0, 2, AVR_TIMSK0, 2, 1, {0x001E, 0x002A}},
+    {AVR_TIFR0, 0, AVR_TIMSK0, 0, 1, {0x0020, 0x002C}},
+    {AVR_UCSR0A, 7, AVR_UCSR0B, 7, 0, {0x0024, 0x0030}},
+    {AVR_UCSR0A, 5, AVR_UCSR0B, 5, 0, {0x0026, 0x0032}},
+    {AVR_UCSR0A, 6, AVR_UCSR0B, 6, 1, {0x0028, 0x0034}},
+    {AVR_UCSR1A, 7, AVR_UCSR1B, 7, 0, {0, 0x0036}},
+    {AVR_UCSR1A, 5, AVR_UCSR1B, 5, 0, {0, 0x0038}},
+    {AVR_UCSR1A, 6, AVR_UCSR1B, 6, 1, {0, 0x003A}},
+    {AVR_UCSR2A, 7, AVR_UCSR2B, 7, 0, {0, 0x003C}},
+    {AVR_UCSR2A, 5, AVR_UCSR2B, 5, 0, {0, 0x003E}},
+    {AVR_UCSR2A, 6, AVR_UCSR2B, 6, 1, {0, 0x0040}},
+    {AVR_UCSR3A, 7, AVR_UCSR3B, 7, 0, {0, 0x0042}},
+    {AVR_UCSR3A, 5, AVR_UCSR3B, 5, 0, {0, 0x0044}},
+    {AVR_UCSR3A, 6, AVR_UCSR3B, 6, 1, {0, 0x0046}},
+    {AVR_ADCSRA, 4, AVR_ADCSRA, 3, 1, {0x002A, 0x0048}},
+    {AVR_SPSR, 7, AVR_SPCR, 7, 1, {0x0022, 0x002E}},
+    {AVR_TWCR, 7, AVR_TWCR, 0, 1, {0x0030, 0x004A}},
+    {AVR_WDTCSR, 7, AVR_WDTCSR, 6, 1, {0x000C, 0x0018}},
+};
+
+#define AVR_IRQ_SOURCE_COUNT (sizeof(AVR_IRQ_SOURCES) / sizeof(AVR_IRQ_SOURCES[0]))
+
+// Flag and mask registers of AVR_IRQ_SOURCES, plus SREG
+static int AVR_IsInterruptRegister(uint16_t address)
+{
+    switch (address)
+    {
+    case AVR_SREG:
+    case AVR_PCIFR:
+    case AVR_PCICR:
+    case AVR_TIFR0:
+    case AVR_TIFR1:
+    case AVR_TIFR2:
+    case AVR_TIMSK0:
+    case AVR_TIMSK1:
+    case AVR_TIMSK2:
+    case AVR_UCSR0A:
+    case AVR_UCSR0B:
+    case AVR_UCSR1A:
+    case AVR_UCSR1B:
+    case AVR_UCSR2A:
+    case AVR_UCSR2B:
+    case AVR_UCSR3A:
+    case AVR_UCSR3B:
+    case AVR_ADCSRA:
+    case AVR_SPCR:
+    case AVR_SPSR:
+    case AVR_TWCR:
+    case AVR_WDTCSR:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// io_write_kind: the low bits pick how AVR_IoWrite stores the value, the
+// high bits what runs after it
+enum
+{
+    AVR_IOW_STORE = 0,
+    AVR_IOW_CLEAR_ON_ONE = 1, // Flag register; no hook
+    AVR_IOW_ADCSRA = 2,       // ADIF clears on one, other bits store; no hook
+    AVR_IOW_SREG = 3,
+    AVR_IOW_SPL = 4,
+    AVR_IOW_SPH = 5,
+    AVR_IOW_STORE_MASK = 0x0F,
+    AVR_IOW_HOOK = 0x40,
+    AVR_IOW_IRQ = 0x80
+};
+
+static void AVR_SetIoWriteStore(AvrCore *core, uint16_t address, uint8_t store)
+{
+    if (address < AVR_IO_BASE || address >= AVR_IO_SYNC_END)
+        return;
+    core->io_write_kind[address] = (uint8_t)((core->io_write_kind[address] & ~AVR_IOW_STORE_MASK) | store);
+}
+
+static void AVR_InitIoWriteKinds(AvrCore *core)
+{
+    static const uint16_t flagRegisters[] = {
+        AVR_TIFR0, AVR_TIFR1, AVR_TIFR2, AVR_TIFR3, AVR_TIFR4, AVR_TIFR5,
+        AVR_PCIFR, AVR_EIFR};
+    for (uint16_t address = 0; address < AVR_IO_SYNC_END; address++)
+    {
+        core->io_write_kind[address] = (uint8_t)(AVR_IOW_HOOK |
+                                                 (AVR_IsInterruptRegister(address) ? AVR_IOW_IRQ : 0));
+    }
+    for (size_t i = 0; i < sizeof(flagRegisters) / sizeof(flagRegisters[0]); i++)
+    {
+        AVR_SetIoWriteStore(core, flagRegisters[i], AVR_IOW_CLEAR_ON_ONE);
+    }
+    AVR_SetIoWriteStore(core, AVR_ADCSRA, AVR_IOW_ADCSRA);
+    AVR_SetIoWriteStore(core, AVR_SPL, AVR_IOW_SPL);
+    AVR_SetIoWriteStore(core, AVR_SPH, AVR_IOW_SPH);
+    // SREG only changes whether flagged sources are pending
+    AVR_SetIoWriteStore(core, AVR_SREG, AVR_IOW_SREG);
+    core->io_write_kind[AVR_SREG] &= (uint8_t)~AVR_IOW_IRQ;
+}
+
+// Raw register value: no read hook, 0 outside this core's I/O space
+static uint8_t AVR_IoPeek(const AvrCore *core, uint16_t address)
+{
+    size_t idx = (size_t)(address - AVR_IO_BASE);
+    return idx < core->io_size ? core->io[idx] : 0;
+}
+
+static void AVR_UpdatePending(AvrCore *core)
+{
+    core->irq_pending = (AVR_IoPeek(core, AVR_SREG) & (1u << 7)) ? core->irq_flagged : 0;
+}
+
+void AVR_UpdateInterrupts(AvrCore *core)
+{
+    uint32_t flagged = 0;
+    size_t i;
+    for (i = 0; i < AVR_IRQ_SOURCE_COUNT; ++i)
+    {
+        const AvrIrqSource *src = &AVR_IRQ_SOURCES[i];
+        if (src->vector[core->mcu_kind == AVR_MCU_2560] == 0)
+            continue;
+        if ((AVR_IoPeek(core, src->flag_reg) & (1u << src->flag_bit)) &&
+            (AVR_IoPeek(core, src->enable_reg) & (1u << src->enable_bit)))
+        {
+            flagged |= (uint32_t)1u << i;
+        }
+    }
+    core->irq_flagged = flagged;
+    AVR_UpdatePending(core);
+}
+
 void AVR_Init(AvrCore *core,
               uint8_t *flash, size_t flash_size,
               uint8_t *sram, size_t sram_size,
@@ -135,15 +401,38 @@ void AVR_Init(AvrCore *core,
     core->regs = regs;
     core->regs_size = regs_size;
     core->pc = 0;
-    core->zero_flag = 0;
-    core->carry_flag = 0;
+    core->flags_op = AVR_FLAGS_STORED;
+    core->flags_base = 0;
+    core->flags_lhs = 0;
+    core->flags_rhs = 0;
+    core->flags_result = 0;
     core->sp = (uint16_t)(AVR_SRAM_START + (uint16_t)sram_size - 1);
+    // I/O wins where the two ranges overlap
+    core->data_sram_start = AVR_IO_BASE + io_size > AVR_SRAM_START
+                                ? (uint16_t)(AVR_IO_BASE + io_size)
+                                : (uint16_t)AVR_SRAM_START;
     core->io_write_user = NULL;
     core->io_write_hook = NULL;
     core->io_read_user = NULL;
     core->io_read_hook = NULL;
+    core->io_sync_user = NULL;
+    core->io_sync_hook = NULL;
+    memset(core->io_read_sync, 0, sizeof(core->io_read_sync));
+    AVR_InitIoWriteKinds(core);
     core->mcu_kind = AVR_MCU_328P;
+    core->decoded = NULL;
+    core->decoded_size = 0;
+    core->idle_loop_cycles = 0;
+    core->flash_loads = 0;
+    core->sleeping = 0;
+    core->runtime_hle = 0;
+    for (uint8_t id = 0; id < AVR_HLE_ROUTINES; id++)
+    {
+        core->hle_entry[id] = 0xFFFF;
+    }
+    core->hle_calls = 0;
     AVR_UpdateSPRegisters(core);
+    AVR_UpdateInterrupts(core);
 }
 
 void AVR_SetMcuKind(AvrCore *core, uint8_t mcu_kind)
@@ -151,6 +440,7 @@ void AVR_SetMcuKind(AvrCore *core, uint8_t mcu_kind)
     if (!core)
         return;
     core->mcu_kind = mcu_kind;
+    AVR_UpdateInterrupts(core);
 }
 
 void AVR_SetIoWriteHook(AvrCore *core, void (*hook)(AvrCore *core, uint16_t address, uint8_t value, void *user), void *user)
@@ -169,11 +459,65 @@ void AVR_SetIoReadHook(AvrCore *core, void (*hook)(AvrCore *core, uint16_t addre
     core->io_read_user = user;
 }
 
+void AVR_SetIoSyncHook(AvrCore *core, void (*hook)(AvrCore *core, uint16_t address, void *user), void *user)
+{
+    if (!core)
+        return;
+    core->io_sync_hook = hook;
+    core->io_sync_user = user;
+}
+
+void AVR_SetIoReadSync(AvrCore *core, uint16_t address, uint8_t sync)
+{
+    if (!core || address >= AVR_IO_SYNC_END)
+        return;
+    uint32_t bit = 1u << (address & 31);
+    if (sync)
+        core->io_read_sync[address >> 5] |= bit;
+    else
+        core->io_read_sync[address >> 5] &= ~bit;
+    // IN and LDS pick their handler when decoded
+    if (core->decoded)
+    {
+        memset(core->decoded, 0, core->decoded_size * sizeof(AvrDecoded));
+    }
+}
+
+void AVR_SetIoWriteNotify(AvrCore *core, uint16_t address, uint8_t notify)
+{
+    if (!core || address < AVR_IO_BASE || address >= AVR_IO_SYNC_END)
+        return;
+    if (notify)
+        core->io_write_kind[address] |= AVR_IOW_HOOK;
+    else
+        core->io_write_kind[address] &= (uint8_t)~AVR_IOW_HOOK;
+}
+
+static int AVR_IsReadSync(const AvrCore *core, uint16_t address)
+{
+    return address < AVR_IO_SYNC_END &&
+           (core->io_read_sync[address >> 5] & (1u << (address & 31))) != 0;
+}
+
+// Runs the sync hook ahead of an I/O access. Such accesses run first in
+// their block, so the caller's cycle count is that of the instruction.
+static void AVR_SyncIo(AvrCore *core, uint16_t address)
+{
+    if (core->io_sync_hook && address >= AVR_IO_BASE)
+    {
+        core->io_sync_hook(core, address, core->io_sync_user);
+    }
+}
+
 uint8_t AVR_IoRead(AvrCore *core, uint16_t address)
 {
     size_t idx = (size_t)(address - AVR_IO_BASE);
     if (idx >= core->io_size)
         return 0;
+    if (address == AVR_SREG)
+    {
+        core->io[idx] = AVR_GetSreg(core);
+    }
     uint8_t value = core->io[idx];
     if (core->io_read_hook)
     {
@@ -187,34 +531,59 @@ void AVR_IoWrite(AvrCore *core, uint16_t address, uint8_t value)
     size_t idx = (size_t)(address - AVR_IO_BASE);
     if (idx >= core->io_size)
         return;
-    if (address == AVR_TIFR0 || address == AVR_TIFR1 || address == AVR_TIFR2 ||
-        address == AVR_TIFR3 || address == AVR_TIFR4 || address == AVR_TIFR5 ||
-        address == AVR_PCIFR || address == AVR_EIFR)
+    uint8_t kind = address < AVR_IO_SYNC_END ? core->io_write_kind[address] : AVR_IOW_HOOK;
+    switch (kind & AVR_IOW_STORE_MASK)
     {
+    case AVR_IOW_CLEAR_ON_ONE:
         core->io[idx] = (uint8_t)(core->io[idx] & ~value);
+        if (kind & AVR_IOW_IRQ)
+            AVR_UpdateInterrupts(core);
         return;
-    }
-    if (address == AVR_ADCSRA)
+    case AVR_IOW_ADCSRA:
     {
         uint8_t current = core->io[idx];
         uint8_t clearMask = (uint8_t)(value & (1u << 4));
         uint8_t next = (uint8_t)((current & ~clearMask) | (value & ~(1u << 4)));
         core->io[idx] = next;
+        AVR_UpdateInterrupts(core);
         return;
     }
-    core->io[idx] = value;
-    if (address == AVR_SPL)
-    {
+    case AVR_IOW_SREG:
+        core->io[idx] = value;
+        core->flags_op = AVR_FLAGS_STORED;
+        core->flags_base = (uint8_t)(value & AVR_FLAGS_ALL);
+        break;
+    case AVR_IOW_SPL:
+        core->io[idx] = value;
         core->sp = (uint16_t)((core->sp & 0xFF00) | value);
-    }
-    else if (address == AVR_SPH)
-    {
+        break;
+    case AVR_IOW_SPH:
+        core->io[idx] = value;
         core->sp = (uint16_t)((core->sp & 0x00FF) | ((uint16_t)value << 8));
+        break;
+    default:
+        core->io[idx] = value;
+        break;
     }
-    if (core->io_write_hook)
+    if ((kind & AVR_IOW_HOOK) && core->io_write_hook)
     {
         core->io_write_hook(core, address, value, core->io_write_user);
     }
+    // After the hook, which may adjust the register it was given
+    if ((kind & AVR_IOW_STORE_MASK) == AVR_IOW_SREG)
+        AVR_UpdatePending(core);
+    else if (kind & AVR_IOW_IRQ)
+        AVR_UpdateInterrupts(core);
+}
+
+void AVR_IoSetFlags(AvrCore *core, uint16_t address, uint8_t bits)
+{
+    size_t idx = (size_t)(address - AVR_IO_BASE);
+    if (idx >= core->io_size)
+        return;
+    core->io[idx] = (uint8_t)(core->io[idx] | bits);
+    if (AVR_IsInterruptRegister(address))
+        AVR_UpdateInterrupts(core);
 }
 
 void AVR_IoSetBit(AvrCore *core, uint16_t address, uint8_t bit, uint8_t state)
@@ -250,702 +619,1052 @@ static void AVR_EnterInterrupt(AvrCore *core, uint16_t vector)
 
 static uint8_t AVR_CheckInterrupts(AvrCore *core)
 {
-    uint8_t sreg = AVR_IoRead(core, AVR_SREG);
-    if ((sreg & (1u << 7)) == 0)
+    uint32_t pending = core->irq_pending;
+    size_t i = 0;
+    while ((pending & 1u) == 0)
     {
-        return 0;
-    }
-
-    uint16_t v_pcint0 = 0x0006;
-    uint16_t v_pcint1 = 0x0008;
-    uint16_t v_pcint2 = 0x000A;
-    uint16_t v_wdt = 0x000C;
-    uint16_t v_t2_compa = 0x000E;
-    uint16_t v_t2_compb = 0x0010;
-    uint16_t v_t2_ovf = 0x0012;
-    uint16_t v_t1_compa = 0x0016;
-    uint16_t v_t1_compb = 0x0018;
-    uint16_t v_t1_ovf = 0x001A;
-    uint16_t v_t0_compa = 0x001C;
-    uint16_t v_t0_compb = 0x001E;
-    uint16_t v_t0_ovf = 0x0020;
-    uint16_t v_spi = 0x0022;
-    uint16_t v_uart0_rx = 0x0024;
-    uint16_t v_uart0_udre = 0x0026;
-    uint16_t v_uart0_tx = 0x0028;
-    uint16_t v_uart1_rx = 0x0036;
-    uint16_t v_uart1_udre = 0x0038;
-    uint16_t v_uart1_tx = 0x003A;
-    uint16_t v_uart2_rx = 0x003C;
-    uint16_t v_uart2_udre = 0x003E;
-    uint16_t v_uart2_tx = 0x0040;
-    uint16_t v_uart3_rx = 0x0042;
-    uint16_t v_uart3_udre = 0x0044;
-    uint16_t v_uart3_tx = 0x0046;
-    uint16_t v_adc = 0x002A;
-    uint16_t v_twi = 0x0030;
-
-    if (core->mcu_kind == AVR_MCU_2560)
-    {
-        v_pcint0 = 0x0012;
-        v_pcint1 = 0x0014;
-        v_pcint2 = 0x0016;
-        v_wdt = 0x0018;
-        v_t2_compa = 0x001A;
-        v_t2_compb = 0x001C;
-        v_t2_ovf = 0x001E;
-        v_t1_compa = 0x0022;
-        v_t1_compb = 0x0024;
-        v_t1_ovf = 0x0026;
-        v_t0_compa = 0x0028;
-        v_t0_compb = 0x002A;
-        v_t0_ovf = 0x002C;
-        v_spi = 0x002E;
-        v_uart0_rx = 0x0030;
-        v_uart0_udre = 0x0032;
-        v_uart0_tx = 0x0034;
-        v_uart1_rx = 0x0036;
-        v_uart1_udre = 0x0038;
-        v_uart1_tx = 0x003A;
-        v_uart2_rx = 0x003C;
-        v_uart2_udre = 0x003E;
-        v_uart2_tx = 0x0040;
-        v_uart3_rx = 0x0042;
-        v_uart3_udre = 0x0044;
-        v_uart3_tx = 0x0046;
-        v_adc = 0x0048;
-        v_twi = 0x004A;
-    }
-
-    uint8_t pcicr = AVR_IoRead(core, AVR_PCICR);
-    uint8_t pcifr = AVR_IoRead(core, AVR_PCIFR);
-    if ((pcicr & (1u << 0)) && (pcifr & (1u << 0)))
-    {
-        pcifr = (uint8_t)(pcifr & ~(1u << 0));
-        AVR_IoWrite(core, AVR_PCIFR, pcifr);
-        AVR_EnterInterrupt(core, v_pcint0);
-        return 1;
+        pending >>= 1;
+        ++i;
     }
-    if ((pcicr & (1u << 1)) && (pcifr & (1u << 1)))
+    const AvrIrqSource *src = &AVR_IRQ_SOURCES[i];
+    uint8_t bit = (uint8_t)(1u << src->flag_bit);
+    if (src->ack)
     {
-        pcifr = (uint8_t)(pcifr & ~(1u << 1));
-        AVR_IoWrite(core, AVR_PCIFR, pcifr);
-        AVR_EnterInterrupt(core, v_pcint1);
-        return 1;
+        size_t idx = (size_t)(src->flag_reg - AVR_IO_BASE);
+        if (src->flag_reg == AVR_ADCSRA || src->flag_reg == AVR_PCIFR ||
+            (src->flag_reg >= AVR_TIFR0 && src->flag_reg <= AVR_TIFR2))
+        {
+            // Write-one-to-clear: a plain AVR_IoWrite would clear the others
+            core->io[idx] = (uint8_t)(core->io[idx] & ~bit);
+            AVR_UpdateInterrupts(core);
+        }
+        else
+        {
+            AVR_IoWrite(core, src->flag_reg, (uint8_t)(core->io[idx] & ~bit));
+        }
     }
-    if ((pcicr & (1u << 2)) && (pcifr & (1u << 2)))
+    core->sleeping = 0;
+    AVR_EnterInterrupt(core, src->vector[core->mcu_kind == AVR_MCU_2560]);
+    return 1;
+}
+
+// Handlers of the predecoded instructions (AvrDecoded.op), in enum order.
+// Order matters to AVR_ExecuteBlock: plain register/SRAM instructions come
+// first, then the stores that may reach I/O, then instructions that always
+// write I/O or the stack pointer (hooks, SREG.I), stop the core (SLEEP),
+// read a register the caller keeps lazily (AVR_SetIoReadSync) or run a
+// whole runtime routine (AVR_SetRuntimeHle).
+#define AVR_OP_LIST(X) \
+    X(NOP)             \
+    X(LPM_Z_INC)       \
+    X(CPC)             \
+    X(LDI)             \
+    X(IN)              \
+    X(LDS)             \
+    X(MOV)             \
+    X(MOVW)            \
+    X(EOR)             \
+    X(ANDI)            \
+    X(ORI)             \
+    X(SUBI)            \
+    X(SBCI)            \
+    X(CPI)             \
+    X(CP)              \
+    X(ADD)             \
+    X(ADC)             \
+    X(DEC)             \
+    X(ADIW)            \
+    X(SBIW)            \
+    X(BRNE)            \
+    X(BREQ)            \
+    X(RJMP)            \
+    X(ST_X_INC)        \
+    X(STS)             \
+    X(OUT)             \
+    X(SBI)             \
+    X(CBI)             \
+    X(PUSH)            \
+    X(POP)             \
+    X(RCALL)           \
+    X(CALL)            \
+    X(RET)             \
+    X(RETI)            \
+    X(SEI)             \
+    X(CLI)             \
+    X(SLEEP)           \
+    X(IN_SYNC)         \
+    X(LDS_SYNC)        \
+    X(HLE)
+
+enum
+{
+    AVR_OP_UNDECODED = 0,
+#define AVR_OP_ENUM(name) AVR_OP_##name,
+    AVR_OP_LIST(AVR_OP_ENUM)
+#undef AVR_OP_ENUM
+    AVR_OP_FIRST_STORE = AVR_OP_ST_X_INC,
+    AVR_OP_FIRST_BARRIER = AVR_OP_OUT
+};
+
+static uint16_t AVR_ReadFlashWord(const AvrCore *core, size_t wordIndex)
+{
+    size_t index = wordIndex * 2;
+    if (index + 1 >= core->flash_size)
     {
-        pcifr = (uint8_t)(pcifr & ~(1u << 2));
-        AVR_IoWrite(core, AVR_PCIFR, pcifr);
-        AVR_EnterInterrupt(core, v_pcint2);
-        return 1;
+        return 0x0000;
     }
+    return (uint16_t)(core->flash[index] | (core->flash[index + 1] << 8));
+}
+
+static void AVR_SetDecoded(AvrDecoded *out, uint8_t op, uint8_t d, uint8_t r, uint16_t k, uint8_t cycles)
+{
+    out->op = op;
+    out->d = d;
+    out->r = r;
+    out->k = k;
+    out->cycles = cycles;
+}
+
+// Same opcode tests, in the same order, as the interpreter always used
+static void AVR_Decode(const AvrCore *core, uint16_t pc, AvrDecoded *out)
+{
+    uint16_t opcode = AVR_ReadFlashWord(core, pc);
+    uint16_t next = AVR_ReadFlashWord(core, (size_t)pc + 1);
+    uint8_t d5 = (uint8_t)((opcode >> 4) & 0x1F);
+    uint8_t r5 = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
+    uint8_t d16 = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
+    uint8_t k8 = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
+    uint8_t a6 = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x30));
 
-    uint8_t tifr2 = AVR_IoRead(core, AVR_TIFR2);
-    uint8_t timsk2 = AVR_IoRead(core, AVR_TIMSK2);
-    if ((tifr2 & (1u << 1)) && (timsk2 & (1u << 1)))
+    if (core->runtime_hle)
     {
-        tifr2 = (uint8_t)(tifr2 & ~(1u << 1));
-        AVR_IoWrite(core, AVR_TIFR2, tifr2);
-        AVR_EnterInterrupt(core, v_t2_compa);
-        return 1;
+        for (uint8_t id = 0; id < AVR_HLE_ROUTINES; id++)
+        {
+            if (core->hle_entry[id] == pc)
+            {
+                AVR_SetDecoded(out, AVR_OP_HLE, 0, id, 0, 0);
+                return;
+            }
+        }
     }
-    if ((tifr2 & (1u << 2)) && (timsk2 & (1u << 2)))
+    if (opcode == 0x0000)
     {
-        tifr2 = (uint8_t)(tifr2 & ~(1u << 2));
-        AVR_IoWrite(core, AVR_TIFR2, tifr2);
-        AVR_EnterInterrupt(core, v_t2_compb);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_NOP, 0, 0, 0, 1);
+        return;
     }
-    if ((tifr2 & (1u << 0)) && (timsk2 & (1u << 0)))
+    // LPM Rd, Z+ (9005 mask FE0F)
+    if ((opcode & 0xFE0F) == 0x9005)
     {
-        tifr2 = (uint8_t)(tifr2 & ~(1u << 0));
-        AVR_IoWrite(core, AVR_TIFR2, tifr2);
-        AVR_EnterInterrupt(core, v_t2_ovf);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_LPM_Z_INC, d5, 0, 0, 3);
+        return;
     }
-
-    uint8_t tifr1 = AVR_IoRead(core, AVR_TIFR1);
-    uint8_t timsk1 = AVR_IoRead(core, AVR_TIMSK1);
-    if ((tifr1 & (1u << 1)) && (timsk1 & (1u << 1)))
+    // ST X+, Rr (920D mask FE0F)
+    if ((opcode & 0xFE0F) == 0x920D)
     {
-        tifr1 = (uint8_t)(tifr1 & ~(1u << 1));
-        AVR_IoWrite(core, AVR_TIFR1, tifr1);
-        AVR_EnterInterrupt(core, v_t1_compa);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_ST_X_INC, 0, d5, 0, 2);
+        return;
     }
-    if ((tifr1 & (1u << 2)) && (timsk1 & (1u << 2)))
+    // CPC Rd, Rr (0400 mask FC00)
+    if ((opcode & 0xFC00) == 0x0400)
     {
-        tifr1 = (uint8_t)(tifr1 & ~(1u << 2));
-        AVR_IoWrite(core, AVR_TIFR1, tifr1);
-        AVR_EnterInterrupt(core, v_t1_compb);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_CPC, d5, r5, 0, 1);
+        return;
     }
-    if ((tifr1 & (1u << 0)) && (timsk1 & (1u << 0)))
+    if ((opcode & 0xF000) == 0xE000)
     {
-        tifr1 = (uint8_t)(tifr1 & ~(1u << 0));
-        AVR_IoWrite(core, AVR_TIFR1, tifr1);
-        AVR_EnterInterrupt(core, v_t1_ovf);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_LDI, d16, k8, 0, 1);
+        return;
     }
-
-    uint8_t tifr0 = AVR_IoRead(core, AVR_TIFR0);
-    uint8_t timsk0 = AVR_IoRead(core, AVR_TIMSK0);
-    if ((tifr0 & (1u << 1)) && (timsk0 & (1u << 1)))
+    if ((opcode & 0xF800) == 0xB800)
     {
-        tifr0 = (uint8_t)(tifr0 & ~(1u << 1));
-        AVR_IoWrite(core, AVR_TIFR0, tifr0);
-        AVR_EnterInterrupt(core, v_t0_compa);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_OUT, 0, d5, (uint16_t)(AVR_IO_BASE + a6), 1);
+        return;
     }
-    if ((tifr0 & (1u << 2)) && (timsk0 & (1u << 2)))
+    if ((opcode & 0xF800) == 0xB000)
     {
-        tifr0 = (uint8_t)(tifr0 & ~(1u << 2));
-        AVR_IoWrite(core, AVR_TIFR0, tifr0);
-        AVR_EnterInterrupt(core, v_t0_compb);
-        return 1;
+        uint16_t address = (uint16_t)(AVR_IO_BASE + a6);
+        AVR_SetDecoded(out, AVR_IsReadSync(core, address) ? AVR_OP_IN_SYNC : AVR_OP_IN, d5, 0, address, 1);
+        return;
     }
-    if ((tifr0 & (1u << 0)) && (timsk0 & (1u << 0)))
+    if ((opcode & 0xFE0F) == 0x9000)
     {
-        tifr0 = (uint8_t)(tifr0 & ~(1u << 0));
-        AVR_IoWrite(core, AVR_TIFR0, tifr0);
-        AVR_EnterInterrupt(core, v_t0_ovf);
-        return 1;
+        AVR_SetDecoded(out, AVR_IsReadSync(core, next) ? AVR_OP_LDS_SYNC : AVR_OP_LDS, d5, 0, next, 2);
+        return;
     }
-
-    uint8_t ucsr0a = AVR_IoRead(core, AVR_UCSR0A);
-    uint8_t ucsr0b = AVR_IoRead(core, AVR_UCSR0B);
-    if ((ucsr0a & (1u << 7)) && (ucsr0b & (1u << 7)))
+    if ((opcode & 0xFE0F) == 0x9200)
     {
-        AVR_EnterInterrupt(core, v_uart0_rx);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_STS, 0, d5, next, 2);
+        return;
     }
-    if ((ucsr0a & (1u << 5)) && (ucsr0b & (1u << 5)))
+    if ((opcode & 0xFC00) == 0x2C00)
     {
-        AVR_EnterInterrupt(core, v_uart0_udre);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_MOV, d5, r5, 0, 1);
+        return;
     }
-    if ((ucsr0a & (1u << 6)) && (ucsr0b & (1u << 6)))
+    if ((opcode & 0xFF00) == 0x0100)
     {
-        ucsr0a = (uint8_t)(ucsr0a & ~(1u << 6));
-        AVR_IoWrite(core, AVR_UCSR0A, ucsr0a);
-        AVR_EnterInterrupt(core, v_uart0_tx);
-        return 1;
+        uint8_t dIndex = (uint8_t)(((opcode >> 4) & 0x0F) * 2);
+        uint8_t rIndex = (uint8_t)((opcode & 0x0F) * 2);
+        AVR_SetDecoded(out, AVR_OP_MOVW, dIndex, rIndex, 0, 1);
+        return;
     }
-
-    if (core->mcu_kind == AVR_MCU_2560)
+    if ((opcode & 0xFC00) == 0x2400)
     {
-        uint8_t ucsr1a = AVR_IoRead(core, AVR_UCSR1A);
-        uint8_t ucsr1b = AVR_IoRead(core, AVR_UCSR1B);
-        if ((ucsr1a & (1u << 7)) && (ucsr1b & (1u << 7)))
-        {
-            AVR_EnterInterrupt(core, v_uart1_rx);
-            return 1;
-        }
-        if ((ucsr1a & (1u << 5)) && (ucsr1b & (1u << 5)))
-        {
-            AVR_EnterInterrupt(core, v_uart1_udre);
-            return 1;
-        }
-        if ((ucsr1a & (1u << 6)) && (ucsr1b & (1u << 6)))
-        {
-            ucsr1a = (uint8_t)(ucsr1a & ~(1u << 6));
-            AVR_IoWrite(core, AVR_UCSR1A, ucsr1a);
-            AVR_EnterInterrupt(core, v_uart1_tx);
-            return 1;
-        }
-
-        uint8_t ucsr2a = AVR_IoRead(core, AVR_UCSR2A);
-        uint8_t ucsr2b = AVR_IoRead(core, AVR_UCSR2B);
-        if ((ucsr2a & (1u << 7)) && (ucsr2b & (1u << 7)))
-        {
-            AVR_EnterInterrupt(core, v_uart2_rx);
-            return 1;
-        }
-        if ((ucsr2a & (1u << 5)) && (ucsr2b & (1u << 5)))
-        {
-            AVR_EnterInterrupt(core, v_uart2_udre);
-            return 1;
-        }
-        if ((ucsr2a & (1u << 6)) && (ucsr2b & (1u << 6)))
-        {
-            ucsr2a = (uint8_t)(ucsr2a & ~(1u << 6));
-            AVR_IoWrite(core, AVR_UCSR2A, ucsr2a);
-            AVR_EnterInterrupt(core, v_uart2_tx);
-            return 1;
-        }
-
-        uint8_t ucsr3a = AVR_IoRead(core, AVR_UCSR3A);
-        uint8_t ucsr3b = AVR_IoRead(core, AVR_UCSR3B);
-        if ((ucsr3a & (1u << 7)) && (ucsr3b & (1u << 7)))
-        {
-            AVR_EnterInterrupt(core, v_uart3_rx);
-            return 1;
-        }
-        if ((ucsr3a & (1u << 5)) && (ucsr3b & (1u << 5)))
-        {
-            AVR_EnterInterrupt(core, v_uart3_udre);
-            return 1;
-        }
-        if ((ucsr3a & (1u << 6)) && (ucsr3b & (1u << 6)))
-        {
-            ucsr3a = (uint8_t)(ucsr3a & ~(1u << 6));
-            AVR_IoWrite(core, AVR_UCSR3A, ucsr3a);
-            AVR_EnterInterrupt(core, v_uart3_tx);
-            return 1;
-        }
+        AVR_SetDecoded(out, AVR_OP_EOR, d5, r5, 0, 1);
+        return;
     }
-
-    uint8_t adcsra = AVR_IoRead(core, AVR_ADCSRA);
-    if ((adcsra & (1u << 4)) && (adcsra & (1u << 3)))
+    if ((opcode & 0xF000) == 0x7000)
     {
-        adcsra = (uint8_t)(adcsra & ~(1u << 4));
-        AVR_IoWrite(core, AVR_ADCSRA, adcsra);
-        AVR_EnterInterrupt(core, v_adc);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_ANDI, d16, k8, 0, 1);
+        return;
     }
-
-    uint8_t spcr = AVR_IoRead(core, AVR_SPCR);
-    uint8_t spsr = AVR_IoRead(core, AVR_SPSR);
-    if ((spcr & (1u << 7)) && (spsr & (1u << 7)))
+    if ((opcode & 0xF000) == 0x6000)
     {
-        spsr = (uint8_t)(spsr & ~(1u << 7));
-        AVR_IoWrite(core, AVR_SPSR, spsr);
-        AVR_EnterInterrupt(core, v_spi);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_ORI, d16, k8, 0, 1);
+        return;
     }
-
-    uint8_t twcr = AVR_IoRead(core, AVR_TWCR);
-    if ((twcr & (1u << 0)) && (twcr & (1u << 7)))
+    if ((opcode & 0xF000) == 0x5000)
     {
-        twcr = (uint8_t)(twcr & ~(1u << 7));
-        AVR_IoWrite(core, AVR_TWCR, twcr);
-        AVR_EnterInterrupt(core, v_twi);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_SUBI, d16, k8, 0, 1);
+        return;
     }
-
-    uint8_t wdtcsr = AVR_IoRead(core, AVR_WDTCSR);
-    if ((wdtcsr & (1u << 6)) && (wdtcsr & (1u << 7)))
+    if ((opcode & 0xF000) == 0x4000)
     {
-        wdtcsr = (uint8_t)(wdtcsr & ~(1u << 7));
-        AVR_IoWrite(core, AVR_WDTCSR, wdtcsr);
-        AVR_EnterInterrupt(core, v_wdt);
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_SBCI, d16, k8, 0, 1);
+        return;
     }
-
-    return 0;
-}
-
-uint8_t AVR_ExecuteNext(AvrCore *core)
-{
-    if (AVR_CheckInterrupts(core))
+    if ((opcode & 0xF000) == 0x3000)
     {
-        return 4;
+        AVR_SetDecoded(out, AVR_OP_CPI, d16, k8, 0, 1);
+        return;
     }
-    uint16_t opcode = AVR_FetchWord(core);
-
-    if (opcode == 0x0000)
+    if ((opcode & 0xFC00) == 0x1400)
     {
-        return 1;
+        AVR_SetDecoded(out, AVR_OP_CP, d5, r5, 0, 1);
+        return;
     }
-
-    // LPM Rd, Z+ (9005 mask FE0F) - Precision Implementation
-    if ((opcode & 0xFE0F) == 0x9005)
+    if ((opcode & 0xFC00) == 0x0C00)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint16_t z = AVR_GetRegWord(core, 30);
-        if (z < core->flash_size)
+        AVR_SetDecoded(out, AVR_OP_ADD, d5, r5, 0, 1);
+        return;
+    }
+    if ((opcode & 0xFC00) == 0x1C00)
+    {
+        AVR_SetDecoded(out, AVR_OP_ADC, d5, r5, 0, 1);
+        return;
+    }
+    if ((opcode & 0xFF00) == 0x9A00 || (opcode & 0xFF00) == 0x9800)
+    {
+        uint8_t a = (uint8_t)((opcode >> 3) & 0x1F);
+        uint8_t b = (uint8_t)(opcode & 0x07);
+        uint8_t op = (opcode & 0xFF00) == 0x9A00 ? AVR_OP_SBI : AVR_OP_CBI;
+        AVR_SetDecoded(out, op, 0, b, (uint16_t)(AVR_IO_BASE + a), 2);
+        return;
+    }
+    if ((opcode & 0xFE0F) == 0x940A)
+    {
+        AVR_SetDecoded(out, AVR_OP_DEC, d5, 0, 0, 1);
+        return;
+    }
+    if ((opcode & 0xFE0F) == 0x920F)
+    {
+        AVR_SetDecoded(out, AVR_OP_PUSH, 0, d5, 0, 2);
+        return;
+    }
+    if ((opcode & 0xFE0F) == 0x900F)
+    {
+        AVR_SetDecoded(out, AVR_OP_POP, d5, 0, 0, 2);
+        return;
+    }
+    if ((opcode & 0xF000) == 0xD000 || (opcode & 0xF000) == 0xC000)
+    {
+        int16_t k = (int16_t)(opcode & 0x0FFF);
+        if (k & 0x0800)
         {
-            core->regs[d] = core->flash[z];
+            k = (int16_t)(k | 0xF000);
         }
+        if ((opcode & 0xF000) == 0xD000)
+            AVR_SetDecoded(out, AVR_OP_RCALL, 0, 0, (uint16_t)k, 3);
         else
+            AVR_SetDecoded(out, AVR_OP_RJMP, 0, 0, (uint16_t)k, 2);
+        return;
+    }
+    if ((opcode & 0xFE0E) == 0x940E)
+    {
+        AVR_SetDecoded(out, AVR_OP_CALL, 0, 0, next, 4);
+        return;
+    }
+    if (opcode == 0x9508)
+    {
+        AVR_SetDecoded(out, AVR_OP_RET, 0, 0, 0, 4);
+        return;
+    }
+    if (opcode == 0x9518)
+    {
+        AVR_SetDecoded(out, AVR_OP_RETI, 0, 0, 0, 4);
+        return;
+    }
+    if (opcode == 0x9478)
+    {
+        AVR_SetDecoded(out, AVR_OP_SEI, 0, 0, 0, 1);
+        return;
+    }
+    if (opcode == 0x94F8)
+    {
+        AVR_SetDecoded(out, AVR_OP_CLI, 0, 0, 0, 1);
+        return;
+    }
+    if (opcode == 0x9588)
+    {
+        AVR_SetDecoded(out, AVR_OP_SLEEP, 0, 0, 0, 1);
+        return;
+    }
+    if ((opcode & 0xFF00) == 0x9600 || (opcode & 0xFF00) == 0x9700)
+    {
+        uint8_t index = (uint8_t)(24 + ((opcode >> 4) & 0x03) * 2);
+        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 2) & 0x30));
+        uint8_t op = (opcode & 0xFF00) == 0x9600 ? AVR_OP_ADIW : AVR_OP_SBIW;
+        AVR_SetDecoded(out, op, index, k, 0, 2);
+        return;
+    }
+    if ((opcode & 0xFC07) == 0xF401 || (opcode & 0xFC07) == 0xF001)
+    {
+        int8_t k = (int8_t)((opcode >> 3) & 0x7F);
+        if (k & 0x40)
         {
-            core->regs[d] = 0;
+            k = (int8_t)(k | 0x80);
         }
-        AVR_SetRegWord(core, 30, (uint16_t)(z + 1));
-        return 3;
+        uint8_t op = (opcode & 0xFC07) == 0xF401 ? AVR_OP_BRNE : AVR_OP_BREQ;
+        AVR_SetDecoded(out, op, 0, 0, (uint16_t)(int16_t)k, 1);
+        return;
     }
 
-    // ST X+, Rr (920D mask FE0F) - Precision Implementation
-    if ((opcode & 0xFE0F) == 0x920D)
+    AVR_SetDecoded(out, AVR_OP_NOP, 0, 0, 0, 1);
+}
+
+// Second word of LDS/STS/CALL (operand already decoded); not past the end
+static void AVR_SkipWord(AvrCore *core)
+{
+    if ((size_t)core->pc * 2 + 1 < core->flash_size)
     {
-        uint8_t r = (uint8_t)((opcode >> 4) & 0x1F);
-        uint16_t x = AVR_GetRegWord(core, 26);
-        AVR_WriteData(core, x, core->regs[r]);
-        AVR_SetRegWord(core, 26, (uint16_t)(x + 1));
-        return 2;
+        core->pc++;
     }
+}
 
-    // CPC Rd, Rr (0400 mask FC00)
-    if ((opcode & 0xFC00) == 0x0400)
+void AVR_SetDecodeCache(AvrCore *core, AvrDecoded *cache, size_t entries)
+{
+    if (!core)
+        return;
+    size_t words = core->flash_size / 2;
+    core->decoded = cache;
+    core->decoded_size = cache ? (entries < words ? entries : words) : 0;
+    if (cache)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint8_t r = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
-        if (d < core->regs_size && r < core->regs_size)
-        {
-            uint16_t lhs = core->regs[d];
-            uint16_t rhs = (uint16_t)(core->regs[r] + (core->carry_flag ? 1 : 0));
-            uint16_t result = (uint16_t)(lhs - rhs);
+        memset(cache, 0, core->decoded_size * sizeof(AvrDecoded));
+    }
+}
 
-            if ((uint8_t)result != 0)
-            {
-                core->zero_flag = 0;
-            }
-            core->carry_flag = (uint8_t)(lhs < rhs);
-        }
-        return 1;
+// libgcc's unsigned division helpers as avr-gcc links them for cores with
+// MOVW. Each shifts the dividend through the remainder one bit per pass,
+// subtracting the divisor where it fits; the quotient bits come out
+// inverted and are fixed with COM before the results move to the return
+// registers.
+typedef struct AvrRuntimeRoutine
+{
+    const uint16_t *code;
+    uint8_t words; // Ending with RET
+    uint8_t bytes; // Operand width
+    uint8_t dividend;     // Low register; the quotient is built in place
+    uint8_t divisor;
+    uint8_t remainder[4]; // Not contiguous in __udivmodsi4
+    uint8_t counter;
+    uint8_t quotient_out; // Result registers after the final moves
+    uint8_t remainder_out;
+    uint8_t setup_cycles;    // Up to and including the jump into the loop
+    uint8_t shift_cycles;    // Dividend shift and counter decrement
+    uint8_t fit_cycles;      // Remainder shift and compare, divisor too big
+    uint8_t subtract_cycles; // Same, divisor subtracted
+    uint8_t finish_cycles;   // COMs and moves before RET
+} AvrRuntimeRoutine;
+
+static const uint16_t avrUdivmodqi4[] = {
+    0x1B99, 0xE079, 0xC004, 0x1F99, 0x1796, 0xF008, 0x1B96, 0x1F88,
+    0x957A, 0xF7C9, 0x9580, 0x9508};
+static const uint16_t avrUdivmodhi4[] = {
+    0x1BAA, 0x1BBB, 0xE151, 0xC007, 0x1FAA, 0x1FBB, 0x17A6, 0x07B7,
+    0xF010, 0x1BA6, 0x0BB7, 0x1F88, 0x1F99, 0x955A, 0xF7A9, 0x9580,
+    0x9590, 0x01BC, 0x01CD, 0x9508};
+static const uint16_t avrUdivmodsi4[] = {
+    0xE2A1, 0x2E1A, 0x1BAA, 0x1BBB, 0x01FD, 0xC00D, 0x1FAA, 0x1FBB,
+    0x1FEE, 0x1FFF, 0x17A2, 0x07B3, 0x07E4, 0x07F5, 0xF020, 0x1BA2,
+    0x0BB3, 0x0BE4, 0x0BF5, 0x1F66, 0x1F77, 0x1F88, 0x1F99, 0x941A,
+    0xF769, 0x9560, 0x9570, 0x9580, 0x9590, 0x019B, 0x01AC, 0x01BD,
+    0x01CF, 0x9508};
+
+static const AvrRuntimeRoutine avrRuntimeRoutines[AVR_HLE_ROUTINES] = {
+    {avrUdivmodqi4, 12, 1, 24, 22, {25}, 23, 24, 25, 4, 2, 4, 4, 1},
+    {avrUdivmodhi4, 20, 2, 24, 22, {26, 27}, 21, 22, 24, 5, 3, 6, 7, 4},
+    {avrUdivmodsi4, 34, 4, 22, 18, {26, 27, 30, 31}, 1, 18, 22, 7, 5, 10, 13, 8},
+};
+
+static int AVR_RoutineAt(const AvrCore *core, size_t pc, const AvrRuntimeRoutine *routine)
+{
+    for (size_t i = 0; i < routine->words; i++)
+    {
+        if (AVR_ReadFlashWord(core, pc + i) != routine->code[i])
+            return 0;
     }
-    if ((opcode & 0xF000) == 0xE000)
+    return 1;
+}
+
+// First word address in [first, end) where the routine's code starts
+static uint16_t AVR_FindRoutine(const AvrCore *core, const AvrRuntimeRoutine *routine, size_t first,
+                                size_t end)
+{
+    size_t words = core->flash_size / 2;
+    if (words > 0xFFFF)
     {
-        uint8_t d = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
-        if (d < core->regs_size)
-        {
-            core->regs[d] = k;
-        }
-        return 1;
+        words = 0xFFFF; // Reachable with a 16-bit PC
     }
-    if ((opcode & 0xF800) == 0xB800)
+    for (size_t pc = first; pc < end && pc + routine->words <= words; pc++)
     {
-        uint8_t a = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x30));
-        uint8_t r = (uint8_t)((opcode >> 4) & 0x1F);
-        if (r < core->regs_size)
+        if (AVR_RoutineAt(core, pc, routine))
         {
-            AVR_IoWrite(core, (uint16_t)(AVR_IO_BASE + a), core->regs[r]);
+            return (uint16_t)pc;
         }
-        return 1;
     }
-    if ((opcode & 0xF800) == 0xB000)
+    return 0xFFFF;
+}
+
+// Updates hle_entry after flash words [first, end) changed. Only a copy
+// overlapping them can appear or vanish, so the rest of flash is searched
+// only when the copy in use was overwritten. Entry words that move decode
+// again.
+static void AVR_FindRuntimeRoutines(AvrCore *core, size_t first, size_t end)
+{
+    for (uint8_t id = 0; id < AVR_HLE_ROUTINES; id++)
     {
-        uint8_t a = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x30));
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        if (d < core->regs_size)
+        const AvrRuntimeRoutine *routine = &avrRuntimeRoutines[id];
+        uint16_t old = core->hle_entry[id];
+        uint16_t entry = old;
+        size_t from = first >= routine->words ? first - routine->words + 1 : 0;
+        if (entry != 0xFFFF && entry >= from && entry < end && !AVR_RoutineAt(core, entry, routine))
         {
-            core->regs[d] = AVR_IoRead(core, (uint16_t)(AVR_IO_BASE + a));
+            entry = AVR_FindRoutine(core, routine, 0, core->flash_size / 2);
         }
-        return 1;
-    }
-    if ((opcode & 0xFE0F) == 0x9000)
-    {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint16_t addr = AVR_FetchWord(core);
-        if (d < core->regs_size)
+        else
         {
-            core->regs[d] = AVR_ReadData(core, addr);
+            // A new copy counts only below the one in use
+            uint16_t found = AVR_FindRoutine(core, routine, from, entry < end ? entry : end);
+            if (found != 0xFFFF)
+            {
+                entry = found;
+            }
         }
-        return 2;
-    }
-    if ((opcode & 0xFE0F) == 0x9200)
-    {
-        uint8_t r = (uint8_t)((opcode >> 4) & 0x1F);
-        uint16_t addr = AVR_FetchWord(core);
-        if (r < core->regs_size)
+        if (entry == old)
         {
-            AVR_WriteData(core, addr, core->regs[r]);
+            continue;
         }
-        return 2;
-    }
-    if ((opcode & 0xFC00) == 0x2C00)
-    {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint8_t r = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
-        if (d < core->regs_size && r < core->regs_size)
+        core->hle_entry[id] = entry;
+        if (core->decoded && old < core->decoded_size)
         {
-            core->regs[d] = core->regs[r];
+            core->decoded[old].op = AVR_OP_UNDECODED;
         }
-        return 1;
-    }
-    if ((opcode & 0xFF00) == 0x0100)
-    {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x0F);
-        uint8_t r = (uint8_t)(opcode & 0x0F);
-        uint8_t dIndex = (uint8_t)(d * 2);
-        uint8_t rIndex = (uint8_t)(r * 2);
-        if (dIndex + 1 < core->regs_size && rIndex + 1 < core->regs_size)
+        if (core->decoded && entry < core->decoded_size)
         {
-            core->regs[dIndex] = core->regs[rIndex];
-            core->regs[dIndex + 1] = core->regs[rIndex + 1];
+            core->decoded[entry].op = AVR_OP_UNDECODED;
         }
-        return 1;
     }
-    if ((opcode & 0xFC00) == 0x2400)
+}
+
+static uint32_t AVR_GetRegBytes(const AvrCore *core, const uint8_t *index, uint8_t bytes)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint8_t r = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
-        if (d < core->regs_size && r < core->regs_size)
-        {
-            uint8_t value = (uint8_t)(core->regs[d] ^ core->regs[r]);
-            core->regs[d] = value;
-            core->zero_flag = (uint8_t)(value == 0);
-        }
-        return 1;
+        value |= (uint32_t)core->regs[index[i]] << (8 * i);
     }
-    if ((opcode & 0xF000) == 0x7000)
+    return value;
+}
+
+static void AVR_SetRegBytes(AvrCore *core, const uint8_t *index, uint8_t bytes, uint32_t value)
+{
+    for (uint8_t i = 0; i < bytes; i++)
     {
-        uint8_t d = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
-        if (d < core->regs_size)
-        {
-            uint8_t value = (uint8_t)(core->regs[d] & k);
-            core->regs[d] = value;
-            core->zero_flag = (uint8_t)(value == 0);
-        }
-        return 1;
+        core->regs[index[i]] = (uint8_t)(value >> (8 * i));
     }
-    if ((opcode & 0xF000) == 0x6000)
+}
+
+// Runs routine id from its entry up to its RET; returns the cycles used
+static uint32_t AVR_RunRuntimeRoutine(AvrCore *core, uint8_t id)
+{
+    const AvrRuntimeRoutine *routine = &avrRuntimeRoutines[id];
+    const uint8_t bytes = routine->bytes;
+    const uint8_t top = (uint8_t)(8 * bytes - 1);
+    const uint32_t mask = (uint32_t)((1ull << (8 * bytes)) - 1);
+    const uint8_t passes = (uint8_t)(8 * bytes + 1);
+    uint8_t dividendRegs[4];
+    uint8_t divisorRegs[4];
+    uint8_t quotientRegs[4];
+    uint8_t remainderRegs[4];
+    for (uint8_t i = 0; i < bytes; i++)
+    {
+        dividendRegs[i] = (uint8_t)(routine->dividend + i);
+        divisorRegs[i] = (uint8_t)(routine->divisor + i);
+        quotientRegs[i] = (uint8_t)(routine->quotient_out + i);
+        remainderRegs[i] = (uint8_t)(routine->remainder_out + i);
+    }
+    uint32_t dividend = AVR_GetRegBytes(core, dividendRegs, bytes);
+    uint32_t divisor = AVR_GetRegBytes(core, divisorRegs, bytes);
+    uint32_t remainder = 0;
+    uint32_t carry = 0; // Cleared by the SUB that zeroes the remainder
+    uint8_t halfCarry = 0;
+    // The loop branch is taken on every pass but the last
+    uint32_t cycles = routine->setup_cycles + passes * (routine->shift_cycles + 2u) - 1u +
+                      routine->finish_cycles;
+
+    for (uint8_t pass = 0; pass < passes; pass++)
     {
-        uint8_t d = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
-        if (d < core->regs_size)
+        if (pass > 0)
         {
-            uint8_t value = (uint8_t)(core->regs[d] | k);
-            core->regs[d] = value;
-            core->zero_flag = (uint8_t)(value == 0);
+            // ROL into the remainder, then CP/CPC leaves C set when the
+            // divisor does not fit
+            remainder = ((remainder << 1) | carry) & mask;
+            if (remainder < divisor)
+            {
+                carry = 1;
+                cycles += routine->fit_cycles;
+            }
+            else
+            {
+                remainder -= divisor;
+                carry = 0;
+                cycles += routine->subtract_cycles;
+            }
         }
-        return 1;
+        // ROL of the dividend; H is left by the one on its top byte
+        halfCarry = (uint8_t)((dividend >> (top - 4)) & 1);
+        uint32_t out = (dividend >> top) & 1;
+        dividend = ((dividend << 1) | carry) & mask;
+        carry = out;
     }
-    if ((opcode & 0xF000) == 0x5000)
+
+    uint32_t quotient = ~dividend & mask;
+    AVR_SetRegBytes(core, dividendRegs, bytes, quotient);
+    AVR_SetRegBytes(core, routine->remainder, bytes, remainder);
+    core->regs[routine->counter] = 0;
+    AVR_SetRegBytes(core, quotientRegs, bytes, quotient);
+    AVR_SetRegBytes(core, remainderRegs, bytes, remainder);
+
+    // Flags of the COM on the quotient's top byte
+    uint8_t high = (uint8_t)(quotient >> (top - 7));
+    core->flags_op = AVR_FLAGS_STORED;
+    core->flags_base = (uint8_t)(AVR_FLAG_C | (halfCarry ? AVR_FLAG_H : 0) |
+                                 ((high & 0x80) ? (AVR_FLAG_N | AVR_FLAG_S) : 0) |
+                                 (high == 0 ? AVR_FLAG_Z : 0));
+    core->hle_calls++;
+    return cycles;
+}
+
+void AVR_SetRuntimeHle(AvrCore *core, uint8_t enabled)
+{
+    if (!core)
+        return;
+    core->runtime_hle = (uint8_t)(enabled && core->regs_size >= 32);
+    for (uint8_t id = 0; id < AVR_HLE_ROUTINES; id++)
     {
-        uint8_t d = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
-        if (d < core->regs_size)
-        {
-            uint16_t lhs = core->regs[d];
-            uint16_t rhs = k;
-            uint16_t result = (uint16_t)(lhs - rhs);
-            core->regs[d] = (uint8_t)result;
-            core->zero_flag = (uint8_t)((uint8_t)result == 0);
-            core->carry_flag = (uint8_t)(lhs < rhs);
-        }
-        return 1;
+        core->hle_entry[id] = 0xFFFF;
     }
-    if ((opcode & 0xF000) == 0x4000)
+    if (core->runtime_hle)
     {
-        uint8_t d = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
-        if (d < core->regs_size)
-        {
-            uint16_t lhs = core->regs[d];
-            uint16_t rhs = (uint16_t)k + (core->carry_flag ? 1 : 0);
-            uint16_t result = (uint16_t)(lhs - rhs);
-            core->regs[d] = (uint8_t)result;
-            core->zero_flag = (uint8_t)((uint8_t)result == 0);
-            core->carry_flag = (uint8_t)(lhs < rhs);
-        }
-        return 1;
+        AVR_FindRuntimeRoutines(core, 0, core->flash_size / 2);
     }
-    if ((opcode & 0xF000) == 0x3000)
+    // Entry words decode differently now
+    if (core->decoded)
     {
-        uint8_t d = (uint8_t)(16 + ((opcode >> 4) & 0x0F));
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 4) & 0xF0));
-        if (d < core->regs_size)
-        {
-            uint16_t lhs = core->regs[d];
-            uint16_t rhs = k;
-            uint16_t result = (uint16_t)(lhs - rhs);
-            core->zero_flag = (uint8_t)((uint8_t)result == 0);
-            core->carry_flag = (uint8_t)(lhs < rhs);
-        }
-        return 1;
+        memset(core->decoded, 0, core->decoded_size * sizeof(AvrDecoded));
     }
-    if ((opcode & 0xFC00) == 0x1400)
+}
+
+void AVR_InvalidateFlash(AvrCore *core, uint32_t byte_address, size_t size)
+{
+    if (!core || size == 0)
+        return;
+    if (core->runtime_hle)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint8_t r = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
-        if (d < core->regs_size && r < core->regs_size)
-        {
-            uint16_t lhs = core->regs[d];
-            uint16_t rhs = core->regs[r];
-            uint16_t result = (uint16_t)(lhs - rhs);
-            core->zero_flag = (uint8_t)((uint8_t)result == 0);
-            core->carry_flag = (uint8_t)(lhs < rhs);
-        }
-        return 1;
+        AVR_FindRuntimeRoutines(core, (size_t)byte_address / 2, ((size_t)byte_address + size + 1) / 2);
     }
-    if ((opcode & 0xFC00) == 0x0C00)
+    if (!core->decoded)
+        return;
+    size_t pageWords = core->mcu_kind == AVR_MCU_2560 ? 128 : 64;
+    size_t first = ((size_t)byte_address / 2) / pageWords * pageWords;
+    size_t last = (((size_t)byte_address + size - 1) / 2) / pageWords * pageWords + pageWords;
+    // A two-word instruction ending the previous page keeps its second word here
+    if (first > 0)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint8_t r = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
-        if (d < core->regs_size && r < core->regs_size)
-        {
-            uint16_t sum = (uint16_t)core->regs[d] + (uint16_t)core->regs[r];
-            core->regs[d] = (uint8_t)sum;
-            core->zero_flag = (uint8_t)((uint8_t)sum == 0);
-            core->carry_flag = (uint8_t)(sum > 0xFF);
-        }
-        return 1;
+        first--;
     }
-    if ((opcode & 0xFC00) == 0x1C00)
+    if (last > core->decoded_size)
+    {
+        last = core->decoded_size;
+    }
+    for (size_t i = first; i < last; ++i)
+    {
+        core->decoded[i].op = AVR_OP_UNDECODED;
+    }
+}
+
+// Stores below SRAM land in the register file or I/O space (hooks)
+static int AVR_StoreReachesIo(AvrCore *core, const AvrDecoded *insn)
+{
+    uint16_t address = insn->op == AVR_OP_STS ? insn->k : AVR_GetRegWord(core, 26);
+    return address < core->data_sram_start;
+}
+
+// Polling-loop detection within one block. A taken backward branch starts
+// an iteration at its target; when the next one comes back to the same head
+// with registers, flags and SP unchanged and nothing was stored or read
+// through a hook, every further iteration repeats it exactly: nothing
+// outside the core can change before the block ends.
+typedef struct AvrLoopState
+{
+    uint16_t head;  // 0xFFFF: no iteration recorded
+    uint8_t clean;  // No store or hooked read since head
+    uint8_t flags;
+    uint16_t sp;
+    uint32_t cycles; // Block cycles and instructions at head
+    uint32_t count;
+    uint8_t regs[32];
+} AvrLoopState;
+
+// At a backward branch target: 1 when the iteration just finished changed
+// nothing, otherwise records a new one starting here.
+static int AVR_LoopRepeats(const AvrCore *core, AvrLoopState *loop, uint32_t cycles, uint32_t count)
+{
+    size_t regs = core->regs_size < sizeof(loop->regs) ? core->regs_size : sizeof(loop->regs);
+    uint8_t flags = AVR_Flags(core);
+    if (loop->head == core->pc && loop->clean && loop->flags == flags && loop->sp == core->sp &&
+        memcmp(loop->regs, core->regs, regs) == 0)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        uint8_t r = (uint8_t)((opcode & 0x0F) | ((opcode >> 5) & 0x10));
-        if (d < core->regs_size && r < core->regs_size)
-        {
-            uint16_t sum = (uint16_t)core->regs[d] + (uint16_t)core->regs[r] + (core->carry_flag ? 1 : 0);
-            core->regs[d] = (uint8_t)sum;
-            core->zero_flag = (uint8_t)((uint8_t)sum == 0);
-            core->carry_flag = (uint8_t)(sum > 0xFF);
-        }
         return 1;
     }
-    if ((opcode & 0xFF00) == 0x9A00)
+    loop->head = core->pc;
+    loop->clean = 1;
+    loop->flags = flags;
+    loop->sp = core->sp;
+    loop->cycles = cycles;
+    loop->count = count;
+    memcpy(loop->regs, core->regs, regs);
+    return 0;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AVR_THREADED_DISPATCH 1
+#else
+#define AVR_THREADED_DISPATCH 0
+#endif
+
+#if AVR_THREADED_DISPATCH
+// Each handler jumps straight to the next one through the label table
+#define AVR_DISPATCH(op) goto *handlers[op];
+#define AVR_HANDLER(name) op_##name:
+#define AVR_DISPATCH_END
+#else
+#define AVR_DISPATCH(op) \
+    switch (op)          \
+    {                    \
+    default:
+#define AVR_HANDLER(name) case AVR_OP_##name:
+#define AVR_DISPATCH_END }
+#endif
+
+uint32_t AVR_ExecuteBlock(AvrCore *core, uint32_t max_cycles, uint32_t *steps)
+{
+#if AVR_THREADED_DISPATCH
+    static const void *const handlers[] = {
+        &&op_NOP, // AVR_OP_UNDECODED: never dispatched
+#define AVR_OP_LABEL(name) &&op_##name,
+        AVR_OP_LIST(AVR_OP_LABEL)
+#undef AVR_OP_LABEL
+    };
+#endif
+    uint32_t cycles = 0;
+    uint32_t count = 0;
+    AvrDecoded insn;
+    AvrLoopState loop;
+    loop.head = 0xFFFF;
+
+    if (core->irq_pending != 0 && AVR_CheckInterrupts(core))
     {
-        uint8_t a = (uint8_t)((opcode >> 3) & 0x1F);
-        uint8_t b = (uint8_t)(opcode & 0x07);
-        AVR_IoSetBit(core, (uint16_t)(AVR_IO_BASE + a), b, 1);
-        return 2;
+        cycles = 4;
+        count = 1;
+        goto done;
     }
-    if ((opcode & 0xFF00) == 0x9800)
+    if (core->sleeping)
     {
-        uint8_t a = (uint8_t)((opcode >> 3) & 0x1F);
-        uint8_t b = (uint8_t)(opcode & 0x07);
-        AVR_IoSetBit(core, (uint16_t)(AVR_IO_BASE + a), b, 0);
-        return 2;
+        // Nothing to run until an interrupt wakes the core
+        cycles = max_cycles;
+        goto done;
     }
-    if ((opcode & 0xFE0F) == 0x940A)
+
+next:
+    if (cycles >= max_cycles)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        if (d < core->regs_size)
-        {
-            uint8_t value = (uint8_t)(core->regs[d] - 1);
-            core->regs[d] = value;
-            core->zero_flag = (uint8_t)(value == 0);
-        }
-        return 1;
+        goto done;
     }
-    if ((opcode & 0xFE0F) == 0x920F)
+    if ((size_t)core->pc * 2 + 1 >= core->flash_size)
     {
-        uint8_t r = (uint8_t)((opcode >> 4) & 0x1F);
-        if (r < core->regs_size)
-        {
-            AVR_Push(core, core->regs[r]);
-        }
-        return 2;
+        // Past the end of flash: fetches 0x0000 without advancing
+        cycles += 1;
+        count++;
+        goto next;
     }
-    if ((opcode & 0xFE0F) == 0x900F)
+    // Copied out, so a handler that rewrites flash cannot change it under us
+    if (core->pc < core->decoded_size)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x1F);
-        if (d < core->regs_size)
+        AvrDecoded *entry = &core->decoded[core->pc];
+        if (entry->op == AVR_OP_UNDECODED)
         {
-            core->regs[d] = AVR_Pop(core);
+            AVR_Decode(core, core->pc, entry);
         }
-        return 2;
+        insn = *entry;
     }
-    if ((opcode & 0xF000) == 0xD000)
+    else
     {
-        int16_t k = (int16_t)(opcode & 0x0FFF);
-        if (k & 0x0800)
+        AVR_Decode(core, core->pc, &insn);
+    }
+    // I/O and stack pointer writes start a block of their own: hooks see the
+    // caller's cycle count as of that instruction, and interrupts they raise
+    // are checked before the next one.
+    if (insn.op >= AVR_OP_FIRST_STORE && count > 0 &&
+        (insn.op >= AVR_OP_FIRST_BARRIER || AVR_StoreReachesIo(core, &insn)))
+    {
+        goto done;
+    }
+    core->pc++;
+    count++;
+    cycles += insn.cycles;
+
+    AVR_DISPATCH(insn.op)
+    AVR_HANDLER(NOP)
+    goto next;
+    AVR_HANDLER(LPM_Z_INC)
+    {
+        uint16_t z = AVR_GetRegWord(core, 30);
+        core->flash_loads++;
+        if (z < core->flash_size)
         {
-            k = (int16_t)(k | 0xF000);
+            core->regs[insn.d] = core->flash[z];
         }
-        uint16_t returnAddr = core->pc;
-        AVR_Push(core, (uint8_t)(returnAddr & 0xFF));
-        AVR_Push(core, (uint8_t)((returnAddr >> 8) & 0xFF));
-        core->pc = (uint16_t)(core->pc + k);
-        return 3;
+        else
+        {
+            core->regs[insn.d] = 0;
+        }
+        AVR_SetRegWord(core, 30, (uint16_t)(z + 1));
+        goto next;
     }
-    if ((opcode & 0xFE0E) == 0x940E)
+    AVR_HANDLER(CPC)
+    if (insn.d < core->regs_size && insn.r < core->regs_size)
     {
-        uint16_t addr = AVR_FetchWord(core);
-        uint16_t returnAddr = core->pc;
-        AVR_Push(core, (uint8_t)(returnAddr & 0xFF));
-        AVR_Push(core, (uint8_t)((returnAddr >> 8) & 0xFF));
-        core->pc = addr;
-        return 4;
+        uint8_t lhs = core->regs[insn.d];
+        uint8_t rhs = core->regs[insn.r];
+        uint8_t result = (uint8_t)(lhs - rhs - AVR_FlagC(core));
+        core->flags_base = (uint8_t)(AVR_FlagZ(core) ? AVR_FLAG_Z : 0);
+        AVR_SetFlags(core, AVR_FLAGS_SUB_CARRY, lhs, rhs, result);
     }
-    if (opcode == 0x9508)
+    goto next;
+    AVR_HANDLER(LDI)
+    if (insn.d < core->regs_size)
     {
-        uint8_t high = AVR_Pop(core);
-        uint8_t low = AVR_Pop(core);
-        core->pc = (uint16_t)(low | (high << 8));
-        return 4;
+        core->regs[insn.d] = insn.r;
     }
-    if (opcode == 0x9518)
+    goto next;
+    AVR_HANDLER(IN)
+    if (insn.d < core->regs_size)
     {
-        uint8_t high = AVR_Pop(core);
-        uint8_t low = AVR_Pop(core);
-        core->pc = (uint16_t)(low | (high << 8));
-        uint8_t sreg = AVR_IoRead(core, AVR_SREG);
-        sreg = (uint8_t)(sreg | (1u << 7));
-        AVR_IoWrite(core, AVR_SREG, sreg);
-        return 4;
+        core->regs[insn.d] = AVR_IoRead(core, insn.k);
     }
-    if (opcode == 0x9478)
+    if (core->io_read_hook)
     {
-        uint8_t sreg = AVR_IoRead(core, AVR_SREG);
-        sreg = (uint8_t)(sreg | (1u << 7));
-        AVR_IoWrite(core, AVR_SREG, sreg);
-        return 1;
+        loop.clean = 0;
     }
-    if (opcode == 0x94F8)
+    goto next;
+    AVR_HANDLER(LDS)
+    AVR_SkipWord(core);
+    if (insn.d < core->regs_size)
     {
-        uint8_t sreg = AVR_IoRead(core, AVR_SREG);
-        sreg = (uint8_t)(sreg & ~(1u << 7));
-        AVR_IoWrite(core, AVR_SREG, sreg);
-        return 1;
+        core->regs[insn.d] = AVR_ReadData(core, insn.k);
     }
-    if ((opcode & 0xFF00) == 0x9600)
+    goto next;
+    AVR_HANDLER(MOV)
+    if (insn.d < core->regs_size && insn.r < core->regs_size)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x03);
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 2) & 0x30));
-        uint8_t index = (uint8_t)(24 + (d * 2));
-        uint16_t value = AVR_GetRegWord(core, index);
-        value = (uint16_t)(value + k);
-        AVR_SetRegWord(core, index, value);
-        core->zero_flag = (uint8_t)(value == 0);
-        return 2;
+        core->regs[insn.d] = core->regs[insn.r];
     }
-    if ((opcode & 0xFF00) == 0x9700)
+    goto next;
+    AVR_HANDLER(MOVW)
+    if ((size_t)insn.d + 1 < core->regs_size && (size_t)insn.r + 1 < core->regs_size)
     {
-        uint8_t d = (uint8_t)((opcode >> 4) & 0x03);
-        uint8_t k = (uint8_t)((opcode & 0x0F) | ((opcode >> 2) & 0x30));
-        uint8_t index = (uint8_t)(24 + (d * 2));
-        uint16_t value = AVR_GetRegWord(core, index);
-        value = (uint16_t)(value - k);
-        AVR_SetRegWord(core, index, value);
-        core->zero_flag = (uint8_t)(value == 0);
-        return 2;
+        core->regs[insn.d] = core->regs[insn.r];
+        core->regs[insn.d + 1] = core->regs[insn.r + 1];
     }
-    if ((opcode & 0xFC07) == 0xF401)
+    goto next;
+    AVR_HANDLER(EOR)
+    if (insn.d < core->regs_size && insn.r < core->regs_size)
     {
-        int8_t k = (int8_t)((opcode >> 3) & 0x7F);
-        if (k & 0x40)
+        uint8_t value = (uint8_t)(core->regs[insn.d] ^ core->regs[insn.r]);
+        core->regs[insn.d] = value;
+        AVR_SetFlagsKeeping(core, AVR_FLAG_H | AVR_FLAG_C, AVR_FLAGS_LOGIC, 0, value);
+    }
+    goto next;
+    AVR_HANDLER(ANDI)
+    if (insn.d < core->regs_size)
+    {
+        uint8_t value = (uint8_t)(core->regs[insn.d] & insn.r);
+        core->regs[insn.d] = value;
+        AVR_SetFlagsKeeping(core, AVR_FLAG_H | AVR_FLAG_C, AVR_FLAGS_LOGIC, 0, value);
+    }
+    goto next;
+    AVR_HANDLER(ORI)
+    if (insn.d < core->regs_size)
+    {
+        uint8_t value = (uint8_t)(core->regs[insn.d] | insn.r);
+        core->regs[insn.d] = value;
+        AVR_SetFlagsKeeping(core, AVR_FLAG_H | AVR_FLAG_C, AVR_FLAGS_LOGIC, 0, value);
+    }
+    goto next;
+    AVR_HANDLER(SUBI)
+    AVR_HANDLER(SBCI)
+    AVR_HANDLER(CPI)
+    if (insn.d < core->regs_size)
+    {
+        uint8_t lhs = core->regs[insn.d];
+        uint8_t result;
+        if (insn.op == AVR_OP_SBCI)
         {
-            k = (int8_t)(k | 0x80);
+            result = (uint8_t)(lhs - insn.r - AVR_FlagC(core));
+            core->flags_base = (uint8_t)(AVR_FlagZ(core) ? AVR_FLAG_Z : 0);
+            AVR_SetFlags(core, AVR_FLAGS_SUB_CARRY, lhs, insn.r, result);
         }
-        if (!core->zero_flag)
+        else
         {
-            core->pc = (uint16_t)(core->pc + k);
-            return 2;
+            result = (uint8_t)(lhs - insn.r);
+            AVR_SetFlags(core, AVR_FLAGS_SUB, lhs, insn.r, result);
+        }
+        if (insn.op != AVR_OP_CPI)
+        {
+            core->regs[insn.d] = result;
         }
-        return 1;
     }
-    if ((opcode & 0xFC07) == 0xF001)
+    goto next;
+    AVR_HANDLER(CP)
+    if (insn.d < core->regs_size && insn.r < core->regs_size)
     {
-        int8_t k = (int8_t)((opcode >> 3) & 0x7F);
-        if (k & 0x40)
+        uint8_t lhs = core->regs[insn.d];
+        uint8_t rhs = core->regs[insn.r];
+        AVR_SetFlags(core, AVR_FLAGS_SUB, lhs, rhs, (uint8_t)(lhs - rhs));
+    }
+    goto next;
+    AVR_HANDLER(ADD)
+    AVR_HANDLER(ADC)
+    if (insn.d < core->regs_size && insn.r < core->regs_size)
+    {
+        uint8_t lhs = core->regs[insn.d];
+        uint8_t rhs = core->regs[insn.r];
+        uint8_t sum = (uint8_t)(lhs + rhs);
+        if (insn.op == AVR_OP_ADC)
         {
-            k = (int8_t)(k | 0x80);
+            sum = (uint8_t)(sum + AVR_FlagC(core));
         }
-        if (core->zero_flag)
+        core->regs[insn.d] = sum;
+        AVR_SetFlags(core, AVR_FLAGS_ADD, lhs, rhs, sum);
+    }
+    goto next;
+    AVR_HANDLER(DEC)
+    if (insn.d < core->regs_size)
+    {
+        uint8_t value = (uint8_t)(core->regs[insn.d] - 1);
+        core->regs[insn.d] = value;
+        AVR_SetFlagsKeeping(core, AVR_FLAG_H | AVR_FLAG_C, AVR_FLAGS_DEC, 0, value);
+    }
+    goto next;
+    AVR_HANDLER(ADIW)
+    AVR_HANDLER(SBIW)
+    {
+        uint16_t lhs = AVR_GetRegWord(core, insn.d);
+        uint16_t value = insn.op == AVR_OP_ADIW ? (uint16_t)(lhs + insn.r) : (uint16_t)(lhs - insn.r);
+        AVR_SetRegWord(core, insn.d, value);
+        AVR_SetFlagsKeeping(core, AVR_FLAG_H, insn.op == AVR_OP_ADIW ? AVR_FLAGS_ADIW : AVR_FLAGS_SBIW,
+                            lhs, value);
+        goto next;
+    }
+    AVR_HANDLER(BRNE)
+    AVR_HANDLER(BREQ)
+    if (AVR_FlagZ(core) == (insn.op == AVR_OP_BREQ))
+    {
+        core->pc = (uint16_t)(core->pc + insn.k);
+        cycles += 1;
+        if ((int16_t)insn.k < 0)
         {
-            core->pc = (uint16_t)(core->pc + k);
-            return 2;
+            goto backward;
         }
-        return 1;
     }
-    if ((opcode & 0xF000) == 0xC000)
+    goto next;
+    AVR_HANDLER(RJMP)
+    core->pc = (uint16_t)(core->pc + insn.k);
+    if ((int16_t)insn.k < 0)
     {
-        int16_t k = (int16_t)(opcode & 0x0FFF);
-        if (k & 0x0800)
+        goto backward;
+    }
+    goto next;
+    AVR_HANDLER(ST_X_INC)
+    {
+        uint16_t x = AVR_GetRegWord(core, 26);
+        if (x < core->data_sram_start)
         {
-            k = (int16_t)(k | 0xF000);
+            AVR_SyncIo(core, x);
+        }
+        AVR_WriteData(core, x, core->regs[insn.r]);
+        AVR_SetRegWord(core, 26, (uint16_t)(x + 1));
+        if (x < core->data_sram_start)
+        {
+            goto done;
+        }
+        loop.clean = 0;
+        goto next;
+    }
+    AVR_HANDLER(STS)
+    AVR_SkipWord(core);
+    if (insn.k < core->data_sram_start)
+    {
+        AVR_SyncIo(core, insn.k);
+    }
+    if (insn.r < core->regs_size)
+    {
+        AVR_WriteData(core, insn.k, core->regs[insn.r]);
+    }
+    if (insn.k < core->data_sram_start)
+    {
+        goto done;
+    }
+    loop.clean = 0;
+    goto next;
+    AVR_HANDLER(OUT)
+    AVR_SyncIo(core, insn.k);
+    if (insn.r < core->regs_size)
+    {
+        AVR_IoWrite(core, insn.k, core->regs[insn.r]);
+    }
+    goto done;
+    AVR_HANDLER(SBI)
+    AVR_SyncIo(core, insn.k);
+    AVR_IoSetBit(core, insn.k, insn.r, 1);
+    goto done;
+    AVR_HANDLER(CBI)
+    AVR_SyncIo(core, insn.k);
+    AVR_IoSetBit(core, insn.k, insn.r, 0);
+    goto done;
+    AVR_HANDLER(PUSH)
+    if (insn.r < core->regs_size)
+    {
+        AVR_Push(core, core->regs[insn.r]);
+    }
+    goto done;
+    AVR_HANDLER(POP)
+    if (insn.d < core->regs_size)
+    {
+        core->regs[insn.d] = AVR_Pop(core);
+    }
+    goto done;
+    AVR_HANDLER(RCALL)
+    AVR_HANDLER(CALL)
+    {
+        if (insn.op == AVR_OP_CALL)
+        {
+            AVR_SkipWord(core);
         }
-        core->pc = (uint16_t)(core->pc + k);
-        return 2;
+        uint16_t returnAddr = core->pc;
+        AVR_Push(core, (uint8_t)(returnAddr & 0xFF));
+        AVR_Push(core, (uint8_t)((returnAddr >> 8) & 0xFF));
+        core->pc = insn.op == AVR_OP_CALL ? insn.k : (uint16_t)(core->pc + insn.k);
+        goto done;
     }
+    AVR_HANDLER(RET)
+    AVR_HANDLER(RETI)
+    {
+        uint8_t high = AVR_Pop(core);
+        uint8_t low = AVR_Pop(core);
+        core->pc = (uint16_t)(low | (high << 8));
+        if (insn.op == AVR_OP_RETI)
+        {
+            uint8_t sreg = AVR_IoRead(core, AVR_SREG);
+            sreg = (uint8_t)(sreg | (1u << 7));
+            AVR_IoWrite(core, AVR_SREG, sreg);
+        }
+        goto done;
+    }
+    AVR_HANDLER(SEI)
+    AVR_HANDLER(CLI)
+    {
+        uint8_t sreg = AVR_IoRead(core, AVR_SREG);
+        if (insn.op == AVR_OP_SEI)
+            sreg = (uint8_t)(sreg | (1u << 7));
+        else
+            sreg = (uint8_t)(sreg & ~(1u << 7));
+        AVR_IoWrite(core, AVR_SREG, sreg);
+        goto done;
+    }
+    AVR_HANDLER(SLEEP)
+    if (AVR_IoPeek(core, AVR_SMCR) & 0x01)
+    {
+        core->sleeping = 1;
+    }
+    goto done;
+    AVR_HANDLER(IN_SYNC)
+    AVR_SyncIo(core, insn.k);
+    if (insn.d < core->regs_size)
+    {
+        core->regs[insn.d] = AVR_IoRead(core, insn.k);
+    }
+    goto done;
+    AVR_HANDLER(LDS_SYNC)
+    AVR_SkipWord(core);
+    AVR_SyncIo(core, insn.k);
+    if (insn.d < core->regs_size)
+    {
+        core->regs[insn.d] = AVR_IoRead(core, insn.k);
+    }
+    goto done;
+    AVR_HANDLER(HLE)
+    cycles += AVR_RunRuntimeRoutine(core, insn.r);
+    core->pc = (uint16_t)(core->pc - 1 + avrRuntimeRoutines[insn.r].words - 1);
+    goto done;
+    AVR_DISPATCH_END
 
-    // Moved specific handlers (LPM Z+, ST X+, CPC) to top of AVR_ExecuteNext
+backward:
+    // The rest of the block would only repeat the last iteration: skip the
+    // whole iterations that fit, the remainder runs as usual.
+    if (AVR_LoopRepeats(core, &loop, cycles, count) && cycles < max_cycles)
+    {
+        uint32_t period = cycles - loop.cycles;
+        uint32_t iterations = (max_cycles - cycles) / period;
+        count += iterations * (count - loop.count);
+        cycles += iterations * period;
+        core->idle_loop_cycles += (uint64_t)iterations * period;
+        loop.cycles = cycles;
+        loop.count = count;
+    }
+    goto next;
 
-    return 1;
+done:
+    if (steps)
+    {
+        *steps = count;
+    }
+    return cycles;
+}
+
+uint32_t AVR_ExecuteNext(AvrCore *core)
+{
+    return AVR_ExecuteBlock(core, 1, NULL);
 }
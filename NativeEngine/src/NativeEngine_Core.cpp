@@ -17,6 +17,8 @@
 #include "../include/Circuit/CircuitContext.h"
 #include "../include/Circuit/Diode.h"
 #include "../include/Circuit/HexLoader.h"
+#include "../include/Circuit/NetlistFormat.hpp"
+#include "../include/Circuit/ReactiveComponents.h"
 #include "../include/Physics/PhysicsWorld.h"
 
 #include "../include/MCU/ATmega328P_ISA.h"
@@ -29,7 +31,24 @@ namespace
   SharedState g_sharedState; // Legacy State
   std::unique_ptr<NativeEngine::Physics::PhysicsWorld> g_physics = nullptr;
   std::unordered_map<std::uint64_t, std::shared_ptr<AnalogDriver>> g_analogDrivers;
+  std::uint32_t g_nextComponentId = 1u;
+
+  // Double-buffered CircuitState: Publish fills the back block, then flips.
+  struct CircuitStateBuffer
+  {
+    CircuitState view{};
+    std::vector<float> nodeVoltages;
+    std::vector<std::uint32_t> sourceIds;
+    std::vector<float> sourceCurrents;
+    std::vector<std::uint32_t> componentIds;
+    std::vector<float> componentPower;
+  };
+  CircuitStateBuffer g_stateBuffers[2];
+  int g_stateFront = -1; // -1 = nothing published
+  bool g_statePublishing = false;
+  std::uint64_t g_stateSequence = 0;
   std::uint32_t g_hiddenNextId = 1000000u;
+  bool g_circuitProfiling = false;
 
   std::uint64_t MakeAnalogDriverKey(int avrIndex, int pinIndex)
   {
@@ -48,50 +67,56 @@ namespace
 
   AvrComponent *FindAvrComponent(Context &ctx)
   {
-    for (auto &comp : ctx.GetComponents())
-    {
-      if (comp && comp->GetType() == ComponentType::IC_Pin)
-      {
-        return static_cast<AvrComponent *>(comp.get());
-      }
-    }
-    return nullptr;
+    const auto &avrs = ctx.GetComponentsOfType(ComponentType::IC_Pin);
+    return avrs.empty() ? nullptr : static_cast<AvrComponent *>(avrs.front());
   }
 
-  std::vector<AvrComponent *> GetAvrComponents(Context &ctx)
+  AvrComponent *FindAvrByIndex(Context &ctx, int index)
   {
-    std::vector<AvrComponent *> out;
-    for (auto &comp : ctx.GetComponents())
+    const auto &avrs = ctx.GetComponentsOfType(ComponentType::IC_Pin);
+    if (index < 0 || static_cast<std::size_t>(index) >= avrs.size())
     {
-      if (!comp || comp->GetType() != ComponentType::IC_Pin)
-      {
-        continue;
-      }
-      out.push_back(static_cast<AvrComponent *>(comp.get()));
+      return nullptr;
     }
-    return out;
+    return static_cast<AvrComponent *>(avrs[static_cast<std::size_t>(index)]);
   }
 
-  AvrComponent *FindAvrByIndex(Context &ctx, int index)
+  // Instantiates a circuit component from the C API type code and float
+  // parameters; nullptr for types that cannot be created from the API.
+  std::shared_ptr<Component> CreateComponent(ComponentType type, std::uint32_t id,
+                                             int paramCount, const float *params)
   {
-    if (index < 0)
+    std::shared_ptr<Component> comp = nullptr;
+
+    if (type == ComponentType::Resistor)
     {
-      return nullptr;
+      double r = (paramCount >= 1) ? params[0] : 1000.0;
+      comp = std::make_shared<Resistor>(id, r);
     }
-    int current = 0;
-    for (auto &comp : ctx.GetComponents())
+    else if (type == ComponentType::VoltageSource)
     {
-      if (!comp || comp->GetType() != ComponentType::IC_Pin)
-      {
-        continue;
-      }
-      if (current == index)
-      {
-        return static_cast<AvrComponent *>(comp.get());
-      }
-      current++;
+      double v = (paramCount >= 1) ? params[0] : 5.0;
+      comp = std::make_shared<VoltageSource>(id, v);
     }
-    return nullptr;
+    else if (type == ComponentType::Diode)
+    {
+      comp = std::make_shared<Diode>(id);
+    }
+    else if (type == ComponentType::Capacitor)
+    {
+      double c = (paramCount >= 1) ? params[0] : 1e-6;
+      comp = std::make_shared<Capacitor>(id, c);
+    }
+    else if (type == ComponentType::Inductor)
+    {
+      double l = (paramCount >= 1) ? params[0] : 1e-3;
+      comp = std::make_shared<Inductor>(id, l);
+    }
+    else if (type == ComponentType::IC_Pin) // Using IC_Pin (6) for AVR
+    {
+      comp = std::make_shared<AvrComponent>(id);
+    }
+    return comp;
   }
 
   void UpdateSharedState(Context &ctx)
@@ -108,6 +133,49 @@ namespace
     }
   }
 
+  void PublishCircuitState(Context &ctx)
+  {
+    CircuitStateBuffer &back = g_stateBuffers[g_stateFront == 0 ? 1 : 0];
+
+    const std::size_t nodeCount = ctx.GetNodeCount();
+    back.nodeVoltages.resize(nodeCount);
+    for (std::size_t i = 0; i < nodeCount; ++i)
+    {
+      back.nodeVoltages[i] = static_cast<float>(ctx.GetNodeVoltage(static_cast<std::uint32_t>(i)));
+    }
+
+    const auto &sources = ctx.GetComponentsOfType(ComponentType::VoltageSource);
+    back.sourceIds.resize(sources.size());
+    back.sourceCurrents.resize(sources.size());
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+      back.sourceIds[i] = sources[i]->GetId();
+      back.sourceCurrents[i] = static_cast<float>(static_cast<VoltageSource *>(sources[i])->GetCurrent());
+    }
+
+    const auto &components = ctx.GetComponents();
+    back.componentIds.resize(components.size());
+    back.componentPower.resize(components.size());
+    for (std::size_t i = 0; i < components.size(); ++i)
+    {
+      back.componentIds[i] = components[i]->GetId();
+      back.componentPower[i] = static_cast<float>(components[i]->GetPower(ctx));
+    }
+
+    CircuitState &view = back.view;
+    view.sequence = ++g_stateSequence;
+    view.time = ctx.GetTime();
+    view.node_count = static_cast<std::uint32_t>(nodeCount);
+    view.source_count = static_cast<std::uint32_t>(sources.size());
+    view.component_count = static_cast<std::uint32_t>(components.size());
+    view.node_voltages = back.nodeVoltages.data();
+    view.source_ids = back.sourceIds.data();
+    view.source_currents = back.sourceCurrents.data();
+    view.component_ids = back.componentIds.data();
+    view.component_power = back.componentPower.data();
+    g_stateFront = g_stateFront == 0 ? 1 : 0;
+  }
+
   bool LoadHexIntoAvr(AvrComponent *avr, const char *hexText)
   {
     if (!hexText)
@@ -122,6 +190,7 @@ namespace
         NativeEngine::Utils::HexLoader::LoadHexText(avr->m_flash, hexText);
     if (ok)
     {
+      AVR_InvalidateFlash(&avr->m_cpu, 0, avr->m_flash.size());
       avr->m_cpu.pc = 0;
     }
     return ok;
@@ -163,6 +232,7 @@ namespace
     {
       auto count = std::min<std::size_t>(avr->m_flash.size(), text.size);
       std::memcpy(avr->m_flash.data(), text.data, count);
+      AVR_InvalidateFlash(&avr->m_cpu, 0, count);
       avr->m_cpu.pc = 0;
       return true;
     }
@@ -178,12 +248,14 @@ extern "C"
     g_context = std::make_unique<Context>();
     std::memset(&g_sharedState, 0, sizeof(SharedState));
     g_analogDrivers.clear();
+    g_stateFront = -1;
   }
 
   UNITY_EXPORT void Native_DestroyContext()
   {
     g_context.reset();
     g_analogDrivers.clear();
+    g_stateFront = -1;
   }
 
   UNITY_EXPORT void Physics_CreateWorld()
@@ -471,59 +543,91 @@ extern "C"
 
   UNITY_EXPORT int Native_AddComponent(int type, int paramCount, float *params)
   {
-    auto &ctx = GetContext();
-    static std::uint32_t nextId = 1;
-    std::uint32_t id = nextId++;
-
-    std::shared_ptr<Component> comp = nullptr;
+    std::uint32_t id = g_nextComponentId++;
+    auto comp = CreateComponent(static_cast<ComponentType>(type), id, paramCount, params);
+    if (comp)
+    {
+      GetContext().AddComponent(comp);
+      return static_cast<int>(id);
+    }
+    return -1;
+  }
 
-    ComponentType cType = static_cast<ComponentType>(type);
-    if (cType == ComponentType::Resistor)
+  UNITY_EXPORT int Native_LoadNetlist(const uint8_t *buffer, uint32_t size,
+                                      int32_t *nodeIds, uint32_t nodeCapacity,
+                                      int32_t *componentIds, uint32_t componentCapacity)
+  {
+    netlist::NetlistView view{};
+    const char *error = nullptr;
+    if (!netlist::Open(buffer, size, view, &error))
     {
-      double r = (paramCount >= 1) ? params[0] : 1000.0;
-      comp = std::make_shared<Resistor>(id, r);
+      return -1;
     }
-    else if (cType == ComponentType::VoltageSource)
+    const auto &header = *view.header;
+    if ((nodeIds && nodeCapacity < header.node_count) ||
+        (componentIds && componentCapacity < header.component_count))
     {
-      double v = (paramCount >= 1) ? params[0] : 5.0;
-      comp = std::make_shared<VoltageSource>(id, v);
+      return -1;
     }
-    else if (cType == ComponentType::Diode)
+
+    // Create everything up front so an unsupported type leaves the context
+    // untouched.
+    std::vector<std::shared_ptr<Component>> created;
+    created.reserve(header.component_count);
+    for (std::uint32_t i = 0; i < header.component_count; ++i)
     {
-      comp = std::make_shared<Diode>(id);
+      const auto &record = view.components[i];
+      auto comp = CreateComponent(static_cast<ComponentType>(record.type), g_nextComponentId + i,
+                                  record.param_count, view.params + record.param_offset);
+      if (!comp)
+      {
+        return -1;
+      }
+      created.push_back(std::move(comp));
     }
-    else if (cType == ComponentType::IC_Pin) // Using IC_Pin (6) for AVR
+    g_nextComponentId += header.component_count;
+
+    auto &ctx = GetContext();
+    ctx.Reserve(ctx.GetNodeCount() + header.node_count,
+                ctx.GetComponents().size() + header.component_count);
+
+    std::vector<std::uint32_t> nodeMap(static_cast<std::size_t>(header.node_count) + 1, 0u);
+    for (std::uint64_t n = 1; n <= header.node_count; ++n)
     {
-      comp = std::make_shared<AvrComponent>(id);
+      nodeMap[n] = ctx.CreateNode();
+      if (nodeIds)
+      {
+        nodeIds[n - 1] = static_cast<int32_t>(nodeMap[n]);
+      }
     }
 
-    if (comp)
+    for (std::uint32_t i = 0; i < header.connection_count; ++i)
     {
-      ctx.AddComponent(comp);
-      return static_cast<int>(id);
+      const auto &conn = view.connections[i];
+      created[conn.component]->Connect(static_cast<std::uint8_t>(conn.pin), nodeMap[conn.node]);
     }
-    return -1;
-  }
 
-  UNITY_EXPORT void Native_Connect(int compId, int pinIndex, int nodeId)
-  {
-    auto &ctx = GetContext();
-    for (auto &c : ctx.GetComponents())
+    for (std::uint32_t i = 0; i < header.component_count; ++i)
     {
-      if (static_cast<int>(c->GetId()) == compId)
+      if (componentIds)
       {
-        c->Connect(static_cast<std::uint8_t>(pinIndex),
-                   static_cast<std::uint32_t>(nodeId));
-        /* The above code is written in C++ and it appears to be incrementing the `tick` variable in the
-        `g_sharedState` object by 1. */
-        /* The above code is incrementing the `tick` variable in the `g_sharedState` object by 1. */
-        break;
+        componentIds[i] = static_cast<int32_t>(created[i]->GetId());
       }
+      ctx.AddComponent(std::move(created[i]));
     }
+    return static_cast<int>(header.component_count);
+  }
+
+  UNITY_EXPORT void Native_Connect(int compId, int pinIndex, int nodeId)
+  {
+    GetContext().ConnectComponent(static_cast<std::uint32_t>(compId),
+                                  static_cast<std::uint8_t>(pinIndex),
+                                  static_cast<std::uint32_t>(nodeId));
   }
 
   UNITY_EXPORT void Native_Step(float dt)
   {
+    GetContext().m_profileTimings = g_circuitProfiling;
     GetContext().Step(static_cast<double>(dt));
     if (g_physics)
     {
@@ -531,6 +635,10 @@ extern "C"
     }
     UpdateSharedState(GetContext());
     g_sharedState.tick = g_sharedState.tick + 1;
+    if (g_statePublishing)
+    {
+      PublishCircuitState(GetContext());
+    }
   }
 
   UNITY_EXPORT float Native_GetVoltage(int nodeId)
@@ -539,6 +647,75 @@ extern "C"
         GetContext().GetNodeVoltage(static_cast<std::uint32_t>(nodeId)));
   }
 
+  UNITY_EXPORT int Native_GetVoltages(float *out, int count)
+  {
+    if (!out || count <= 0)
+    {
+      return 0;
+    }
+    auto &ctx = GetContext();
+    std::size_t n = std::min<std::size_t>(static_cast<std::size_t>(count), ctx.GetNodeCount());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      out[i] = static_cast<float>(ctx.GetNodeVoltage(static_cast<std::uint32_t>(i)));
+    }
+    return static_cast<int>(n);
+  }
+
+  UNITY_EXPORT void Native_SetStatePublishing(int enabled)
+  {
+    g_statePublishing = enabled != 0;
+    if (g_statePublishing)
+    {
+      PublishCircuitState(GetContext());
+    }
+    else
+    {
+      g_stateFront = -1;
+    }
+  }
+
+  UNITY_EXPORT const CircuitState *Native_GetCircuitState()
+  {
+    if (!g_statePublishing || g_stateFront < 0)
+    {
+      return nullptr;
+    }
+    return &g_stateBuffers[g_stateFront].view;
+  }
+
+  UNITY_EXPORT int Native_GetCircuitStats(CircuitStats *out)
+  {
+    if (!out)
+    {
+      return 0;
+    }
+    const StepStats &stats = GetContext().GetStepStats();
+    *out = CircuitStats{};
+    out->partition_count = stats.partitionCount;
+    out->partitions_solved = stats.partitionsSolved;
+    out->unknowns = stats.unknowns;
+    out->largest_partition = stats.largestPartition;
+    out->nonzeros = stats.nonzeros;
+    out->newton_iterations = stats.newtonIterations;
+    out->factorizations = stats.factorizations;
+    out->factor_reuses = stats.factorReuses;
+    out->iterative_iterations = stats.iterativeIterations;
+    out->pivot_warnings = stats.pivotWarnings;
+    out->nonconverged = stats.nonConverged;
+    out->events = stats.events;
+    out->stamp_ms = stats.stampSeconds * 1000.0;
+    out->solve_ms = stats.solveSeconds * 1000.0;
+    out->component_ms = stats.componentSeconds * 1000.0;
+    out->step_ms = stats.stepSeconds * 1000.0;
+    return 1;
+  }
+
+  UNITY_EXPORT void Native_SetCircuitProfiling(int enabled)
+  {
+    g_circuitProfiling = enabled != 0;
+  }
+
   UNITY_EXPORT int LoadHexFromFile(const char *path)
   {
     auto &ctx = GetContext();
@@ -597,7 +774,10 @@ extern "C"
                : 0;
   }
 
-  UNITY_EXPORT int GetAvrCount() { return static_cast<int>(GetAvrComponents(GetContext()).size()); }
+  UNITY_EXPORT int GetAvrCount()
+  {
+    return static_cast<int>(GetContext().GetComponentsOfType(ComponentType::IC_Pin).size());
+  }
 
   UNITY_EXPORT float GetPinVoltageForAvr(int avrIndex, int pinIndex)
   {
@@ -654,7 +834,20 @@ extern "C"
     if (it->second->m_node != nodeId)
     {
       it->second->Connect(0, nodeId);
+      ctx.InvalidateTopology();
+    }
+    return 1;
+  }
+
+  UNITY_EXPORT int SetPwmAveragingForAvr(int avrIndex, int enabled)
+  {
+    auto *avr = FindAvrByIndex(GetContext(), avrIndex);
+    if (!avr)
+    {
+      return 0;
     }
+    avr->m_pwmAveraging = enabled != 0;
+    avr->MarkDirty(); // Restamp pins with the new driver model
     return 1;
   }
 
@@ -30,12 +30,77 @@ namespace RobotTwin.Core
         [DllImport(PLUGIN_NAME, EntryPoint = "Native_Connect")]
         public static extern void Native_Connect(int compId, int pinIndex, int nodeId);
 
+        // Bulk build from a binary netlist (NativeEngine/include/Circuit/NetlistFormat.hpp).
+        // Returns the component count or -1; id arrays may be null.
+        [DllImport(PLUGIN_NAME, EntryPoint = "Native_LoadNetlist")]
+        public static extern int Native_LoadNetlist([In] byte[] buffer, uint size,
+            [Out] int[] nodeIds, uint nodeCapacity, [Out] int[] componentIds, uint componentCapacity);
+
         [DllImport(PLUGIN_NAME, EntryPoint = "Native_Step")]
         public static extern void Native_Step(float dt);
 
         [DllImport(PLUGIN_NAME, EntryPoint = "Native_GetVoltage")]
         public static extern float Native_GetVoltage(int nodeId);
 
+        // Fills out[i] with the voltage of node i; returns the count written.
+        [DllImport(PLUGIN_NAME, EntryPoint = "Native_GetVoltages")]
+        public static extern int Native_GetVoltages([Out] float[] voltages, int count);
+
+        // Mirrors CircuitState in UnityInterface.h. Arrays are native memory,
+        // valid until the second Native_Step after Native_GetCircuitState.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct CircuitState
+        {
+            public ulong sequence;
+            public double time;
+            public uint node_count;
+            public uint source_count;
+            public uint component_count;
+            public uint reserved;
+            public IntPtr node_voltages;   // float[node_count]
+            public IntPtr source_ids;      // uint[source_count]
+            public IntPtr source_currents; // float[source_count]
+            public IntPtr component_ids;   // uint[component_count]
+            public IntPtr component_power; // float[component_count]
+        }
+
+        [DllImport(PLUGIN_NAME, EntryPoint = "Native_SetStatePublishing")]
+        public static extern void Native_SetStatePublishing(int enabled);
+
+        // Returns IntPtr.Zero while publishing is disabled.
+        [DllImport(PLUGIN_NAME, EntryPoint = "Native_GetCircuitState")]
+        public static extern IntPtr Native_GetCircuitState();
+
+        // Mirrors CircuitStats in UnityInterface.h: work done by the last Native_Step.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct CircuitStats
+        {
+            public uint partition_count;
+            public uint partitions_solved;
+            public uint unknowns;
+            public uint largest_partition;
+            public ulong nonzeros;
+            public uint newton_iterations;
+            public uint factorizations;
+            public uint factor_reuses;
+            public uint iterative_iterations;
+            public uint pivot_warnings;
+            public uint nonconverged;
+            public uint events;
+            public uint reserved;
+            public double stamp_ms;
+            public double solve_ms;
+            public double component_ms;
+            public double step_ms;
+        }
+
+        [DllImport(PLUGIN_NAME, EntryPoint = "Native_GetCircuitStats")]
+        public static extern int Native_GetCircuitStats(out CircuitStats stats);
+
+        // Times in CircuitStats stay 0 unless profiling is enabled.
+        [DllImport(PLUGIN_NAME, EntryPoint = "Native_SetCircuitProfiling")]
+        public static extern void Native_SetCircuitProfiling(int enabled);
+
         [DllImport(PLUGIN_NAME, EntryPoint = "LoadHexFromFile")]
         public static extern int LoadHexFromFile(string path);
 
@@ -183,6 +248,9 @@ namespace RobotTwin.Core
         [DllImport(PLUGIN_NAME, EntryPoint = "SetAnalogVoltageForAvr")]
         public static extern int SetAnalogVoltageForAvr(int avrIndex, int pinIndex, float voltage);
 
+        [DllImport(PLUGIN_NAME, EntryPoint = "SetPwmAveragingForAvr")]
+        public static extern int SetPwmAveragingForAvr(int avrIndex, int enabled);
+
         // Legacy Wrapper
         public static int GetVersion() => GetEngineVersion();
         public static void StepSimulation(float dt) => Native_Step(dt); // Wrapper for old StepSimulation
@@ -251,7 +319,10 @@ namespace RobotTwin.Core
             Diode = 3,
             LED = 4,
             Switch = 5,
-            IC_Pin = 6
+            IC_Pin = 6,
+            AnalogDriver = 7,
+            Capacitor = 8, // params[0] = farads
+            Inductor = 9   // params[0] = henries
         }
     }
 }
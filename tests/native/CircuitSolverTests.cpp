@@ -0,0 +1,1767 @@
+// Circuit Solver Test Suite
+// Tests for MNA partitioning, Newton convergence and solve scheduling, and
+// for the AVR core that drives the circuit (decode cache, block execution,
+// interrupts, flags, sleep, I/O hooks and runtime HLE)
+
+#include "Bridge/UnityInterface.h"
+#include "Circuit/AvrComponent.h"
+#include "Circuit/BasicComponents.h"
+#include "Circuit/BatchedContext.h"
+#include "Circuit/CircuitContext.h"
+#include "Circuit/Diode.h"
+#include "Circuit/HexLoader.h"
+#include "Circuit/MnaKernels.h"
+#include "Circuit/NetlistFormat.hpp"
+#include "Circuit/ReactiveComponents.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace NativeEngine::Circuit::Tests
+{
+
+    constexpr double kEpsilon = 1e-6;
+
+    bool NearEqual(double a, double b, double epsilon = kEpsilon)
+    {
+        return std::fabs(a - b) < epsilon;
+    }
+
+#define CHECK(cond)                                                        \
+    do                                                                     \
+    {                                                                      \
+        if (!(cond))                                                       \
+        {                                                                  \
+            std::cout << "  check failed: " #cond " (line " << __LINE__ << ")\n"; \
+            return false;                                                  \
+        }                                                                  \
+    } while (0)
+
+    std::uint32_t g_nextId = 1;
+
+    // Builds Vs -> R1 -> out -> R2 -> GND and returns the source.
+    std::shared_ptr<VoltageSource> AddDivider(Context &ctx, double volts, double r1, double r2,
+                                              std::uint32_t &outNode)
+    {
+        std::uint32_t top = ctx.CreateNode();
+        outNode = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, volts);
+        auto ra = std::make_shared<Resistor>(g_nextId++, r1);
+        auto rb = std::make_shared<Resistor>(g_nextId++, r2);
+        ctx.AddComponent(vs);
+        ctx.AddComponent(ra);
+        ctx.AddComponent(rb);
+        ctx.ConnectComponent(vs->GetId(), 0, top);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+        ctx.ConnectComponent(ra->GetId(), 0, top);
+        ctx.ConnectComponent(ra->GetId(), 1, outNode);
+        ctx.ConnectComponent(rb->GetId(), 0, outNode);
+        ctx.ConnectComponent(rb->GetId(), 1, 0);
+        return vs;
+    }
+
+    // Builds a chain of `length` resistors from a driven node down to ground.
+    std::uint32_t AddLadder(Context &ctx, double volts, int length)
+    {
+        std::uint32_t first = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, volts);
+        ctx.AddComponent(vs);
+        ctx.ConnectComponent(vs->GetId(), 0, first);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+        std::uint32_t prev = first;
+        for (int i = 0; i < length; ++i)
+        {
+            std::uint32_t next = (i + 1 < length) ? ctx.CreateNode() : 0;
+            auto r = std::make_shared<Resistor>(g_nextId++, 100.0);
+            ctx.AddComponent(r);
+            ctx.ConnectComponent(r->GetId(), 0, prev);
+            ctx.ConnectComponent(r->GetId(), 1, next);
+            prev = next;
+        }
+        return first + 1;
+    }
+
+    // Writes AVR instruction words to the start of flash, low byte first.
+    void LoadProgram(std::vector<std::uint8_t> &flash, const std::uint16_t *program, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            flash[2 * i] = static_cast<std::uint8_t>(program[i] & 0xFF);
+            flash[2 * i + 1] = static_cast<std::uint8_t>(program[i] >> 8);
+        }
+    }
+
+    // Test 1: Disconnected islands are split and solved independently
+    bool Test_IndependentPartitions()
+    {
+        Context ctx;
+        std::uint32_t outA = 0;
+        std::uint32_t outB = 0;
+        AddDivider(ctx, 5.0, 1000.0, 1000.0, outA);
+        AddDivider(ctx, 3.3, 2000.0, 1000.0, outB);
+        ctx.Step(0.001);
+
+        CHECK(ctx.GetPartitions().size() == 2);
+        CHECK(NearEqual(ctx.GetNodeVoltage(outA), 2.5));
+        CHECK(NearEqual(ctx.GetNodeVoltage(outB), 1.1));
+
+        std::cout << "[PASS] Test_IndependentPartitions\n";
+        return true;
+    }
+
+    // Test 2: Partitions without dirty stamps are not re-solved
+    bool Test_CleanPartitionsSkipped()
+    {
+        Context ctx;
+        std::uint32_t outA = 0;
+        std::uint32_t outB = 0;
+        auto vsA = AddDivider(ctx, 5.0, 1000.0, 1000.0, outA);
+        AddDivider(ctx, 5.0, 1000.0, 1000.0, outB);
+        ctx.Step(0.001);
+        ctx.Step(0.001);
+        CHECK(ctx.GetPartitions()[0].solveCount == 1);
+        CHECK(ctx.GetPartitions()[1].solveCount == 1);
+
+        vsA->SetVoltage(10.0);
+        ctx.Step(0.001);
+        CHECK(ctx.GetPartitions()[0].solveCount == 2);
+        CHECK(ctx.GetPartitions()[1].solveCount == 1);
+        CHECK(NearEqual(ctx.GetNodeVoltage(outA), 5.0));
+        CHECK(NearEqual(ctx.GetNodeVoltage(outB), 2.5));
+
+        std::cout << "[PASS] Test_CleanPartitionsSkipped\n";
+        return true;
+    }
+
+    // Test 3: Pool-solved partitions match the serial result
+    bool Test_ParallelMatchesSerial()
+    {
+        const int islands = 8;
+        const int length = 80;
+        std::vector<std::uint32_t> probes;
+
+        Context serial;
+        serial.m_solverThreads = 1;
+        Context parallel;
+        parallel.m_solverThreads = 4;
+        parallel.m_parallelMinUnknowns = 16;
+        for (int i = 0; i < islands; ++i)
+        {
+            probes.push_back(AddLadder(serial, 1.0 + i, length));
+            AddLadder(parallel, 1.0 + i, length);
+        }
+        serial.Step(0.001);
+        parallel.Step(0.001);
+
+        CHECK(parallel.GetPartitions().size() == static_cast<std::size_t>(islands));
+        for (std::size_t n = 0; n < serial.GetNodeCount(); ++n)
+        {
+            auto id = static_cast<std::uint32_t>(n);
+            CHECK(NearEqual(serial.GetNodeVoltage(id), parallel.GetNodeVoltage(id), 1e-9));
+        }
+        // First ladder node sits one resistor below the source.
+        CHECK(NearEqual(serial.GetNodeVoltage(probes[0]), 1.0 * (length - 1) / length));
+
+        std::cout << "[PASS] Test_ParallelMatchesSerial\n";
+        return true;
+    }
+
+    // Test 4: Newton iteration converges for a resistor + diode
+    bool Test_DiodeConverges()
+    {
+        Context ctx;
+        std::uint32_t supply = ctx.CreateNode();
+        std::uint32_t anode = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+        auto r = std::make_shared<Resistor>(g_nextId++, 220.0);
+        auto d = std::make_shared<Diode>(g_nextId++);
+        ctx.AddComponent(vs);
+        ctx.AddComponent(r);
+        ctx.AddComponent(d);
+        ctx.ConnectComponent(vs->GetId(), 0, supply);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+        ctx.ConnectComponent(r->GetId(), 0, supply);
+        ctx.ConnectComponent(r->GetId(), 1, anode);
+        ctx.ConnectComponent(d->GetId(), 0, anode);
+        ctx.ConnectComponent(d->GetId(), 1, 0);
+        // Without junction limiting Newton walks down from the linear
+        // extension one thermal voltage per iteration; allow a few steps.
+        for (int i = 0; i < 5; ++i)
+        {
+            ctx.Step(0.001);
+        }
+
+        CHECK(ctx.GetPartitions().size() == 1);
+        CHECK(ctx.GetPartitions()[0].converged);
+        double vd = ctx.GetNodeVoltage(anode);
+        CHECK(vd > 0.5 && vd < 0.8);
+        double iR = (5.0 - vd) / 220.0;
+        double iD = d->GetIs() * (std::exp(vd / (d->GetN() * d->GetVt())) - 1.0);
+        CHECK(std::fabs(iR - iD) < 1e-6);
+
+        // A parameter change after the partition was built takes effect
+        d->SetIs(1e-9);
+        for (int i = 0; i < 5; ++i)
+        {
+            ctx.Step(0.001);
+        }
+        double vd2 = ctx.GetNodeVoltage(anode);
+        CHECK(vd2 < vd - 0.1);
+        iR = (5.0 - vd2) / 220.0;
+        iD = d->GetIs() * (std::exp(vd2 / (d->GetN() * d->GetVt())) - 1.0);
+        CHECK(std::fabs(iR - iD) < 1e-6);
+
+        std::cout << "[PASS] Test_DiodeConverges\n";
+        return true;
+    }
+
+    // Test 5: An idle AVR does not force a re-solve every step
+    bool Test_AvrPortWritesDriveResolve()
+    {
+        Context ctx;
+        std::uint32_t pin13 = ctx.CreateNode();
+        auto avr = std::make_shared<AvrComponent>(g_nextId++);
+        auto r = std::make_shared<Resistor>(g_nextId++, 1000.0);
+        ctx.AddComponent(avr);
+        ctx.AddComponent(r);
+        ctx.ConnectComponent(avr->GetId(), 13, pin13);
+        ctx.ConnectComponent(r->GetId(), 0, pin13);
+        ctx.ConnectComponent(r->GetId(), 1, 0);
+
+        // sbi DDRB,5 ; sbi PORTB,5 ; rjmp .-2
+        CHECK(NativeEngine::Utils::HexLoader::LoadHexText(
+            avr->m_flash, ":06000000259A2D9AFFCFA6\n:00000001FF\n"));
+
+        ctx.Step(0.001); // Initial solve, then the firmware raises pin 13
+        ctx.Step(0.001); // Port write picked up
+        const std::uint64_t solves = ctx.GetPartitions()[0].solveCount;
+        CHECK(ctx.GetNodeVoltage(pin13) > 4.8);
+
+        for (int i = 0; i < 10; ++i)
+        {
+            ctx.Step(0.001);
+        }
+        CHECK(ctx.GetPartitions()[0].solveCount == solves);
+        CHECK(ctx.GetNodeVoltage(pin13) > 4.8);
+
+        std::cout << "[PASS] Test_AvrPortWritesDriveResolve\n";
+        return true;
+    }
+
+    // Test 6: Inputs are re-sampled at the port write that drives them
+    bool Test_AvrInputSeesOutputWithinStep()
+    {
+        Context ctx;
+        std::uint32_t pin13 = ctx.CreateNode();
+        std::uint32_t pin12 = ctx.CreateNode();
+        auto avr = std::make_shared<AvrComponent>(g_nextId++);
+        auto r = std::make_shared<Resistor>(g_nextId++, 1000.0);
+        ctx.AddComponent(avr);
+        ctx.AddComponent(r);
+        ctx.ConnectComponent(avr->GetId(), 13, pin13);
+        ctx.ConnectComponent(avr->GetId(), 12, pin12);
+        ctx.ConnectComponent(r->GetId(), 0, pin13);
+        ctx.ConnectComponent(r->GetId(), 1, pin12);
+
+        // sbi DDRB,5 ; sbi PORTB,5 ; in r16,PINB ; rjmp .-2
+        CHECK(NativeEngine::Utils::HexLoader::LoadHexText(
+            avr->m_flash, ":08000000259A2D9A03B1FFCFF0\n:00000001FF\n"));
+
+        // A single step: the PINB read happens a few cycles after the
+        // write, so it only sees pin 12 high if the circuit re-solved there.
+        ctx.Step(0.001);
+        CHECK(ctx.GetPartitions()[0].eventCount == 2);
+        CHECK(avr->m_regs[16] & (1 << 4));
+
+        // Without interleaving the read sees the inputs frozen at step start.
+        Context frozen;
+        frozen.m_interleaveEvents = false;
+        std::uint32_t f13 = frozen.CreateNode();
+        std::uint32_t f12 = frozen.CreateNode();
+        auto avr2 = std::make_shared<AvrComponent>(g_nextId++);
+        auto r2 = std::make_shared<Resistor>(g_nextId++, 1000.0);
+        frozen.AddComponent(avr2);
+        frozen.AddComponent(r2);
+        frozen.ConnectComponent(avr2->GetId(), 13, f13);
+        frozen.ConnectComponent(avr2->GetId(), 12, f12);
+        frozen.ConnectComponent(r2->GetId(), 0, f13);
+        frozen.ConnectComponent(r2->GetId(), 1, f12);
+        CHECK(NativeEngine::Utils::HexLoader::LoadHexText(
+            avr2->m_flash, ":08000000259A2D9A03B1FFCFF0\n:00000001FF\n"));
+        frozen.Step(0.001);
+        CHECK((avr2->m_regs[16] & (1 << 4)) == 0);
+
+        std::cout << "[PASS] Test_AvrInputSeesOutputWithinStep\n";
+        return true;
+    }
+
+    // Test 7: RC charge follows the analytic curve, then settles
+    bool Test_RcChargeAndSettle()
+    {
+        Context ctx;
+        std::uint32_t supply = ctx.CreateNode();
+        std::uint32_t cap = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+        auto r = std::make_shared<Resistor>(g_nextId++, 1000.0);
+        auto c = std::make_shared<Capacitor>(g_nextId++, 1e-6); // tau = 1 ms
+        ctx.AddComponent(vs);
+        ctx.AddComponent(r);
+        ctx.AddComponent(c);
+        ctx.ConnectComponent(vs->GetId(), 0, supply);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+        ctx.ConnectComponent(r->GetId(), 0, supply);
+        ctx.ConnectComponent(r->GetId(), 1, cap);
+        ctx.ConnectComponent(c->GetId(), 0, cap);
+        ctx.ConnectComponent(c->GetId(), 1, 0);
+
+        // Two coarse steps across the edge: accuracy comes from substeps.
+        ctx.Step(0.001);
+        CHECK(NearEqual(ctx.GetNodeVoltage(cap), 5.0 * (1.0 - std::exp(-1.0)), 0.02));
+        ctx.Step(0.001);
+        CHECK(NearEqual(ctx.GetNodeVoltage(cap), 5.0 * (1.0 - std::exp(-2.0)), 0.02));
+        CHECK(ctx.GetPartitions()[0].acceptedSteps > 2);
+
+        for (int i = 0; i < 100; ++i)
+        {
+            ctx.Step(0.001);
+        }
+        CHECK(NearEqual(ctx.GetNodeVoltage(cap), 5.0, 1e-3));
+        CHECK(ctx.GetPartitions()[0].settled);
+        const std::uint64_t solves = ctx.GetPartitions()[0].solveCount;
+        ctx.Step(0.001);
+        CHECK(ctx.GetPartitions()[0].solveCount == solves);
+
+        // A supply change wakes the partition up again.
+        vs->SetVoltage(0.0);
+        ctx.Step(0.001);
+        CHECK(NearEqual(ctx.GetNodeVoltage(cap), 5.0 * std::exp(-1.0), 0.02));
+
+        std::cout << "[PASS] Test_RcChargeAndSettle\n";
+        return true;
+    }
+
+    // Test 8: RL current rise
+    bool Test_RlCurrentRise()
+    {
+        Context ctx;
+        std::uint32_t supply = ctx.CreateNode();
+        std::uint32_t coil = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, 1.0);
+        auto r = std::make_shared<Resistor>(g_nextId++, 10.0);
+        auto l = std::make_shared<Inductor>(g_nextId++, 0.01); // tau = 1 ms
+        ctx.AddComponent(vs);
+        ctx.AddComponent(r);
+        ctx.AddComponent(l);
+        ctx.ConnectComponent(vs->GetId(), 0, supply);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+        ctx.ConnectComponent(r->GetId(), 0, supply);
+        ctx.ConnectComponent(r->GetId(), 1, coil);
+        ctx.ConnectComponent(l->GetId(), 0, coil);
+        ctx.ConnectComponent(l->GetId(), 1, 0);
+
+        ctx.Step(0.001);
+        CHECK(NearEqual(l->GetCurrent(), 0.1 * (1.0 - std::exp(-1.0)), 0.0005));
+        CHECK(NearEqual(ctx.GetNodeVoltage(coil), std::exp(-1.0), 0.01));
+
+        std::cout << "[PASS] Test_RlCurrentRise\n";
+        return true;
+    }
+
+    // Test 9: Batched diode stamps satisfy KCL on every branch of an array
+    bool Test_DiodeArrayBatch()
+    {
+        Context ctx;
+        std::uint32_t supply = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+        ctx.AddComponent(vs);
+        ctx.ConnectComponent(vs->GetId(), 0, supply);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+
+        const int branches = 64;
+        std::vector<std::uint32_t> anodes;
+        std::vector<double> resistances;
+        std::vector<std::shared_ptr<Diode>> diodes;
+        for (int i = 0; i < branches; ++i)
+        {
+            std::uint32_t anode = ctx.CreateNode();
+            double ohms = 100.0 + 10.0 * i;
+            auto r = std::make_shared<Resistor>(g_nextId++, ohms);
+            auto d = std::make_shared<Diode>(g_nextId++);
+            ctx.AddComponent(r);
+            ctx.AddComponent(d);
+            ctx.ConnectComponent(r->GetId(), 0, supply);
+            ctx.ConnectComponent(r->GetId(), 1, anode);
+            ctx.ConnectComponent(d->GetId(), 0, anode);
+            ctx.ConnectComponent(d->GetId(), 1, 0);
+            anodes.push_back(anode);
+            resistances.push_back(ohms);
+            diodes.push_back(d);
+        }
+        CHECK(!ctx.ConnectComponent(g_nextId + 1000, 0, supply));
+        CHECK(ctx.GetComponentsOfType(ComponentType::Diode).size() ==
+              static_cast<std::size_t>(branches));
+        CHECK(ctx.GetComponentsOfType(ComponentType::Diode).front() == diodes.front().get());
+
+        for (int i = 0; i < 5; ++i)
+        {
+            ctx.Step(0.001);
+        }
+        CHECK(ctx.GetPartitions()[0].converged);
+        for (int i = 0; i < branches; ++i)
+        {
+            double vd = ctx.GetNodeVoltage(anodes[i]);
+            double iR = (5.0 - vd) / resistances[i];
+            double iD = diodes[i]->GetIs() * (std::exp(vd / (diodes[i]->GetN() * diodes[i]->GetVt())) - 1.0);
+            CHECK(std::fabs(iR - iD) < 1e-6);
+        }
+
+        std::cout << "[PASS] Test_DiodeArrayBatch\n";
+        return true;
+    }
+
+    // Serializes a netlist; stored as words so the buffer is 4-byte aligned.
+    std::vector<std::uint32_t> PackNetlist(std::uint32_t nodeCount,
+                                           const std::vector<netlist::NetlistComponent> &components,
+                                           const std::vector<netlist::NetlistConnection> &connections,
+                                           const std::vector<float> &params)
+    {
+        netlist::NetlistHeader header{netlist::kMagic, netlist::kVersionMajor, netlist::kVersionMinor,
+                                      nodeCount,
+                                      static_cast<std::uint32_t>(components.size()),
+                                      static_cast<std::uint32_t>(connections.size()),
+                                      static_cast<std::uint32_t>(params.size())};
+        std::size_t bytes = sizeof(header) + components.size() * sizeof(components[0]) +
+                            connections.size() * sizeof(connections[0]) + params.size() * sizeof(float);
+        std::vector<std::uint32_t> words(bytes / 4);
+        auto *out = reinterpret_cast<std::uint8_t *>(words.data());
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        std::memcpy(out, components.data(), components.size() * sizeof(components[0]));
+        out += components.size() * sizeof(components[0]);
+        std::memcpy(out, connections.data(), connections.size() * sizeof(connections[0]));
+        out += connections.size() * sizeof(connections[0]);
+        std::memcpy(out, params.data(), params.size() * sizeof(float));
+        return words;
+    }
+
+    // Test 10: Bulk netlist load builds a working circuit and reports ids
+    bool Test_LoadNetlist()
+    {
+        const auto vs = static_cast<std::uint16_t>(ComponentType::VoltageSource);
+        const auto res = static_cast<std::uint16_t>(ComponentType::Resistor);
+        // Node 1 = supply, node 2 = divider output
+        std::vector<netlist::NetlistComponent> components = {{vs, 1, 0}, {res, 1, 1}, {res, 1, 2}};
+        std::vector<netlist::NetlistConnection> connections = {
+            {0, 0, 0, 1}, {0, 1, 0, 0}, {1, 0, 0, 1}, {1, 1, 0, 2}, {2, 0, 0, 2}, {2, 1, 0, 0}};
+        std::vector<float> params = {5.0f, 1000.0f, 3000.0f};
+        auto buffer = PackNetlist(2, components, connections, params);
+
+        Native_CreateContext();
+        std::int32_t nodeIds[2] = {};
+        std::int32_t componentIds[3] = {};
+        int loaded = Native_LoadNetlist(reinterpret_cast<const std::uint8_t *>(buffer.data()),
+                                        static_cast<std::uint32_t>(buffer.size() * 4),
+                                        nodeIds, 2, componentIds, 3);
+        CHECK(loaded == 3);
+        CHECK(componentIds[0] != componentIds[1] && componentIds[1] != componentIds[2]);
+        Native_Step(0.001f);
+        CHECK(NearEqual(Native_GetVoltage(nodeIds[0]), 5.0, 1e-5));
+        CHECK(NearEqual(Native_GetVoltage(nodeIds[1]), 3.75, 1e-5));
+
+        // A bad node reference is rejected before anything is created.
+        connections[3].node = 7;
+        auto bad = PackNetlist(2, components, connections, params);
+        int nextNode = Native_AddNode() + 1;
+        CHECK(Native_LoadNetlist(reinterpret_cast<const std::uint8_t *>(bad.data()),
+                                 static_cast<std::uint32_t>(bad.size() * 4),
+                                 nullptr, 0, nullptr, 0) == -1);
+        CHECK(Native_AddNode() == nextNode);
+
+        // So is a node count no connection table could use: it would
+        // otherwise size the node map from the header alone.
+        connections[3].node = 2;
+        for (std::uint32_t nodeCount : {0xFFFFFFFFu, 0x80000000u, 7u})
+        {
+            auto huge = PackNetlist(nodeCount, components, connections, params);
+            CHECK(Native_LoadNetlist(reinterpret_cast<const std::uint8_t *>(huge.data()),
+                                     static_cast<std::uint32_t>(huge.size() * 4),
+                                     nullptr, 0, nullptr, 0) == -1);
+        }
+        CHECK(Native_AddNode() == nextNode + 1);
+        Native_DestroyContext();
+
+        std::cout << "[PASS] Test_LoadNetlist\n";
+        return true;
+    }
+
+    // Test 11: Bulk readback and the published state block
+    bool Test_CircuitStateReadback()
+    {
+        Native_CreateContext();
+        int top = Native_AddNode();
+        int out = Native_AddNode();
+        float volts[] = {5.0f};
+        float r1[] = {1000.0f};
+        float r2[] = {3000.0f};
+        int vs = Native_AddComponent(static_cast<int>(ComponentType::VoltageSource), 1, volts);
+        int ra = Native_AddComponent(static_cast<int>(ComponentType::Resistor), 1, r1);
+        int rb = Native_AddComponent(static_cast<int>(ComponentType::Resistor), 1, r2);
+        Native_Connect(vs, 0, top);
+        Native_Connect(vs, 1, 0);
+        Native_Connect(ra, 0, top);
+        Native_Connect(ra, 1, out);
+        Native_Connect(rb, 0, out);
+        Native_Connect(rb, 1, 0);
+
+        CHECK(Native_GetCircuitState() == nullptr);
+        Native_SetStatePublishing(1);
+        Native_Step(0.001f);
+
+        float voltages[8] = {};
+        CHECK(Native_GetVoltages(voltages, 8) == 3);
+        CHECK(NearEqual(voltages[out], 3.75, 1e-5));
+
+        const CircuitState *state = Native_GetCircuitState();
+        CHECK(state != nullptr);
+        CHECK(state->node_count == 3);
+        CHECK(NearEqual(state->node_voltages[top], 5.0, 1e-5));
+        CHECK(state->source_count == 1);
+        CHECK(static_cast<int>(state->source_ids[0]) == vs);
+        CHECK(NearEqual(state->source_currents[0], 1.25e-3, 1e-8));
+        CHECK(state->component_count == 3);
+        double delivered = 0.0;
+        double absorbed = 0.0;
+        for (std::uint32_t i = 0; i < state->component_count; ++i)
+        {
+            if (state->component_power[i] < 0)
+                delivered -= state->component_power[i];
+            else
+                absorbed += state->component_power[i];
+        }
+        CHECK(NearEqual(delivered, 6.25e-3, 1e-7));
+        CHECK(NearEqual(absorbed, delivered, 1e-7));
+
+        // The block read above stays intact across the next publish.
+        const std::uint64_t sequence = state->sequence;
+        Native_Step(0.001f);
+        CHECK(state->sequence == sequence);
+        CHECK(Native_GetCircuitState() != state);
+        CHECK(Native_GetCircuitState()->sequence == sequence + 1);
+
+        Native_SetStatePublishing(0);
+        CHECK(Native_GetCircuitState() == nullptr);
+        Native_DestroyContext();
+
+        std::cout << "[PASS] Test_CircuitStateReadback\n";
+        return true;
+    }
+
+    // Test 12: Lane-batched sweep matches per-lane analytic and Context results
+    bool Test_BatchedSweep()
+    {
+        const std::size_t lanes = 1001; // Not a multiple of the SIMD width
+        BatchedContext batch(lanes);
+        std::uint32_t top = batch.CreateNode();
+        std::uint32_t mid = batch.CreateNode();
+        std::uint32_t anode = batch.CreateNode();
+        batch.AddVoltageSource(top, 0, 5.0);
+        std::size_t r1 = batch.AddResistor(top, mid, 1000.0);
+        batch.AddResistor(mid, 0, 1000.0);
+        std::size_t r3 = batch.AddResistor(mid, anode, 220.0);
+        batch.AddDiode(anode, 0);
+
+        std::vector<double> ohms(lanes);
+        for (std::size_t l = 0; l < lanes; ++l)
+        {
+            ohms[l] = 900.0 + 0.2 * static_cast<double>(l); // +-10% sweep
+        }
+        batch.SetParameters(r1, ohms.data());
+        batch.SetParameter(r3, 7, 470.0);
+        // Same Newton walk-down as Test_DiodeConverges; each Solve warm
+        // starts from the previous one.
+        std::size_t converged = 0;
+        for (int i = 0; i < 5 && converged < lanes; ++i)
+        {
+            converged = batch.Solve();
+        }
+        CHECK(converged == lanes);
+
+        // Reference lane 7 with the scalar solver.
+        Context ctx;
+        std::uint32_t cTop = ctx.CreateNode();
+        std::uint32_t cMid = ctx.CreateNode();
+        std::uint32_t cAnode = ctx.CreateNode();
+        auto vs = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+        auto ra = std::make_shared<Resistor>(g_nextId++, ohms[7]);
+        auto rb = std::make_shared<Resistor>(g_nextId++, 1000.0);
+        auto rc = std::make_shared<Resistor>(g_nextId++, 470.0);
+        auto d = std::make_shared<Diode>(g_nextId++);
+        for (auto comp : std::vector<std::shared_ptr<Component>>{vs, ra, rb, rc, d})
+        {
+            ctx.AddComponent(comp);
+        }
+        ctx.ConnectComponent(vs->GetId(), 0, cTop);
+        ctx.ConnectComponent(vs->GetId(), 1, 0);
+        ctx.ConnectComponent(ra->GetId(), 0, cTop);
+        ctx.ConnectComponent(ra->GetId(), 1, cMid);
+        ctx.ConnectComponent(rb->GetId(), 0, cMid);
+        ctx.ConnectComponent(rb->GetId(), 1, 0);
+        ctx.ConnectComponent(rc->GetId(), 0, cMid);
+        ctx.ConnectComponent(rc->GetId(), 1, cAnode);
+        ctx.ConnectComponent(d->GetId(), 0, cAnode);
+        ctx.ConnectComponent(d->GetId(), 1, 0);
+        for (int i = 0; i < 5; ++i)
+        {
+            ctx.Step(0.001);
+        }
+        CHECK(NearEqual(batch.GetNodeVoltage(mid, 7), ctx.GetNodeVoltage(cMid), 1e-5));
+        CHECK(NearEqual(batch.GetNodeVoltage(anode, 7), ctx.GetNodeVoltage(cAnode), 1e-5));
+
+        // KCL at the divider tap holds in every lane.
+        std::vector<double> volts(4 * lanes);
+        batch.GetVoltages(volts.data());
+        for (std::size_t l = 0; l < lanes; ++l)
+        {
+            double vMid = volts[mid * lanes + l];
+            double vAnode = volts[anode * lanes + l];
+            double r3Ohms = (l == 7) ? 470.0 : 220.0;
+            double residual = (5.0 - vMid) / ohms[l] - vMid / 1000.0 - (vMid - vAnode) / r3Ohms;
+            CHECK(std::fabs(residual) < 1e-8);
+            CHECK(batch.IsLaneValid(l));
+        }
+
+        std::cout << "[PASS] Test_BatchedSweep\n";
+        return true;
+    }
+
+    // Test 13: Fixed-size kernels agree with the dense solver and are auto-selected
+    bool Test_FixedKernelsMatchDense()
+    {
+        // Every kernel size against the general solver, on systems that
+        // need row swaps (zero leading diagonal) like voltage source rows.
+        std::uint32_t seed = 12345;
+        auto next = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<double>(seed >> 8) / 16777216.0 - 0.5;
+        };
+        for (std::size_t n = 1; n <= kMaxFixedKernelSize; ++n)
+        {
+            std::vector<double> a(n * n);
+            std::vector<double> b(n);
+            for (std::size_t i = 0; i < n * n; ++i)
+            {
+                a[i] = next();
+            }
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                a[i * n + i] += (i == 0 && n > 1) ? -a[0] : 2.0;
+                b[i] = next();
+            }
+            std::vector<double> fixedX(n, 0.0);
+            FixedSizeSolver kernel = GetFixedSizeSolver(n);
+            CHECK(kernel != nullptr);
+            kernel(a.data(), b.data(), fixedX.data());
+
+            std::vector<double> denseX(n, 0.0);
+            SolveLinearSystem(a, b, denseX, n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                CHECK(NearEqual(fixedX[i], denseX[i], 1e-9));
+            }
+        }
+        CHECK(GetFixedSizeSolver(0) == nullptr);
+        CHECK(GetFixedSizeSolver(kMaxFixedKernelSize + 1) == nullptr);
+
+        // The context picks the kernel for small partitions only, and the
+        // answer does not depend on which path solved it.
+        Context ctx;
+        std::uint32_t out = 0;
+        AddDivider(ctx, 5.0, 1000.0, 1000.0, out);
+        std::uint32_t ladderTap = AddLadder(ctx, 5.0, 40);
+        ctx.Step(0.001);
+        int fixed = 0;
+        for (const auto &partition : ctx.GetPartitions())
+        {
+            bool small = partition.matrixSize <= kMaxFixedKernelSize;
+            CHECK((partition.luKernel != &kDenseLuKernel) == small);
+            fixed += small ? 1 : 0;
+        }
+        CHECK(fixed == 1);
+        CHECK(NearEqual(ctx.GetNodeVoltage(out), 2.5));
+
+        Context dense;
+        dense.m_fixedKernelMaxUnknowns = 0;
+        std::uint32_t denseOut = 0;
+        AddDivider(dense, 5.0, 1000.0, 1000.0, denseOut);
+        dense.Step(0.001);
+        CHECK(dense.GetPartitions()[0].luKernel == &kDenseLuKernel);
+        CHECK(NearEqual(dense.GetNodeVoltage(denseOut), ctx.GetNodeVoltage(out), 1e-12));
+        CHECK(NearEqual(ctx.GetNodeVoltage(ladderTap), 5.0 * 39.0 / 40.0));
+
+        std::cout << "[PASS] Test_FixedKernelsMatchDense\n";
+        return true;
+    }
+
+    // Test 14: Quiet diodes reuse their linearization and the LU factors
+    bool Test_DeviceBypass()
+    {
+        auto build = [](Context &ctx, std::vector<std::uint32_t> &anodes)
+        {
+            std::uint32_t supply = ctx.CreateNode();
+            auto vs = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+            ctx.AddComponent(vs);
+            ctx.ConnectComponent(vs->GetId(), 0, supply);
+            ctx.ConnectComponent(vs->GetId(), 1, 0);
+            for (int i = 0; i < 32; ++i)
+            {
+                std::uint32_t anode = ctx.CreateNode();
+                auto r = std::make_shared<Resistor>(g_nextId++, 150.0 + 5.0 * i);
+                auto d = std::make_shared<Diode>(g_nextId++);
+                ctx.AddComponent(r);
+                ctx.AddComponent(d);
+                ctx.ConnectComponent(r->GetId(), 0, supply);
+                ctx.ConnectComponent(r->GetId(), 1, anode);
+                ctx.ConnectComponent(d->GetId(), 0, anode);
+                ctx.ConnectComponent(d->GetId(), 1, 0);
+                anodes.push_back(anode);
+            }
+            return vs;
+        };
+
+        Context ctx;
+        Context reference;
+        reference.m_bypassTolerance = 0.0;
+        std::vector<std::uint32_t> anodes;
+        std::vector<std::uint32_t> refAnodes;
+        auto vs = build(ctx, anodes);
+        auto refVs = build(reference, refAnodes);
+        for (int i = 0; i < 5; ++i)
+        {
+            ctx.Step(0.001);
+            reference.Step(0.001);
+        }
+        CHECK(ctx.GetPartitions()[0].converged);
+        CHECK(reference.GetPartitions()[0].bypassCount == 0);
+
+        // A re-solve with nothing moved: every diode bypassed, no refactor.
+        const Partition &partition = ctx.GetPartitions()[0];
+        std::uint64_t factors = partition.factorCount;
+        std::uint64_t reuses = partition.factorReuseCount;
+        std::uint64_t bypassed = partition.bypassCount;
+        std::vector<double> before;
+        for (std::uint32_t node : anodes)
+        {
+            before.push_back(ctx.GetNodeVoltage(node));
+        }
+        vs->MarkDirty();
+        ctx.Step(0.001);
+        CHECK(partition.factorCount == factors);
+        CHECK(partition.factorReuseCount > reuses);
+        CHECK(partition.bypassCount >= bypassed + anodes.size());
+        for (std::size_t i = 0; i < anodes.size(); ++i)
+        {
+            CHECK(ctx.GetNodeVoltage(anodes[i]) == before[i]);
+        }
+
+        // A real change relinearizes and lands where the reference does.
+        vs->SetVoltage(3.3);
+        refVs->SetVoltage(3.3);
+        for (int i = 0; i < 5; ++i)
+        {
+            ctx.Step(0.001);
+            reference.Step(0.001);
+        }
+        CHECK(partition.factorCount > factors);
+        for (std::size_t i = 0; i < anodes.size(); ++i)
+        {
+            CHECK(NearEqual(ctx.GetNodeVoltage(anodes[i]), reference.GetNodeVoltage(refAnodes[i]), 1e-5));
+        }
+
+        std::cout << "[PASS] Test_DeviceBypass\n";
+        return true;
+    }
+
+    // Test 15: PWM averaging stamps timer and firmware PWM at their mean
+    bool Test_PwmAveraging()
+    {
+        auto build = [](Context &ctx, const char *hex, bool averaging, std::uint32_t &pin)
+        {
+            pin = ctx.CreateNode();
+            auto avr = std::make_shared<AvrComponent>(g_nextId++);
+            auto load = std::make_shared<Resistor>(g_nextId++, 1000.0);
+            avr->m_pwmAveraging = averaging;
+            ctx.AddComponent(avr);
+            ctx.AddComponent(load);
+            ctx.ConnectComponent(avr->GetId(), 6, pin);
+            ctx.ConnectComponent(load->GetId(), 0, pin);
+            ctx.ConnectComponent(load->GetId(), 1, 0);
+            return NativeEngine::Utils::HexLoader::LoadHexText(avr->m_flash, hex);
+        };
+        const double divider = 1000.0 / 1020.0; // 20 ohm driver into 1k
+
+        // analogWrite(6, 127): DDRD6, fast PWM on OC0A, clk/64, OCR0A = 127
+        const char *timerPwm = ":1200000000E40AB903E804BD03E005BD0FE707BDFFCF6E\n:00000001FF\n";
+        Context hw;
+        std::uint32_t hwPin = 0;
+        CHECK(build(hw, timerPwm, true, hwPin));
+        hw.Step(0.001);
+        CHECK(NearEqual(hw.GetNodeVoltage(hwPin), 5.0 * 128.0 / 256.0 * divider, 1e-4));
+
+        Context hwOff;
+        std::uint32_t hwOffPin = 0;
+        CHECK(build(hwOff, timerPwm, false, hwOffPin));
+        hwOff.Step(0.001);
+        CHECK(NearEqual(hwOff.GetNodeVoltage(hwOffPin), 0.0));
+
+        // sbi DDRD,6 ; loop: sbi PORTD,6 ; 50x dec/brne ; cbi PORTD,6 ;
+        // 150x dec/brne ; rjmp loop -> high 152 of 606 cycles (~26 kHz)
+        const char *softPwm =
+            ":14000000569A5E9A12E31A95F1F75E9816E91A95F1F7F7CF26\n:00000001FF\n";
+        Context sw;
+        std::uint32_t swPin = 0;
+        CHECK(build(sw, softPwm, true, swPin));
+        Context edges;
+        std::uint32_t edgesPin = 0;
+        CHECK(build(edges, softPwm, false, edgesPin));
+        sw.Step(0.001);
+        edges.Step(0.001);
+        std::uint64_t swEvents = sw.GetPartitions()[0].eventCount;
+        std::uint64_t edgeEvents = edges.GetPartitions()[0].eventCount;
+        for (int i = 0; i < 3; ++i)
+        {
+            sw.Step(0.001);
+            edges.Step(0.001);
+        }
+        // Locked: no more re-solves, while the edge-resolved run keeps
+        // stopping at every toggle.
+        CHECK(sw.GetPartitions()[0].eventCount == swEvents);
+        CHECK(edges.GetPartitions()[0].eventCount > edgeEvents + 100);
+        CHECK(NearEqual(sw.GetNodeVoltage(swPin), 5.0 * 152.0 / 606.0 * divider, 0.01));
+
+        std::cout << "[PASS] Test_PwmAveraging\n";
+        return true;
+    }
+
+    // Resistor mesh of side x side nodes, grounded at the far corner
+    std::vector<std::uint32_t> AddMesh(Context &ctx, int side)
+    {
+        std::vector<std::uint32_t> nodes(side * side);
+        for (auto &node : nodes)
+        {
+            node = ctx.CreateNode();
+        }
+        auto link = [&ctx](std::uint32_t a, std::uint32_t b, double ohms)
+        {
+            auto r = std::make_shared<Resistor>(g_nextId++, ohms);
+            ctx.AddComponent(r);
+            ctx.ConnectComponent(r->GetId(), 0, a);
+            ctx.ConnectComponent(r->GetId(), 1, b);
+        };
+        for (int y = 0; y < side; ++y)
+        {
+            for (int x = 0; x < side; ++x)
+            {
+                double ohms = 1.0 + 0.01 * ((x * 7 + y * 13) % 10);
+                if (x + 1 < side)
+                    link(nodes[y * side + x], nodes[y * side + x + 1], ohms);
+                if (y + 1 < side)
+                    link(nodes[y * side + x], nodes[(y + 1) * side + x], ohms);
+            }
+        }
+        link(nodes.back(), 0, 1.0);
+        return nodes;
+    }
+
+    // Test 16: Iterative backend matches the direct solve on large meshes
+    bool Test_IterativeBackend()
+    {
+        const int side = 24;
+
+        // Norton driver only: symmetric, solved with PCG.
+        std::shared_ptr<AnalogDriver> drivers[2];
+        Context contexts[2];
+        std::vector<std::uint32_t> meshes[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            Context &ctx = contexts[i];
+            ctx.m_linearSolver = i == 0 ? LinearSolverBackend::Iterative : LinearSolverBackend::Direct;
+            meshes[i] = AddMesh(ctx, side);
+            drivers[i] = std::make_shared<AnalogDriver>(g_nextId++, 5.0, 10.0);
+            ctx.AddComponent(drivers[i]);
+            ctx.ConnectComponent(drivers[i]->GetId(), 0, meshes[i].front());
+            ctx.Step(0.001);
+        }
+        const Partition &cg = contexts[0].GetPartitions()[0];
+        CHECK(cg.sparse && cg.symmetric);
+        CHECK(!contexts[1].GetPartitions()[0].sparse);
+        CHECK(cg.iterativeFailures == 0);
+        for (std::size_t n = 0; n < meshes[0].size(); ++n)
+        {
+            CHECK(NearEqual(contexts[0].GetNodeVoltage(meshes[0][n]),
+                            contexts[1].GetNodeVoltage(meshes[1][n]), 1e-7));
+        }
+
+        // A small change re-solves from the previous answer.
+        std::uint64_t coldIterations = cg.iterativeIterations;
+        drivers[0]->SetVoltage(5.1);
+        drivers[1]->SetVoltage(5.1);
+        contexts[0].Step(0.001);
+        contexts[1].Step(0.001);
+        CHECK(cg.iterativeIterations - coldIterations < coldIterations);
+        CHECK(NearEqual(contexts[0].GetNodeVoltage(meshes[0][side]),
+                        contexts[1].GetNodeVoltage(meshes[1][side]), 1e-7));
+
+        // Voltage source branch rows and a diode: BiCGSTAB inside Newton.
+        Context iterative;
+        Context direct;
+        std::vector<std::uint32_t> iterMesh;
+        std::vector<std::uint32_t> directMesh;
+        for (Context *ctx : {&iterative, &direct})
+        {
+            ctx->m_linearSolver = ctx == &iterative ? LinearSolverBackend::Iterative
+                                                    : LinearSolverBackend::Direct;
+            std::vector<std::uint32_t> mesh = AddMesh(*ctx, side);
+            std::uint32_t supply = ctx->CreateNode();
+            auto vs = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+            auto feed = std::make_shared<Resistor>(g_nextId++, 10.0);
+            auto d = std::make_shared<Diode>(g_nextId++);
+            ctx->AddComponent(vs);
+            ctx->AddComponent(feed);
+            ctx->AddComponent(d);
+            ctx->ConnectComponent(vs->GetId(), 0, supply);
+            ctx->ConnectComponent(vs->GetId(), 1, 0);
+            ctx->ConnectComponent(feed->GetId(), 0, supply);
+            ctx->ConnectComponent(feed->GetId(), 1, mesh.front());
+            ctx->ConnectComponent(d->GetId(), 0, mesh[side / 2]);
+            ctx->ConnectComponent(d->GetId(), 1, 0);
+            for (int i = 0; i < 5; ++i)
+            {
+                ctx->Step(0.001);
+            }
+            (ctx == &iterative ? iterMesh : directMesh) = mesh;
+        }
+        const Partition &bicg = iterative.GetPartitions()[0];
+        CHECK(bicg.sparse && !bicg.symmetric);
+        CHECK(bicg.converged);
+        CHECK(bicg.iterativeFailures == 0);
+        for (std::size_t n = 0; n < iterMesh.size(); ++n)
+        {
+            CHECK(NearEqual(iterative.GetNodeVoltage(iterMesh[n]), direct.GetNodeVoltage(directMesh[n]), 1e-6));
+        }
+
+        std::cout << "[PASS] Test_IterativeBackend\n";
+        return true;
+    }
+
+    // Test 17: Per-step solver statistics, in the context and through the bridge
+    bool Test_CircuitStats()
+    {
+        Context ctx;
+        std::uint32_t out = 0;
+        auto vs = AddDivider(ctx, 5.0, 1000.0, 1000.0, out);
+        AddLadder(ctx, 5.0, 40);
+        ctx.Step(0.001);
+        const StepStats &first = ctx.GetStepStats();
+        CHECK(first.partitionCount == 2);
+        CHECK(first.partitionsSolved == 2);
+        CHECK(first.unknowns == 3 + 41);
+        CHECK(first.largestPartition == 41);
+        CHECK(first.newtonIterations == 2);
+        CHECK(first.factorizations == 2);
+        CHECK(first.factorReuses == 0);
+        CHECK(first.pivotWarnings == 0);
+        CHECK(first.nonConverged == 0);
+        // Divider: 6 nonzeros; ladder: tridiagonal plus the source branch.
+        CHECK(first.nonzeros == 6 + (3 * 40 - 2) + 2);
+        CHECK(first.stepSeconds == 0.0);
+
+        // Counters cover one step only; a clean context does no work.
+        ctx.Step(0.001);
+        CHECK(ctx.GetStepStats().partitionsSolved == 0);
+        CHECK(ctx.GetStepStats().newtonIterations == 0);
+        CHECK(ctx.GetStepStats().partitionCount == 2);
+
+        // Same matrix, new source value: substitute only.
+        vs->SetVoltage(3.3);
+        ctx.m_profileTimings = true;
+        ctx.Step(0.001);
+        const StepStats &resolve = ctx.GetStepStats();
+        CHECK(resolve.partitionsSolved == 1);
+        CHECK(resolve.factorizations == 0);
+        CHECK(resolve.factorReuses == 1);
+        CHECK(resolve.stepSeconds > 0.0);
+        CHECK(resolve.solveSeconds > 0.0);
+        CHECK(resolve.stampSeconds + resolve.solveSeconds <= resolve.stepSeconds);
+
+        // Two sources across the same node leave a zero pivot.
+        Context singular;
+        std::uint32_t node = singular.CreateNode();
+        for (int i = 0; i < 2; ++i)
+        {
+            auto source = std::make_shared<VoltageSource>(g_nextId++, 5.0);
+            singular.AddComponent(source);
+            singular.ConnectComponent(source->GetId(), 0, node);
+            singular.ConnectComponent(source->GetId(), 1, 0);
+        }
+        singular.Step(0.001);
+        CHECK(singular.GetStepStats().pivotWarnings == 1);
+
+        // Bridge readback, with timings switched on.
+        CHECK(Native_GetCircuitStats(nullptr) == 0);
+        Native_CreateContext();
+        Native_SetCircuitProfiling(1);
+        int top = Native_AddNode();
+        int tap = Native_AddNode();
+        float volts[] = {5.0f};
+        float ohms[] = {1000.0f};
+        int source = Native_AddComponent(static_cast<int>(ComponentType::VoltageSource), 1, volts);
+        int ra = Native_AddComponent(static_cast<int>(ComponentType::Resistor), 1, ohms);
+        int rb = Native_AddComponent(static_cast<int>(ComponentType::Resistor), 1, ohms);
+        Native_Connect(source, 0, top);
+        Native_Connect(source, 1, 0);
+        Native_Connect(ra, 0, top);
+        Native_Connect(ra, 1, tap);
+        Native_Connect(rb, 0, tap);
+        Native_Connect(rb, 1, 0);
+        Native_Step(0.001f);
+        CircuitStats stats{};
+        CHECK(Native_GetCircuitStats(&stats) == 1);
+        CHECK(stats.partition_count == 1);
+        CHECK(stats.unknowns == 3);
+        CHECK(stats.nonzeros == 6);
+        CHECK(stats.factorizations == 1);
+        CHECK(stats.step_ms > 0.0);
+        Native_SetCircuitProfiling(0);
+        Native_Step(0.001f);
+        CHECK(Native_GetCircuitStats(&stats) == 1);
+        CHECK(stats.step_ms == 0.0);
+        Native_DestroyContext();
+
+        std::cout << "[PASS] Test_CircuitStats\n";
+        return true;
+    }
+
+    // Test 18: MCUs stepped on the pool match stepping them one by one
+    bool Test_ParallelAvrStepping()
+    {
+        // Square wave on D6 (see Test_PwmAveraging), a different period per AVR
+        const char *programs[] = {
+            ":14000000569A5E9A12E31A95F1F75E9816E91A95F1F7F7CF26\n:00000001FF\n",
+            ":14000000569A5E9A18E21A95F1F75E9816E91A95F1F7F7CF21\n:00000001FF\n",
+            ":14000000569A5E9A12E31A95F1F75E981AE31A95F1F7F7CF28\n:00000001FF\n",
+            ":14000000569A5E9A15E01A95F1F75E9814E61A95F1F7F7CF2B\n:00000001FF\n",
+        };
+        // shared: every D6 drives one bus through 1k (one partition);
+        // otherwise each AVR has its own load (one partition each).
+        auto build = [&programs](Context &ctx, bool shared, std::vector<std::uint32_t> &pins)
+        {
+            std::uint32_t bus = shared ? ctx.CreateNode() : 0;
+            if (shared)
+            {
+                auto pull = std::make_shared<Resistor>(g_nextId++, 10000.0);
+                ctx.AddComponent(pull);
+                ctx.ConnectComponent(pull->GetId(), 0, bus);
+                ctx.ConnectComponent(pull->GetId(), 1, 0);
+            }
+            for (const char *hex : programs)
+            {
+                std::uint32_t pin = ctx.CreateNode();
+                auto avr = std::make_shared<AvrComponent>(g_nextId++);
+                auto load = std::make_shared<Resistor>(g_nextId++, 1000.0);
+                ctx.AddComponent(avr);
+                ctx.AddComponent(load);
+                ctx.ConnectComponent(avr->GetId(), 6, pin);
+                ctx.ConnectComponent(load->GetId(), 0, pin);
+                ctx.ConnectComponent(load->GetId(), 1, bus);
+                if (!NativeEngine::Utils::HexLoader::LoadHexText(avr->m_flash, hex))
+                    return false;
+                pins.push_back(pin);
+            }
+            if (shared)
+                pins.push_back(bus);
+            return true;
+        };
+
+        for (bool shared : {false, true})
+        {
+            Context serial;
+            Context parallel;
+            serial.m_solverThreads = 1;
+            parallel.m_solverThreads = 4;
+            // Shared: all AVRs in one partition, so only unsplit stepping
+            // runs them concurrently.
+            serial.m_interleaveEvents = !shared;
+            parallel.m_interleaveEvents = !shared;
+            std::vector<std::uint32_t> serialPins;
+            std::vector<std::uint32_t> parallelPins;
+            CHECK(build(serial, shared, serialPins));
+            CHECK(build(parallel, shared, parallelPins));
+            CHECK(parallel.GetPartitions().size() == serial.GetPartitions().size());
+            for (int i = 0; i < 20; ++i)
+            {
+                serial.Step(0.0001);
+                parallel.Step(0.0001);
+                for (std::size_t n = 0; n < serialPins.size(); ++n)
+                {
+                    CHECK(serial.GetNodeVoltage(serialPins[n]) == parallel.GetNodeVoltage(parallelPins[n]));
+                }
+            }
+            CHECK(serial.GetPartitions().size() == (shared ? 1u : 4u));
+            for (std::size_t p = 0; p < serial.GetPartitions().size(); ++p)
+            {
+                CHECK(serial.GetPartitions()[p].eventCount == parallel.GetPartitions()[p].eventCount);
+                CHECK(serial.GetPartitions()[p].solveCount == parallel.GetPartitions()[p].solveCount);
+            }
+            if (!shared)
+            {
+                CHECK(serial.GetPartitions()[0].eventCount > 10);
+            }
+        }
+
+        std::cout << "[PASS] Test_ParallelAvrStepping\n";
+        return true;
+    }
+
+    // Test 19: Predecoded flash runs like the plain interpreter, and
+    // invalidated pages pick up rewritten code
+    bool Test_AvrDecodeCache()
+    {
+        // ldi r16,3 ; ldi r17,0 ; add r17,r16 ; dec r16 ; brne .-6 ;
+        // sts 0x0100,r17 ; out PORTB,r17 ; rcall .+2 ; rjmp .-2 ; ret
+        const std::uint16_t program[] = {0xE003, 0xE010, 0x0F10, 0x950A, 0xF7E9,
+                                         0x9310, 0x0100, 0xB915, 0xD001, 0xCFFF, 0x9508};
+        std::vector<std::uint8_t> flash[2];
+        std::vector<std::uint8_t> sram[2];
+        std::uint8_t io[2][0xE0] = {};
+        std::uint8_t regs[2][32] = {};
+        AvrCore core[2];
+        std::vector<AvrDecoded> decoded(1024);
+        for (int c = 0; c < 2; ++c)
+        {
+            flash[c].assign(2048, 0);
+            sram[c].assign(2048, 0);
+            LoadProgram(flash[c], program, std::size(program));
+            AVR_Init(&core[c], flash[c].data(), flash[c].size(), sram[c].data(), sram[c].size(),
+                     io[c], sizeof(io[c]), regs[c], sizeof(regs[c]));
+        }
+        AVR_SetDecodeCache(&core[1], decoded.data(), decoded.size());
+        CHECK(core[0].decoded == nullptr);
+        CHECK(core[1].decoded_size == 1024);
+
+        auto lockstep = [&core, &regs](int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (AVR_ExecuteNext(&core[0]) != AVR_ExecuteNext(&core[1]) || core[0].pc != core[1].pc ||
+                    std::memcmp(regs[0], regs[1], sizeof(regs[0])) != 0)
+                    return false;
+            }
+            return true;
+        };
+        CHECK(lockstep(40));
+        CHECK(regs[1][17] == 6); // 3 + 2 + 1
+        CHECK(sram[1][0] == 6);
+        CHECK(io[1][0x05] == 6);
+        CHECK(decoded[0].op != 0);
+        CHECK(decoded[5].cycles == 2 && decoded[5].k == 0x0100);
+
+        // Rewrite ldi r16,3 -> ldi r16,4 on both cores and rerun from reset.
+        for (int c = 0; c < 2; ++c)
+        {
+            flash[c][0] = 0x04;
+            core[c].pc = 0;
+        }
+        AVR_InvalidateFlash(&core[1], 0, 2);
+        CHECK(decoded[0].op == 0);
+        CHECK(lockstep(40));
+        CHECK(regs[1][17] == 10); // 4 + 3 + 2 + 1
+
+        // A write to a later page leaves the first one decoded.
+        AVR_InvalidateFlash(&core[1], 1024, 2);
+        CHECK(decoded[0].op != 0 && decoded[10].op != 0);
+
+        std::cout << "[PASS] Test_AvrDecodeCache\n";
+        return true;
+    }
+
+    // Test 20: Block execution stops at the same instruction boundaries as
+    // single stepping, including interrupts raised by I/O writes (WDT)
+    bool Test_AvrBlockExecution()
+    {
+        std::vector<std::uint16_t> program(0x50, 0);
+        program[0x00] = 0xC02F; // rjmp main
+        program[0x0C] = 0xC035; // WDT vector: rjmp isr
+        // main: ldi r16,0x20 ; out DDRB,r16 ; sei
+        const std::uint16_t setup[] = {0xE200, 0xB904, 0x9478};
+        // loop: subi r20,-1 ; add r21,r20 ; sts 0x0200,r21 ; ldi r22,5 ;
+        // dec r22 ; brne .-2 ; ldi r16,0xC0 ; sts WDTCSR,r16 ; rjmp loop
+        const std::uint16_t loop[] = {0x5F4F, 0x0F54, 0x9350, 0x0200, 0xE065, 0x956A,
+                                      0xF7F1, 0xEC00, 0x9300, 0x0060, 0xCFF5};
+        // isr: in r17,PORTB ; ldi r18,0x20 ; eor r17,r18 ; out PORTB,r17 ;
+        // push r17 ; pop r19 ; reti
+        const std::uint16_t isr[] = {0xB115, 0xE220, 0x2712, 0xB915, 0x931F, 0x933F, 0x9518};
+        std::copy(std::begin(setup), std::end(setup), program.begin() + 0x30);
+        std::copy(std::begin(loop), std::end(loop), program.begin() + 0x36);
+        std::copy(std::begin(isr), std::end(isr), program.begin() + 0x42);
+
+        std::vector<std::uint8_t> flash[2];
+        std::vector<std::uint8_t> sram[2];
+        std::uint8_t io[2][0xE0] = {};
+        std::uint8_t regs[2][32] = {};
+        AvrCore core[2];
+        std::vector<AvrDecoded> decoded(1024);
+        for (int c = 0; c < 2; ++c)
+        {
+            flash[c].assign(2048, 0);
+            sram[c].assign(2048, 0);
+            LoadProgram(flash[c], program.data(), program.size());
+            AVR_Init(&core[c], flash[c].data(), flash[c].size(), sram[c].data(), sram[c].size(),
+                     io[c], sizeof(io[c]), regs[c], sizeof(regs[c]));
+        }
+        AVR_SetDecodeCache(&core[1], decoded.data(), decoded.size());
+
+        std::uint64_t stepped = 0;
+        std::uint64_t blocked = 0;
+        std::uint64_t instructions = 0;
+        int blocks = 0;
+        int toggles = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            std::uint32_t steps = 0;
+            std::uint8_t portb = io[1][AVR_PORTB - AVR_IO_BASE];
+            blocked += AVR_ExecuteBlock(&core[1], 1 + (i * 7) % 50, &steps);
+            instructions += steps;
+            blocks++;
+            while (stepped < blocked)
+            {
+                stepped += AVR_ExecuteNext(&core[0]);
+            }
+            CHECK(stepped == blocked);
+            CHECK(core[0].pc == core[1].pc);
+            CHECK(AVR_GetSreg(&core[0]) == AVR_GetSreg(&core[1]));
+            CHECK(std::memcmp(regs[0], regs[1], sizeof(regs[0])) == 0);
+            CHECK(std::memcmp(io[0], io[1], sizeof(io[0])) == 0);
+            CHECK(sram[0] == sram[1]);
+            if (io[1][AVR_PORTB - AVR_IO_BASE] != portb)
+            {
+                toggles++;
+            }
+        }
+        CHECK(toggles > 50);
+        CHECK(instructions > 2 * static_cast<std::uint64_t>(blocks));
+
+        std::cout << "[PASS] Test_AvrBlockExecution\n";
+        return true;
+    }
+
+    // Test 21: The pending-interrupt mask follows flag, mask and SREG.I
+    // writes, and entry acknowledges only the flag it serviced
+    bool Test_AvrPendingInterrupts()
+    {
+        std::vector<std::uint8_t> flash(2048, 0); // All NOPs
+        std::vector<std::uint8_t> sram(2048, 0);
+        std::uint8_t io[0xE0] = {};
+        std::uint8_t regs[32] = {};
+        AvrCore core;
+        AVR_Init(&core, flash.data(), flash.size(), sram.data(), sram.size(),
+                 io, sizeof(io), regs, sizeof(regs));
+        CHECK(core.irq_flagged == 0 && core.irq_pending == 0);
+
+        // Flag without its enable bit, then the other way round
+        AVR_IoSetFlags(&core, AVR_TIFR0, 1u << 1); // OCF0A, OCIE0A clear
+        AVR_IoWrite(&core, AVR_TIMSK0, 0x01);      // TOIE0
+        CHECK(core.irq_flagged == 0);
+        AVR_IoSetFlags(&core, AVR_TIFR0, 0x01);
+        CHECK(core.irq_flagged != 0);
+        CHECK(core.irq_pending == 0); // SREG.I clear
+
+        AVR_IoWrite(&core, AVR_SREG, 0x80);
+        CHECK(core.irq_pending == core.irq_flagged);
+        AVR_IoWrite(&core, AVR_TIFR0, 0x01); // Write one to clear
+        CHECK(core.irq_pending == 0);
+        AVR_IoSetFlags(&core, AVR_TIFR0, 0x01);
+        CHECK(core.irq_pending != 0);
+
+        // Timer2 overflow outranks Timer0 overflow
+        AVR_IoWrite(&core, AVR_TIMSK2, 0x01);
+        AVR_IoSetFlags(&core, AVR_TIFR2, 0x01);
+        AVR_ExecuteBlock(&core, 1, nullptr);
+        CHECK(core.pc == 0x0012);
+        CHECK((io[AVR_TIFR2 - AVR_IO_BASE] & 0x01) == 0);
+        CHECK(io[AVR_TIFR0 - AVR_IO_BASE] == 0x03); // Untouched by the ack
+        CHECK((io[AVR_SREG - AVR_IO_BASE] & 0x80) == 0);
+        CHECK(core.irq_pending == 0 && core.irq_flagged != 0);
+
+        AVR_IoWrite(&core, AVR_SREG, 0x80);
+        AVR_ExecuteBlock(&core, 1, nullptr);
+        CHECK(core.pc == 0x0020);
+        CHECK(io[AVR_TIFR0 - AVR_IO_BASE] == 0x02);
+        CHECK(core.irq_flagged == 0);
+
+        // Vectors follow the MCU kind
+        AVR_IoSetFlags(&core, AVR_TIFR0, 0x01);
+        AVR_SetMcuKind(&core, AVR_MCU_2560);
+        AVR_IoWrite(&core, AVR_SREG, 0x80);
+        AVR_ExecuteBlock(&core, 1, nullptr);
+        CHECK(core.pc == 0x002C);
+
+        std::cout << "[PASS] Test_AvrPendingInterrupts\n";
+        return true;
+    }
+
+    // Test 22: Lazily evaluated SREG flags match the instruction set manual
+    // for every ALU instruction the core implements, and SREG writes reload them
+    bool Test_AvrLazyFlags()
+    {
+        enum Kind { Add, Adc, Cp, Cpc, Subi, Sbci, Eor, Andi, Ori, Dec, Adiw, Sbiw, KindCount };
+        std::vector<std::uint8_t> flash(2048, 0);
+        std::vector<std::uint8_t> sram(2048, 0);
+        std::uint8_t io[0xE0] = {};
+        std::uint8_t regs[32] = {};
+        AvrCore core;
+        AVR_Init(&core, flash.data(), flash.size(), sram.data(), sram.size(),
+                 io, sizeof(io), regs, sizeof(regs));
+
+        std::uint32_t seed = 12345;
+        auto random = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<std::uint8_t>(seed >> 24);
+        };
+
+        for (int i = 0; i < 6000; ++i)
+        {
+            const int kind = i % KindCount;
+            const std::uint8_t a = random();
+            const std::uint8_t b = random();
+            const std::uint8_t k6 = static_cast<std::uint8_t>(b & 0x3F);
+            const std::uint8_t before = static_cast<std::uint8_t>(random() & 0x3F);
+            const int c = before & 0x01;
+            const bool z = (before & 0x02) != 0;
+            std::uint16_t opcode = 0;
+            switch (kind)
+            {
+            case Add: opcode = 0x0F01; break; // add r16,r17
+            case Adc: opcode = 0x1F01; break;
+            case Cp: opcode = 0x1701; break;
+            case Cpc: opcode = 0x0701; break;
+            case Eor: opcode = 0x2701; break;
+            case Subi: opcode = static_cast<std::uint16_t>(0x5000 | ((b & 0xF0) << 4) | (b & 0x0F)); break;
+            case Sbci: opcode = static_cast<std::uint16_t>(0x4000 | ((b & 0xF0) << 4) | (b & 0x0F)); break;
+            case Andi: opcode = static_cast<std::uint16_t>(0x7000 | ((b & 0xF0) << 4) | (b & 0x0F)); break;
+            case Ori: opcode = static_cast<std::uint16_t>(0x6000 | ((b & 0xF0) << 4) | (b & 0x0F)); break;
+            case Dec: opcode = 0x950A; break; // dec r16
+            case Adiw: opcode = static_cast<std::uint16_t>(0x9600 | ((k6 & 0x30) << 2) | (k6 & 0x0F)); break;
+            case Sbiw: opcode = static_cast<std::uint16_t>(0x9700 | ((k6 & 0x30) << 2) | (k6 & 0x0F)); break;
+            }
+            flash[0] = static_cast<std::uint8_t>(opcode & 0xFF);
+            flash[1] = static_cast<std::uint8_t>(opcode >> 8);
+            core.pc = 0;
+            regs[16] = a;
+            regs[17] = b;
+            regs[24] = b;
+            regs[25] = a;
+            AVR_IoWrite(&core, AVR_SREG, before);
+            AVR_ExecuteNext(&core);
+
+            // Reference flags from plain integer arithmetic
+            int result = 0;
+            bool C = c != 0, H = (before & 0x20) != 0, V = false, N = false, Z = false;
+            if (kind == Add || kind == Adc)
+            {
+                int cin = kind == Adc ? c : 0;
+                result = (a + b + cin) & 0xFF;
+                C = a + b + cin > 0xFF;
+                H = (a & 0x0F) + (b & 0x0F) + cin > 0x0F;
+                int sv = static_cast<std::int8_t>(a) + static_cast<std::int8_t>(b) + cin;
+                V = sv < -128 || sv > 127;
+            }
+            else if (kind == Cp || kind == Cpc || kind == Subi || kind == Sbci)
+            {
+                int cin = (kind == Cpc || kind == Sbci) ? c : 0;
+                result = (a - b - cin) & 0xFF;
+                C = a - b - cin < 0;
+                H = (a & 0x0F) - (b & 0x0F) - cin < 0;
+                int sv = static_cast<std::int8_t>(a) - static_cast<std::int8_t>(b) - cin;
+                V = sv < -128 || sv > 127;
+            }
+            else if (kind == Eor || kind == Andi || kind == Ori)
+            {
+                result = kind == Eor ? (a ^ b) : kind == Andi ? (a & b) : (a | b);
+            }
+            else if (kind == Dec)
+            {
+                result = (a - 1) & 0xFF;
+                V = a == 0x80;
+            }
+            if (kind == Adiw || kind == Sbiw)
+            {
+                int word = b | (a << 8);
+                int sum = kind == Adiw ? word + k6 : word - k6;
+                result = sum & 0xFFFF;
+                C = kind == Adiw ? sum > 0xFFFF : sum < 0;
+                int sv = static_cast<std::int16_t>(word) + (kind == Adiw ? k6 : -k6);
+                V = sv < -32768 || sv > 32767;
+                N = (result & 0x8000) != 0;
+                Z = result == 0;
+                CHECK((regs[24] | (regs[25] << 8)) == result);
+            }
+            else
+            {
+                N = (result & 0x80) != 0;
+                Z = result == 0;
+                if (kind == Cpc || kind == Sbci)
+                    Z = Z && z;
+                if (kind != Cp && kind != Cpc)
+                    CHECK(regs[16] == result);
+            }
+            const std::uint8_t expected = static_cast<std::uint8_t>(
+                (C ? 0x01 : 0) | (Z ? 0x02 : 0) | (N ? 0x04 : 0) | (V ? 0x08 : 0) |
+                ((N != V) ? 0x10 : 0) | (H ? 0x20 : 0));
+            CHECK((AVR_GetSreg(&core) & 0x3F) == expected);
+            CHECK(AVR_IoRead(&core, AVR_SREG) == AVR_GetSreg(&core));
+        }
+
+        // A written SREG is what branches see: sei keeps Z = 1, so breq is taken
+        const std::uint16_t program[] = {0x9478, 0xF009}; // sei ; breq .+2
+        LoadProgram(flash, program, std::size(program));
+        core.pc = 0;
+        AVR_IoWrite(&core, AVR_SREG, 0x02);
+        AVR_ExecuteNext(&core);
+        AVR_ExecuteNext(&core);
+        CHECK(core.pc == 3);
+        CHECK(AVR_GetSreg(&core) == 0x82);
+
+        std::cout << "[PASS] Test_AvrLazyFlags\n";
+        return true;
+    }
+
+    // Test 23: A polling loop is fast-forwarded to the end of the block, with
+    // the same cycles, instruction count and state as single stepping
+    bool Test_AvrIdleLoopSkip()
+    {
+        // poll: lds r24,0x0200 ; cpi r24,0 ; breq poll ; subi r20,-1 ; rjmp .-1
+        const std::uint16_t program[] = {0x9180, 0x0200, 0x3080, 0xF3E1, 0x5F4F, 0xCFFF};
+        std::vector<std::uint8_t> flash[2];
+        std::vector<std::uint8_t> sram[2];
+        std::uint8_t io[2][0xE0] = {};
+        std::uint8_t regs[2][32] = {};
+        AvrCore core[2];
+        for (int c = 0; c < 2; ++c)
+        {
+            flash[c].assign(2048, 0);
+            sram[c].assign(2048, 0);
+            LoadProgram(flash[c], program, std::size(program));
+            AVR_Init(&core[c], flash[c].data(), flash[c].size(), sram[c].data(), sram[c].size(),
+                     io[c], sizeof(io[c]), regs[c], sizeof(regs[c]));
+        }
+
+        auto runBoth = [&](std::uint32_t budget)
+        {
+            std::uint32_t steps = 0;
+            std::uint64_t blocked = AVR_ExecuteBlock(&core[1], budget, &steps);
+            std::uint64_t stepped = 0;
+            std::uint32_t instructions = 0;
+            while (stepped < blocked)
+            {
+                stepped += AVR_ExecuteNext(&core[0]);
+                instructions++;
+            }
+            return stepped == blocked && instructions == steps && core[0].pc == core[1].pc &&
+                   AVR_GetSreg(&core[0]) == AVR_GetSreg(&core[1]) &&
+                   std::memcmp(regs[0], regs[1], sizeof(regs[0])) == 0;
+        };
+
+        CHECK(runBoth(100000));
+        CHECK(core[1].idle_loop_cycles > 90000);
+        CHECK(core[0].idle_loop_cycles == 0);
+        CHECK(core[1].pc <= 3);
+
+        // The flag changes between blocks: the loop exits into rjmp .-1
+        sram[0][0x0100] = 1;
+        sram[1][0x0100] = 1;
+        std::uint64_t skipped = core[1].idle_loop_cycles;
+        CHECK(runBoth(5000));
+        CHECK(regs[1][20] == 1);
+        CHECK(core[1].pc == 5);
+        CHECK(core[1].idle_loop_cycles > skipped + 4000);
+
+        std::cout << "[PASS] Test_AvrIdleLoopSkip\n";
+        return true;
+    }
+
+    // Test 24: SLEEP holds the core until an interrupt wakes it
+    bool Test_AvrSleep()
+    {
+        // ldi r16,1 ; out SMCR,r16 ; sei ; sleep ; subi r20,-1 ; rjmp .-3
+        const std::uint16_t program[] = {0xE001, 0xBB03, 0x9478, 0x9588, 0x5F4F, 0xCFFD};
+        std::vector<std::uint8_t> flash(2048, 0);
+        std::vector<std::uint8_t> sram(2048, 0);
+        std::uint8_t io[0xE0] = {};
+        std::uint8_t regs[32] = {};
+        LoadProgram(flash, program, std::size(program));
+        flash[2 * 0x20] = 0x18; // TIMER0_OVF: reti
+        flash[2 * 0x20 + 1] = 0x95;
+        AvrCore core;
+        AVR_Init(&core, flash.data(), flash.size(), sram.data(), sram.size(),
+                 io, sizeof(io), regs, sizeof(regs));
+
+        // out, sei and sleep each end a block
+        std::uint32_t steps = 0;
+        for (int block = 0; block < 8 && !core.sleeping; ++block)
+            AVR_ExecuteBlock(&core, 100, &steps);
+        CHECK(core.sleeping == 1);
+        CHECK(core.pc == 4);
+
+        // Asleep, a block takes its whole budget at once
+        CHECK(AVR_ExecuteBlock(&core, 100000, &steps) == 100000);
+        CHECK(steps == 0);
+        CHECK(core.pc == 4);
+
+        // An interrupt wakes the core; after reti it runs on to the next sleep
+        AVR_IoWrite(&core, AVR_TIMSK0, 0x01);
+        AVR_IoSetFlags(&core, AVR_TIFR0, 0x01);
+        AVR_ExecuteBlock(&core, 100, &steps);
+        CHECK(core.pc == 0x20);
+        CHECK(core.sleeping == 0);
+        for (int block = 0; block < 8 && !core.sleeping; ++block)
+            AVR_ExecuteBlock(&core, 100, &steps);
+        CHECK(regs[20] == 1);
+        CHECK(core.sleeping == 1);
+        CHECK(core.pc == 4);
+
+        // Without SMCR.SE, sleep is a nop
+        AVR_IoWrite(&core, AVR_SMCR, 0x00);
+        core.sleeping = 0;
+        for (int block = 0; block < 6; ++block)
+            AVR_ExecuteBlock(&core, 100, &steps);
+        CHECK(core.sleeping == 0);
+        CHECK(regs[20] == 4);
+
+        std::cout << "[PASS] Test_AvrSleep\n";
+        return true;
+    }
+
+    // Test 25: Reads and writes of synced registers call the sync hook first
+    bool Test_AvrIoSync()
+    {
+        // nop ; nop ; in r20,TCNT0 ; out PORTB,r20 ; rjmp .-1
+        const std::uint16_t program[] = {0x0000, 0x0000, 0xB546, 0xB945, 0xCFFF};
+        std::vector<std::uint8_t> flash(2048, 0);
+        std::vector<std::uint8_t> sram(2048, 0);
+        std::uint8_t io[0xE0] = {};
+        std::uint8_t regs[32] = {};
+        LoadProgram(flash, program, std::size(program));
+        std::vector<AvrDecoded> cache(flash.size() / 2);
+        AvrCore core;
+        AVR_Init(&core, flash.data(), flash.size(), sram.data(), sram.size(),
+                 io, sizeof(io), regs, sizeof(regs));
+        AVR_SetDecodeCache(&core, cache.data(), cache.size());
+        AVR_SetIoReadSync(&core, AVR_TCNT0, 1);
+
+        // The hook stands in for a lazily simulated timer: it stores the
+        // counter just before the read.
+        std::vector<std::uint16_t> synced;
+        struct Context
+        {
+            std::vector<std::uint16_t> *synced;
+            std::uint8_t *io;
+        } context{&synced, io};
+        AVR_SetIoSyncHook(
+            &core,
+            [](AvrCore *, std::uint16_t address, void *user)
+            {
+                auto *ctx = static_cast<Context *>(user);
+                ctx->synced->push_back(address);
+                ctx->io[AVR_TCNT0 - AVR_IO_BASE] = 42;
+            },
+            &context);
+
+        // The read starts a block of its own
+        std::uint32_t steps = 0;
+        CHECK(AVR_ExecuteBlock(&core, 100, &steps) == 2);
+        CHECK(synced.empty());
+        CHECK(AVR_ExecuteBlock(&core, 100, &steps) == 1);
+        CHECK(regs[20] == 42);
+        CHECK(synced.size() == 1 && synced[0] == AVR_TCNT0);
+
+        // Writes sync before they land
+        AVR_ExecuteBlock(&core, 100, &steps);
+        CHECK(synced.size() == 2 && synced[1] == AVR_PORTB);
+        CHECK(io[AVR_PORTB - AVR_IO_BASE] == 42);
+
+        std::cout << "[PASS] Test_AvrIoSync\n";
+        return true;
+    }
+
+    // Test 26: Only registers marked for notification reach the write hook
+    bool Test_AvrIoWriteNotify()
+    {
+        // ldi r16,5 ; out PORTB,r16 ; out DDRB,r16 ; out TIFR0,r16 ; push r16 ; rjmp .
+        const std::uint16_t program[] = {0xE005, 0xB905, 0xB904, 0xBB05, 0x930F, 0xCFFF};
+        std::vector<std::uint8_t> flash(2048, 0);
+        std::vector<std::uint8_t> sram(2048, 0);
+        std::uint8_t io[0xE0] = {};
+        std::uint8_t regs[32] = {};
+        LoadProgram(flash, program, std::size(program));
+        AvrCore core;
+        AVR_Init(&core, flash.data(), flash.size(), sram.data(), sram.size(),
+                 io, sizeof(io), regs, sizeof(regs));
+        io[AVR_TIFR0 - AVR_IO_BASE] = 0x07;
+
+        std::vector<std::uint16_t> written;
+        AVR_SetIoWriteHook(
+            &core,
+            [](AvrCore *, std::uint16_t address, std::uint8_t, void *user)
+            { static_cast<std::vector<std::uint16_t> *>(user)->push_back(address); },
+            &written);
+        for (std::uint16_t address = AVR_IO_BASE; address < AVR_IO_SYNC_END; ++address)
+            AVR_SetIoWriteNotify(&core, address, address == AVR_DDRB);
+
+        std::uint32_t steps = 0;
+        for (int block = 0; block < 8; ++block)
+            AVR_ExecuteBlock(&core, 100, &steps);
+
+        // Unhooked registers still store; only DDRB reaches the hook
+        CHECK(written.size() == 1 && written[0] == AVR_DDRB);
+        CHECK(io[AVR_PORTB - AVR_IO_BASE] == 5);
+        CHECK(io[AVR_DDRB - AVR_IO_BASE] == 5);
+        // Flag registers keep write-one-to-clear, SPL/SPH keep the stack
+        CHECK(io[AVR_TIFR0 - AVR_IO_BASE] == 0x02);
+        CHECK(core.sp == 0x08FE && sram[0x7FE] == 5);
+        CHECK(io[AVR_SPL - AVR_IO_BASE] == 0xFE && io[AVR_SPH - AVR_IO_BASE] == 0x08);
+
+        std::cout << "[PASS] Test_AvrIoWriteNotify\n";
+        return true;
+    }
+
+    // Test 27: Recognized libgcc division helpers are computed natively
+    bool Test_AvrRuntimeHle()
+    {
+        // ldi r24,0xE8 ; ldi r25,3 ; ldi r22,7 ; ldi r23,0 ; rcall __udivmodhi4 ; rjmp .
+        // followed by libgcc's __udivmodhi4
+        const std::uint16_t program[] = {
+            0xEE88, 0xE093, 0xE067, 0xE070, 0xD001, 0xCFFF,
+            0x1BAA, 0x1BBB, 0xE151, 0xC007, 0x1FAA, 0x1FBB, 0x17A6, 0x07B7,
+            0xF010, 0x1BA6, 0x0BB7, 0x1F88, 0x1F99, 0x955A, 0xF7A9, 0x9580,
+            0x9590, 0x01BC, 0x01CD, 0x9508};
+        std::vector<std::uint8_t> flash(2048, 0);
+        std::vector<std::uint8_t> sram(2048, 0);
+        std::uint8_t io[0xE0] = {};
+        std::uint8_t regs[32] = {};
+        LoadProgram(flash, program, std::size(program));
+        std::vector<AvrDecoded> cache(flash.size() / 2);
+        AvrCore core;
+        AVR_Init(&core, flash.data(), flash.size(), sram.data(), sram.size(),
+                 io, sizeof(io), regs, sizeof(regs));
+        AVR_SetDecodeCache(&core, cache.data(), cache.size());
+        CHECK(core.hle_entry[AVR_HLE_UDIVMODHI4] == 0xFFFF);
+        AVR_SetRuntimeHle(&core, 1);
+        CHECK(core.hle_entry[AVR_HLE_UDIVMODHI4] == 6);
+        CHECK(core.hle_entry[AVR_HLE_UDIVMODQI4] == 0xFFFF);
+
+        std::uint32_t steps = 0;
+        CHECK(AVR_ExecuteBlock(&core, 100, &steps) == 4); // ldi x4
+        CHECK(AVR_ExecuteBlock(&core, 100, &steps) == 3); // rcall
+        // 1000 / 7 in the cycles the routine takes up to its ret
+        CHECK(AVR_ExecuteBlock(&core, 100, &steps) == 193 && steps == 1);
+        CHECK(core.pc == 25);
+        CHECK(AVR_ExecuteBlock(&core, 100, &steps) == 4); // ret
+        CHECK(core.pc == 5);
+        CHECK(regs[22] == 142 && regs[23] == 0); // Quotient
+        CHECK(regs[24] == 6 && regs[25] == 0);   // Remainder
+        CHECK(regs[21] == 0 && regs[26] == 6 && regs[27] == 0);
+        CHECK(AVR_GetSreg(&core) == 0x23); // H, Z, C from the last COM
+        CHECK(core.hle_calls == 1);
+
+        // A second copy further up does not replace the one in use
+        LoadProgram(flash, program, std::size(program));
+        std::copy(flash.begin() + 2 * 6, flash.begin() + 2 * 26, flash.begin() + 2 * 0x100);
+        AVR_InvalidateFlash(&core, 2 * 0x100, 2 * 20);
+        CHECK(core.hle_entry[AVR_HLE_UDIVMODHI4] == 6);
+        CHECK(cache[6].op != 0);
+
+        // Rewriting the routine moves the entry to the copy; words outside
+        // the rewritten page and the two entries stay decoded
+        cache[0x300] = cache[0];
+        flash[2 * 10] = 0;
+        flash[2 * 10 + 1] = 0;
+        AVR_InvalidateFlash(&core, 2 * 10, 2);
+        CHECK(core.hle_entry[AVR_HLE_UDIVMODHI4] == 0x100);
+        CHECK(cache[0x100].op == 0);
+        CHECK(cache[0x300].op != 0);
+
+        // Rewriting the last copy drops it
+        flash[2 * 0x113] = 0;
+        flash[2 * 0x113 + 1] = 0;
+        AVR_InvalidateFlash(&core, 2 * 0x113, 2);
+        CHECK(core.hle_entry[AVR_HLE_UDIVMODHI4] == 0xFFFF);
+
+        std::cout << "[PASS] Test_AvrRuntimeHle\n";
+        return true;
+    }
+
+    int RunAllTests()
+    {
+        std::cout << "=== Circuit Solver Test Suite ===\n\n";
+
+        int passed = 0;
+        int total = 0;
+
+        auto runTest = [&](bool (*testFunc)(), const char *name)
+        {
+            total++;
+            if (testFunc())
+            {
+                passed++;
+            }
+            else
+            {
+                std::cout << "[FAIL] " << name << "\n";
+            }
+        };
+
+        runTest(Test_IndependentPartitions, "IndependentPartitions");
+        runTest(Test_CleanPartitionsSkipped, "CleanPartitionsSkipped");
+        runTest(Test_ParallelMatchesSerial, "ParallelMatchesSerial");
+        runTest(Test_DiodeConverges, "DiodeConverges");
+        runTest(Test_AvrPortWritesDriveResolve, "AvrPortWritesDriveResolve");
+        runTest(Test_AvrInputSeesOutputWithinStep, "AvrInputSeesOutputWithinStep");
+        runTest(Test_RcChargeAndSettle, "RcChargeAndSettle");
+        runTest(Test_RlCurrentRise, "RlCurrentRise");
+        runTest(Test_DiodeArrayBatch, "DiodeArrayBatch");
+        runTest(Test_LoadNetlist, "LoadNetlist");
+        runTest(Test_CircuitStateReadback, "CircuitStateReadback");
+        runTest(Test_BatchedSweep, "BatchedSweep");
+        runTest(Test_FixedKernelsMatchDense, "FixedKernelsMatchDense");
+        runTest(Test_DeviceBypass, "DeviceBypass");
+        runTest(Test_PwmAveraging, "PwmAveraging");
+        runTest(Test_IterativeBackend, "IterativeBackend");
+        runTest(Test_CircuitStats, "CircuitStats");
+        runTest(Test_ParallelAvrStepping, "ParallelAvrStepping");
+        runTest(Test_AvrDecodeCache, "AvrDecodeCache");
+        runTest(Test_AvrBlockExecution, "AvrBlockExecution");
+        runTest(Test_AvrPendingInterrupts, "AvrPendingInterrupts");
+        runTest(Test_AvrLazyFlags, "AvrLazyFlags");
+        runTest(Test_AvrIdleLoopSkip, "AvrIdleLoopSkip");
+        runTest(Test_AvrSleep, "AvrSleep");
+        runTest(Test_AvrIoSync, "AvrIoSync");
+        runTest(Test_AvrIoWriteNotify, "AvrIoWriteNotify");
+        runTest(Test_AvrRuntimeHle, "AvrRuntimeHle");
+
+        std::cout << "\n=== Test Results ===\n";
+        std::cout << "Passed: " << passed << "/" << total << "\n";
+        return passed == total ? 0 : 1;
+    }
+
+} // namespace NativeEngine::Circuit::Tests
+
+int main()
+{
+    return NativeEngine::Circuit::Tests::RunAllTests();
+}
@@ -0,0 +1,317 @@
+// Virtual MCU Test Suite
+// Tests for timer interrupts, polled timer reads, sleep, step scheduling and
+// step-loop selection of the firmware host's VirtualMcu
+
+#include "BoardProfile.h"
+#include "VirtualMcu.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace firmware::Tests
+{
+
+#define CHECK(cond)                                                        \
+    do                                                                     \
+    {                                                                      \
+        if (!(cond))                                                       \
+        {                                                                  \
+            std::cout << "  check failed: " #cond " (line " << __LINE__ << ")\n"; \
+            return false;                                                  \
+        }                                                                  \
+    } while (0)
+
+    // GPIOR1/GPIOR2: the interrupt count the test firmware publishes
+    constexpr std::uint16_t kGpior1 = 0x4A;
+    constexpr std::uint16_t kGpior2 = 0x4B;
+    constexpr std::uint16_t kIsrWord = 0x80;
+    constexpr std::uint16_t kMainWord = 0x90;
+
+    // Flashes a program whose every vector counts into r25:r24 and
+    // publishes the count in GPIOR2:GPIOR1; `main` runs from kMainWord.
+    bool LoadFirmware(VirtualMcu &mcu, const std::vector<std::uint16_t> &main)
+    {
+        std::vector<std::uint16_t> words(kMainWord, 0);
+        auto rjmp = [](std::uint16_t from, std::uint16_t to)
+        { return static_cast<std::uint16_t>(0xC000 | ((to - from - 1) & 0x0FFF)); };
+        words[0] = rjmp(0, kMainWord);
+        for (std::uint16_t vector = 2; vector < kIsrWord; vector += 2)
+            words[vector] = rjmp(vector, kIsrWord);
+        // adiw r24,1 ; out GPIOR1,r24 ; out GPIOR2,r25 ; reti
+        const std::uint16_t isr[] = {0x9601, 0xBD8A, 0xBD9B, 0x9518};
+        for (std::size_t i = 0; i < std::size(isr); ++i)
+            words[kIsrWord + i] = isr[i];
+        words.insert(words.end(), main.begin(), main.end());
+
+        std::vector<std::uint8_t> bytes;
+        for (std::uint16_t word : words)
+        {
+            bytes.push_back(static_cast<std::uint8_t>(word & 0xFF));
+            bytes.push_back(static_cast<std::uint8_t>(word >> 8));
+        }
+        std::string error;
+        return mcu.ProgramFlash(0, bytes.data(), bytes.size(), error);
+    }
+
+    std::uint16_t InterruptCount(const VirtualMcu &mcu)
+    {
+        return static_cast<std::uint16_t>(mcu.GetIo(kGpior1) | (mcu.GetIo(kGpior2) << 8));
+    }
+
+    // ldi r16,1 ; sts TIMSK0,r16 ; ldi r16,3 ; out TCCR0B,r16 ; sei ; rjmp .
+    const std::vector<std::uint16_t> kTimer0Overflow = {0xE001, 0x9300, 0x006E, 0xE003,
+                                                       0xBD05, 0x9478, 0xCFFF};
+
+    // Test 1: Timer interrupts arrive at the analytic rate in each mode
+    bool Test_TimerInterruptCounts()
+    {
+        struct Case
+        {
+            std::vector<std::uint16_t> main;
+            std::uint64_t period; // CPU cycles between interrupts
+        };
+        const Case cases[] = {
+            // Normal mode, /64: overflow every 256 * 64 cycles
+            {kTimer0Overflow, 256 * 64},
+            // ldi r16,3 ; sts OCR1AH,r16 ; ldi r16,0xE7 ; sts OCR1AL,r16 ;
+            // ldi r16,2 ; sts TIMSK1,r16 ; ldi r16,9 ; sts TCCR1B,r16 ; sei ; rjmp .
+            // CTC on OCR1A = 999, /1: compare match every 1000 cycles
+            {{0xE003, 0x9300, 0x0089, 0xEE07, 0x9300, 0x0088, 0xE002, 0x9300, 0x006F, 0xE009,
+              0x9300, 0x0081, 0x9478, 0xCFFF},
+             1000},
+            // ldi r16,1 ; sts TIMSK0,r16 ; out TCCR0A,r16 ; ldi r16,2 ; out TCCR0B,r16 ; sei ; rjmp .
+            // Phase correct, /8: overflow at BOTTOM every 510 * 8 cycles
+            {{0xE001, 0x9300, 0x006E, 0xBD04, 0xE002, 0xBD05, 0x9478, 0xCFFF}, 510 * 8},
+        };
+
+        for (const Case &test : cases)
+        {
+            for (int deterministic = 0; deterministic < 2; ++deterministic)
+            {
+                VirtualMcu mcu(GetDefaultBoardProfile());
+                CHECK(LoadFirmware(mcu, test.main));
+                mcu.SetDeterministicMode(deterministic != 0);
+                // Half a period past the last expected interrupt
+                mcu.StepCycles(400 * test.period + test.period / 2);
+                CHECK(InterruptCount(mcu) == 400);
+            }
+        }
+
+        std::cout << "[PASS] Test_TimerInterruptCounts\n";
+        return true;
+    }
+
+    // Test 2: A loop polling TCNT0 sees the counter of the cycle it reads in
+    bool Test_PolledTimerRead()
+    {
+        // ldi r16,2 ; out TCCR0B,r16 ; loop: in r20,TCNT0 ; cpi r20,200 ; brne loop ;
+        // ldi r18,0xFF ; out PORTB,r18 ; rjmp .
+        const std::vector<std::uint16_t> main = {0xE002, 0xBD05, 0xB546, 0x3C48,
+                                                 0xF7E9, 0xEF2F, 0xB925, 0xCFFF};
+        std::uint64_t seen[2] = {};
+        for (int deterministic = 0; deterministic < 2; ++deterministic)
+        {
+            VirtualMcu mcu(GetDefaultBoardProfile());
+            CHECK(LoadFirmware(mcu, main));
+            mcu.SetDeterministicMode(deterministic != 0);
+            // /8: TCNT0 reaches 200 after 1600 cycles
+            mcu.StepCycles(1590);
+            CHECK(mcu.GetIo(0x25) == 0);
+            while (mcu.GetIo(0x25) == 0 && mcu.TickCount() < 4000)
+                mcu.StepCycles(1);
+            seen[deterministic] = mcu.TickCount();
+            CHECK(seen[deterministic] > 1600 && seen[deterministic] < 1620);
+        }
+        CHECK(seen[0] == seen[1]);
+
+        std::cout << "[PASS] Test_PolledTimerRead\n";
+        return true;
+    }
+
+    // Test 3: SLEEP idles until the next timer interrupt wakes the core
+    bool Test_SleepUntilInterrupt()
+    {
+        // ldi r16,1 ; sts TIMSK0,r16 ; out SMCR,r16 ; ldi r16,3 ; out TCCR0B,r16 ; sei ;
+        // loop: sleep ; rjmp loop
+        const std::vector<std::uint16_t> main = {0xE001, 0x9300, 0x006E, 0xBB03, 0xE003,
+                                                 0xBD05, 0x9478, 0x9588, 0xCFFE};
+        const std::uint64_t period = 256 * 64;
+        VirtualMcu mcu(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(mcu, main));
+        mcu.StepCycles(50 * period + period / 2);
+        CHECK(InterruptCount(mcu) == 50);
+        // Every cycle but the setup and the handlers is spent asleep
+        CHECK(mcu.GetPerfCounters().sleepCycles > 50 * (period - 64));
+        CHECK(mcu.GetPC() == kMainWord + 8);
+
+        std::cout << "[PASS] Test_SleepUntilInterrupt\n";
+        return true;
+    }
+
+    // Test 4: The result does not depend on how StepCycles is chunked
+    bool Test_ChunkSizeInvariance()
+    {
+        // Timer0 overflow interrupts while the main loop copies TCNT0 to PORTB:
+        // ldi r16,1 ; sts TIMSK0,r16 ; ldi r16,3 ; out TCCR0B,r16 ; sei ;
+        // loop: in r20,TCNT0 ; out PORTB,r20 ; rjmp loop
+        const std::vector<std::uint16_t> main = {0xE001, 0x9300, 0x006E, 0xE003, 0xBD05,
+                                                 0x9478, 0xB546, 0xB945, 0xCFFD};
+        const std::uint64_t total = 1000003;
+        const std::uint64_t chunks[] = {total, 1, 7, 64, 1000, 65536};
+
+        VirtualMcu reference(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(reference, main));
+        reference.StepCycles(total);
+        CHECK(InterruptCount(reference) == total / (256 * 64));
+
+        for (std::uint64_t chunk : chunks)
+        {
+            VirtualMcu mcu(GetDefaultBoardProfile());
+            CHECK(LoadFirmware(mcu, main));
+            while (mcu.TickCount() < total)
+                mcu.StepCycles(std::min(chunk, total - mcu.TickCount()));
+            CHECK(mcu.TickCount() == reference.TickCount());
+            CHECK(mcu.GetPC() == reference.GetPC());
+            CHECK(InterruptCount(mcu) == InterruptCount(reference));
+            CHECK(mcu.GetIo(0x25) == reference.GetIo(0x25));
+            CHECK(mcu.GetIo(0x46) == reference.GetIo(0x46));
+        }
+
+        std::cout << "[PASS] Test_ChunkSizeInvariance\n";
+        return true;
+    }
+
+    // Ticks, PC, interrupt count, PORTB, TCNT0 and SREG all match
+    bool SameState(const VirtualMcu &a, const VirtualMcu &b)
+    {
+        return a.TickCount() == b.TickCount() && a.GetPC() == b.GetPC() &&
+               InterruptCount(a) == InterruptCount(b) && a.GetIo(0x25) == b.GetIo(0x25) &&
+               a.GetIo(0x46) == b.GetIo(0x46) && a.GetIo(0x3F) == b.GetIo(0x3F);
+    }
+
+    // Test 5: Instrumented and plain step loops run firmware identically,
+    // including when instrumentation is switched mid-run
+    bool Test_InstrumentationEquivalence()
+    {
+        // ldi r16,1 ; sts TIMSK0,r16 ; ldi r16,3 ; out TCCR0B,r16 ; sei ;
+        // loop: in r20,TCNT0 ; out PORTB,r20 ; rjmp loop
+        const std::vector<std::uint16_t> main = {0xE001, 0x9300, 0x006E, 0xE003, 0xBD05,
+                                                 0x9478, 0xB546, 0xB945, 0xCFFD};
+        const std::uint64_t slice = 100003;
+        const int slices = 12;
+
+        VirtualMcu plain(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(plain, main));
+        VirtualMcu deterministic(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(deterministic, main));
+        deterministic.SetDeterministicMode(true);
+        VirtualMcu traced(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(traced, main));
+        traced.EnableCpuTrace(true);
+        VirtualMcu tracked(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(tracked, main));
+        tracked.EnableDevelopmentTracking(true);
+        VirtualMcu toggled(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(toggled, main));
+
+        for (int i = 0; i < slices; ++i)
+        {
+            // Each switch picks another step loop between two slices
+            toggled.SetDeterministicMode(i % 2 == 1);
+            toggled.EnableCpuTrace(i % 3 == 1);
+            toggled.EnableDevelopmentTracking(i % 4 == 2);
+
+            plain.StepCycles(slice);
+            deterministic.StepCycles(slice);
+            traced.StepCycles(slice);
+            tracked.StepCycles(slice);
+            toggled.StepCycles(slice);
+            CHECK(SameState(plain, deterministic));
+            CHECK(SameState(plain, traced));
+            CHECK(SameState(plain, tracked));
+            CHECK(SameState(plain, toggled));
+        }
+        CHECK(InterruptCount(plain) == slices * slice / (256 * 64));
+
+        std::cout << "[PASS] Test_InstrumentationEquivalence\n";
+        return true;
+    }
+
+    // Test 6: The ATmega2560 profile takes its own vectors and runs its own
+    // timers on either step loop
+    bool Test_Mega2560Board()
+    {
+        // ldi r16,1 ; sts TIMSK0,r16 ; sts TCCR3B,r16 ; ldi r16,3 ; out TCCR0B,r16 ; sei ; rjmp .
+        // Timer0 overflow interrupts, Timer3 (2560 only) free running at /1
+        const std::vector<std::uint16_t> main = {0xE001, 0x9300, 0x006E, 0x9300, 0x0091,
+                                                 0xE003, 0xBD05, 0x9478, 0xCFFF};
+        const std::uint64_t cycles = 400 * 256 * 64 + 128 * 64;
+        const BoardProfile &mega = GetBoardProfile("mega2560");
+        CHECK(mega.mcu == "ATmega2560");
+
+        VirtualMcu plain(mega);
+        CHECK(LoadFirmware(plain, main));
+        VirtualMcu deterministic(mega);
+        CHECK(LoadFirmware(deterministic, main));
+        deterministic.SetDeterministicMode(true);
+        plain.StepCycles(cycles);
+        deterministic.StepCycles(cycles);
+        CHECK(InterruptCount(plain) == 400);
+        CHECK(SameState(plain, deterministic));
+        const std::uint16_t tcnt3 = static_cast<std::uint16_t>(plain.GetIo(0x94) | (plain.GetIo(0x95) << 8));
+        CHECK(tcnt3 != 0);
+        CHECK(deterministic.GetIo(0x94) == plain.GetIo(0x94) &&
+              deterministic.GetIo(0x95) == plain.GetIo(0x95));
+
+        // The Uno has no Timer3
+        VirtualMcu uno(GetDefaultBoardProfile());
+        CHECK(LoadFirmware(uno, main));
+        uno.StepCycles(cycles);
+        CHECK(InterruptCount(uno) == 400);
+        CHECK(uno.GetIo(0x94) == 0 && uno.GetIo(0x95) == 0);
+
+        std::cout << "[PASS] Test_Mega2560Board\n";
+        return true;
+    }
+
+    int RunAllTests()
+    {
+        std::cout << "=== Virtual MCU Test Suite ===\n\n";
+
+        int passed = 0;
+        int total = 0;
+
+        auto runTest = [&](bool (*testFunc)(), const char *name)
+        {
+            total++;
+            if (testFunc())
+            {
+                passed++;
+            }
+            else
+            {
+                std::cout << "[FAIL] " << name << "\n";
+            }
+        };
+
+        runTest(Test_TimerInterruptCounts, "TimerInterruptCounts");
+        runTest(Test_PolledTimerRead, "PolledTimerRead");
+        runTest(Test_SleepUntilInterrupt, "SleepUntilInterrupt");
+        runTest(Test_ChunkSizeInvariance, "ChunkSizeInvariance");
+        runTest(Test_InstrumentationEquivalence, "InstrumentationEquivalence");
+        runTest(Test_Mega2560Board, "Mega2560Board");
+
+        std::cout << "\n=== Test Results ===\n";
+        std::cout << "Passed: " << passed << "/" << total << "\n";
+        return passed == total ? 0 : 1;
+    }
+
+} // namespace firmware::Tests
+
+int main()
+{
+    return firmware::Tests::RunAllTests();
+}